@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+"""Generate const lookup tables for the octave-band analyzer.
+
+Emits a C header with a Hann window, FFT twiddles and bit-reversal
+indices in Q15, plus FFT bin edges of each octave band for every
+supported PCM rate. Everything is `const` so it lands in flash.
+"""
+
+import argparse
+import math
+
+# Nominal octave-band centres (Hz); edges are fc / sqrt(2) .. fc * sqrt(2)
+BAND_CENTRES = [63, 125, 250, 500, 1000, 2000, 4000, 8000]
+SAMPLE_RATES = [16000, 12500]
+
+
+def q15(x):
+    return max(-32768, min(32767, int(round(x * 32768))))
+
+
+def bit_reverse(i, bits):
+    r = 0
+    for _ in range(bits):
+        r = (r << 1) | (i & 1)
+        i >>= 1
+    return r
+
+
+def band_edges(n, fs):
+    """First FFT bin of each band plus one past the end of the last."""
+    nyquist_bin = n // 2
+    edges = []
+    for fc in BAND_CENTRES:
+        lo = fc / math.sqrt(2)
+        edges.append(max(1, min(nyquist_bin, int(math.ceil(lo * n / fs)))))
+    edges.append(nyquist_bin)
+    return edges
+
+
+def fmt_array(values, per_line=8):
+    lines = []
+    for i in range(0, len(values), per_line):
+        chunk = ", ".join(str(v) for v in values[i:i + per_line])
+        lines.append("\t" + chunk + ",")
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--fft-size", type=int, default=256)
+    parser.add_argument("--output", required=True)
+    args = parser.parse_args()
+
+    n = args.fft_size
+    bits = n.bit_length() - 1
+    if 1 << bits != n:
+        raise SystemExit("FFT size must be a power of two")
+
+    window = [q15(0.5 - 0.5 * math.cos(2 * math.pi * i / n))
+              for i in range(n)]
+    cos_tab = [q15(math.cos(2 * math.pi * k / n)) for k in range(n // 2)]
+    sin_tab = [q15(math.sin(2 * math.pi * k / n)) for k in range(n // 2)]
+    bitrev = [bit_reverse(i, bits) for i in range(n)]
+
+    out = []
+    out.append("/* Generated by scripts/gen_band_tables.py -- do not edit */")
+    out.append("#ifndef BAND_TABLES_H")
+    out.append("#define BAND_TABLES_H")
+    out.append("")
+    out.append("#include <stdint.h>")
+    out.append("")
+    out.append("#define BAND_FFT_SIZE %d" % n)
+    out.append("#define BAND_FFT_LOG2 %d" % bits)
+    out.append("#define BAND_TABLE_COUNT %d" % len(BAND_CENTRES))
+    out.append("")
+    out.append("/* Periodic Hann window, Q15 */")
+    out.append("static const int16_t band_window_q15[%d] = {" % n)
+    out.append(fmt_array(window))
+    out.append("};")
+    out.append("")
+    out.append("/* cos(2*pi*k/N), Q15 */")
+    out.append("static const int16_t band_cos_q15[%d] = {" % (n // 2))
+    out.append(fmt_array(cos_tab))
+    out.append("};")
+    out.append("")
+    out.append("/* sin(2*pi*k/N), Q15 */")
+    out.append("static const int16_t band_sin_q15[%d] = {" % (n // 2))
+    out.append(fmt_array(sin_tab))
+    out.append("};")
+    out.append("")
+    out.append("static const uint16_t band_bitrev[%d] = {" % n)
+    out.append(fmt_array(bitrev, 16))
+    out.append("};")
+    out.append("")
+    out.append("struct band_edge_table {")
+    out.append("\tuint32_t sample_rate;")
+    out.append("\tuint16_t first_bin[%d];" % (len(BAND_CENTRES) + 1))
+    out.append("};")
+    out.append("")
+    out.append("/* Octave bands %s Hz */" %
+               ", ".join(str(c) for c in BAND_CENTRES))
+    out.append("static const struct band_edge_table band_edges[] = {")
+    for fs in SAMPLE_RATES:
+        edges = ", ".join(str(e) for e in band_edges(n, fs))
+        out.append("\t{ %d, { %s } }," % (fs, edges))
+    out.append("};")
+    out.append("")
+    out.append("#endif /* BAND_TABLES_H */")
+
+    with open(args.output, "w") as f:
+        f.write("\n".join(out) + "\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+"""Run the native_sim firmware on audio clips and check feedback latency.
+
+Each clip is fed to zephyr.exe with --dmic-file and --dmic-exit. The
+firmware times every loudness onset to the first LED and motor edge and
+exits with status 1 when a latency is over CONFIG_IV_SIM_LATENCY_BUDGET_MS
+or no onset got feedback. With no clips, a step test is synthesized:
+bursts of an 89 dB square wave, 2 s on, 3 s off.
+
+    west build -b native_sim .
+    scripts/sim_latency.py build/zephyr/zephyr.exe [clip.wav ...]
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+import wave
+
+RATE = 16000
+
+
+def write_steps(path, bursts=5, on_s=2, off_s=3, amplitude=30000):
+    frames = bytearray()
+    off = bytes(2 * RATE * off_s)
+    for _ in range(bursts):
+        frames += off
+        for n in range(RATE * on_s):
+            frames += (amplitude if n % 2 else -amplitude).to_bytes(
+                2, "little", signed=True)
+    frames += off
+    with wave.open(path, "wb") as w:
+        w.setnchannels(1)
+        w.setsampwidth(2)
+        w.setframerate(RATE)
+        w.writeframes(bytes(frames))
+
+
+def run(exe, clip, timeout):
+    try:
+        proc = subprocess.run(
+            [exe, "--dmic-file=" + clip, "--dmic-exit"],
+            stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+            universal_newlines=True, timeout=timeout)
+    except subprocess.TimeoutExpired:
+        print("%s: no report within %d s" % (clip, timeout))
+        return False
+
+    # The report and the verdict, without the boot log
+    for line in proc.stdout.splitlines():
+        if "sim_report:" in line:
+            print("%s: %s" % (os.path.basename(clip), line.strip()))
+    if proc.returncode != 0:
+        print("%s: exit status %d" % (clip, proc.returncode))
+    return proc.returncode == 0
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("exe", help="native_sim zephyr.exe")
+    ap.add_argument("clips", nargs="*", help="WAV or raw s16le clips")
+    ap.add_argument("--timeout", type=int, default=120,
+                    help="seconds per clip (default 120)")
+    args = ap.parse_args()
+
+    with tempfile.TemporaryDirectory() as tmp:
+        clips = args.clips
+        if not clips:
+            clips = [os.path.join(tmp, "steps.wav")]
+            write_steps(clips[0])
+        failed = [c for c in clips if not run(args.exe, c, args.timeout)]
+
+    for c in failed:
+        print("FAILED: %s" % c)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,117 @@
+#include "analysis.h"
+#include "profiler.h"
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
+
+LOG_MODULE_REGISTER(analysis, LOG_LEVEL_INF);
+
+int analysis_init(struct analysis *a, const struct analysis_cfg *cfg)
+{
+	const struct level_det_cfg det_cfg = {
+		.sample_rate = cfg->sample_rate,
+		.subframe_ms = cfg->subframe_ms,
+		.window_ms = cfg->window_ms,
+		.attack_ms = cfg->attack_ms,
+		.release_ms = cfg->release_ms,
+	};
+	const struct vad_cfg vad_cfg = {
+		.sample_rate = cfg->sample_rate,
+		.margin_db = cfg->vad_margin_db,
+		.hangover_ms = cfg->vad_hangover_ms,
+	};
+
+	if (cfg->notify_interval_ms == 0 || cfg->cache_interval_ms == 0) {
+		return -EINVAL;
+	}
+
+	memset(a, 0, sizeof(*a));
+	a->cfg = *cfg;
+
+	int err = level_detector_init(&a->detector, &det_cfg);
+
+	if (err) {
+		return err;
+	}
+
+	vad_init(&a->vad, &vad_cfg);
+	a->weighting_sel = WEIGHTING_Z;
+	weighting_init(&a->weighting, WEIGHTING_Z, cfg->sample_rate);
+	return 0;
+}
+
+void analysis_process(struct analysis *a, int16_t *samples, size_t count,
+		      uint32_t gap_ms, uint8_t threshold_db, uint8_t weighting,
+		      struct analysis_result *res)
+{
+	uint32_t rate = a->cfg.sample_rate;
+	uint32_t block_ms = count * 1000 / rate;
+
+	memset(res, 0, sizeof(*res));
+
+	if (gap_ms) {
+		/* Audio is discontinuous: restart windows and filters */
+		level_detector_reset(&a->detector);
+		weighting_init(&a->weighting, a->weighting_sel, rate);
+	}
+
+	if (weighting != a->weighting_sel) {
+		a->weighting_sel = weighting;
+
+		int err = weighting_init(&a->weighting, weighting, rate);
+
+		if (err) {
+			LOG_WRN("Weighting %u unavailable: %d", weighting, err);
+		}
+	}
+
+	PROF_START(t_weight);
+	weighting_process(&a->weighting, samples, count);
+	PROF_END(PROF_STAGE_WEIGHTING, t_weight);
+
+	/* Only loud speech counts toward the attack timer; loud non-speech
+	 * holds the detector as it is
+	 */
+	res->speech = true;
+
+	if (a->cfg.vad) {
+		struct vad_result vres;
+
+		PROF_START(t_vad);
+		vad_process(&a->vad, samples, count, &vres);
+		PROF_END(PROF_STAGE_VAD, t_vad);
+		res->speech = vres.speech;
+	}
+
+	level_detector_process(&a->detector, samples, count, threshold_db,
+			       res->speech, &res->level);
+
+	uint8_t db = res->level.block_db;
+
+	a->notify_db = MAX(a->notify_db, db);
+	a->notify_ms += gap_ms + block_ms;
+	if (a->notify_ms >= a->cfg.notify_interval_ms) {
+		res->notify = true;
+		res->notify_db = a->notify_db;
+		a->notify_db = 0;
+		a->notify_ms = 0;
+	}
+
+	a->cache_sum += db;
+	a->cache_blocks++;
+	a->cache_ms += gap_ms + block_ms;
+	if (a->cache_ms >= a->cfg.cache_interval_ms) {
+		res->cache = true;
+		res->cache_db = (uint8_t)(a->cache_sum / a->cache_blocks);
+		a->cache_sum = 0;
+		a->cache_blocks = 0;
+		/* Keep the remainder so samples stay on a fixed cadence.
+		 * Whole intervals inside a gap have no audio and get no
+		 * sample; the cache opens a new segment at the next push, so
+		 * the gap shows in the timestamps.
+		 */
+		a->cache_ms %= a->cfg.cache_interval_ms;
+	}
+}
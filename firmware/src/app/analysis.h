@@ -0,0 +1,96 @@
+#ifndef APP_ANALYSIS_H
+#define APP_ANALYSIS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "level_detector.h"
+#include "../audio/vad.h"
+#include "../audio/weighting.h"
+
+/*
+ * Per-block level analysis, free of threads and drivers.
+ *
+ * Applies weighting, the optional VAD gate and the level detector to one
+ * PCM block, and decides when a level notification and a 1 Hz cache
+ * sample are due. The monitor thread acts on the result; the host replay
+ * tool (tools/replay) runs the same code over recordings.
+ */
+
+struct analysis_cfg {
+	uint32_t sample_rate;         /* Hz */
+	uint16_t subframe_ms;         /* Level detector settings */
+	uint16_t window_ms;
+	uint16_t attack_ms;
+	uint16_t release_ms;
+	bool     vad;                 /* Gate the attack timer on speech */
+	uint8_t  vad_margin_db;
+	uint16_t vad_hangover_ms;
+	uint16_t notify_interval_ms;  /* Level notification period */
+	uint16_t cache_interval_ms;   /* Cache averaging period */
+};
+
+struct analysis {
+	struct analysis_cfg cfg;
+	struct level_detector detector;
+	struct weighting_filter weighting;
+	uint8_t  weighting_sel;
+	struct vad_state vad;
+
+	/* Level notification: loudest block per interval */
+	uint32_t notify_ms;
+	uint8_t  notify_db;
+
+	/* Cache averaging, counted in time so gaps up to an interval count */
+	uint32_t cache_ms;
+	uint32_t cache_sum;
+	uint32_t cache_blocks;
+};
+
+struct analysis_result {
+	struct level_det_result level;
+	bool     speech;     /* VAD decision (always true without VAD) */
+	bool     notify;     /* A level notification is due */
+	uint8_t  notify_db;
+	bool     cache;      /* A cache sample is due */
+	uint8_t  cache_db;
+};
+
+/**
+ * Initialize the analysis state.
+ *
+ * @param a    Analysis state.
+ * @param cfg  Configuration.
+ * @return 0 on success, -EINVAL for a zero interval or if the level
+ *         detector rejects cfg.
+ */
+int analysis_init(struct analysis *a, const struct analysis_cfg *cfg);
+
+/**
+ * Analyse one PCM block in place.
+ *
+ * The block is filtered in place by the selected weighting curve. A
+ * non-zero gap_ms marks the audio as discontinuous: the detector and
+ * filter state restart, while the gap still counts toward the notify
+ * and cache intervals.
+ *
+ * @param a             Analysis state.
+ * @param samples       Signed 16-bit PCM, modified in place.
+ * @param count         Number of samples.
+ * @param gap_ms        Audio skipped before this block.
+ * @param threshold_db  Trigger threshold.
+ * @param weighting     Weighting curve (enum weighting_curve).
+ * @param res           Output: detector result and due actions.
+ */
+void analysis_process(struct analysis *a, int16_t *samples, size_t count,
+		      uint32_t gap_ms, uint8_t threshold_db, uint8_t weighting,
+		      struct analysis_result *res);
+
+/** True while the level detector is in the triggered state. */
+static inline bool analysis_is_active(const struct analysis *a)
+{
+	return a->detector.active;
+}
+
+#endif /* APP_ANALYSIS_H */
@@ -0,0 +1,51 @@
+#include "block_queue.h"
+
+#include <zephyr/sys/util.h>
+
+BUILD_ASSERT(IS_POWER_OF_TWO(BLOCK_QUEUE_SIZE),
+	     "BLOCK_QUEUE_SIZE must be a power of two");
+
+#define SLOT(idx) ((idx) & (BLOCK_QUEUE_SIZE - 1))
+
+void block_queue_init(struct block_queue *q)
+{
+	atomic_set(&q->head, 0);
+	atomic_set(&q->tail, 0);
+}
+
+uint32_t block_queue_count(const struct block_queue *q)
+{
+	return (uint32_t)atomic_get(&q->head) - (uint32_t)atomic_get(&q->tail);
+}
+
+bool block_queue_put(struct block_queue *q, const struct pdm_block *blk)
+{
+	uint32_t head = (uint32_t)atomic_get(&q->head);
+	uint32_t tail = (uint32_t)atomic_get(&q->tail);
+
+	if (head - tail >= BLOCK_QUEUE_SIZE) {
+		return false;
+	}
+
+	q->slots[SLOT(head)] = *blk;
+
+	/* Publish the slot contents before advancing head */
+	atomic_set(&q->head, (atomic_val_t)(head + 1));
+	return true;
+}
+
+bool block_queue_get(struct block_queue *q, struct pdm_block *blk)
+{
+	uint32_t tail = (uint32_t)atomic_get(&q->tail);
+	uint32_t head = (uint32_t)atomic_get(&q->head);
+
+	if (head == tail) {
+		return false;
+	}
+
+	*blk = q->slots[SLOT(tail)];
+
+	/* Release the slot only after it has been copied out */
+	atomic_set(&q->tail, (atomic_val_t)(tail + 1));
+	return true;
+}
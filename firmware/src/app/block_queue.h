@@ -0,0 +1,54 @@
+#ifndef APP_BLOCK_QUEUE_H
+#define APP_BLOCK_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <zephyr/sys/atomic.h>
+
+/* Queue depth; must be a power of two and cover IV_PDM_NUM_BLOCKS */
+#define BLOCK_QUEUE_SIZE 32
+
+/* One captured PDM block handed from the capture to the analysis thread */
+struct pdm_block {
+	void     *buf;          /* Slab buffer, owned by the consumer */
+	size_t    size;         /* Bytes */
+	uint32_t  gap_ms;       /* Audio skipped before this block */
+	uint32_t  captured_at;  /* k_cycle_get_32() when read returned */
+#if defined(CONFIG_IV_PROFILER)
+	uint32_t  read_cyc;     /* DWT cycle count when read returned */
+#endif
+};
+
+/*
+ * Lock-free single-producer/single-consumer ring of block descriptors.
+ * head is written only by the producer and tail only by the consumer,
+ * so no lock or interrupt masking is needed on either side.
+ */
+struct block_queue {
+	struct pdm_block slots[BLOCK_QUEUE_SIZE];
+	atomic_t head;
+	atomic_t tail;
+};
+
+/** Reset the queue. Not safe while producer or consumer are running. */
+void block_queue_init(struct block_queue *q);
+
+/** Number of queued blocks. */
+uint32_t block_queue_count(const struct block_queue *q);
+
+/**
+ * Enqueue a block (producer only).
+ *
+ * @return true on success, false if the queue is full.
+ */
+bool block_queue_put(struct block_queue *q, const struct pdm_block *blk);
+
+/**
+ * Dequeue a block (consumer only).
+ *
+ * @return true on success, false if the queue is empty.
+ */
+bool block_queue_get(struct block_queue *q, struct pdm_block *blk);
+
+#endif /* APP_BLOCK_QUEUE_H */
@@ -1,4 +1,5 @@
 #include "config.h"
+#include "../audio/weighting.h"
 
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
@@ -9,6 +10,7 @@ LOG_MODULE_REGISTER(app_config, LOG_LEVEL_INF);
 static struct app_config current_cfg = {
 	.threshold_db = CONFIG_DEFAULT_THRESHOLD_DB,
 	.feedback_mode = CONFIG_DEFAULT_FEEDBACK_MODE,
+	.weighting = CONFIG_DEFAULT_WEIGHTING,
 };
 
 static K_MUTEX_DEFINE(cfg_mutex);
@@ -32,6 +34,26 @@ static int config_set(const char *name, size_t len,
 		return read_cb(cb_arg, &current_cfg.feedback_mode, len);
 	}
 
+	if (!strcmp(name, "weighting")) {
+		uint8_t weighting;
+		ssize_t rc;
+
+		if (len != sizeof(weighting)) {
+			return -EINVAL;
+		}
+		rc = read_cb(cb_arg, &weighting, len);
+		if (rc < 0) {
+			return rc;
+		}
+		/* As weighting_write(): a corrupt value keeps the default */
+		if (weighting > WEIGHTING_C) {
+			LOG_WRN("Ignoring stored weighting %u", weighting);
+			return -EINVAL;
+		}
+		current_cfg.weighting = weighting;
+		return 0;
+	}
+
 	return -ENOENT;
 }
 
@@ -53,8 +75,9 @@ int app_config_init(void)
 		return err;
 	}
 
-	LOG_INF("Config loaded: threshold=%u dB, feedback_mode=0x%02x",
-		current_cfg.threshold_db, current_cfg.feedback_mode);
+	LOG_INF("Config loaded: threshold=%u dB, feedback_mode=0x%02x, "
+		"weighting=%u", current_cfg.threshold_db,
+		current_cfg.feedback_mode, current_cfg.weighting);
 	return 0;
 }
 
@@ -96,3 +119,18 @@ int app_config_set_feedback_mode(uint8_t mode)
 	}
 	return err;
 }
+
+int app_config_set_weighting(uint8_t weighting)
+{
+	k_mutex_lock(&cfg_mutex, K_FOREVER);
+	current_cfg.weighting = weighting;
+	k_mutex_unlock(&cfg_mutex);
+
+	int err = settings_save_one("iv/weighting", &weighting,
+				    sizeof(weighting));
+
+	if (err) {
+		LOG_ERR("Failed to save weighting: %d", err);
+	}
+	return err;
+}
@@ -12,9 +12,13 @@
 #define CONFIG_DEFAULT_THRESHOLD_DB 70
 #define CONFIG_DEFAULT_FEEDBACK_MODE FEEDBACK_MODE_ALL
 
+/* Default frequency weighting (0 = Z/flat, 1 = A, 2 = C) */
+#define CONFIG_DEFAULT_WEIGHTING 0
+
 struct app_config {
 	uint8_t threshold_db;
 	uint8_t feedback_mode;
+	uint8_t weighting;
 };
 
 /**
@@ -32,4 +36,7 @@ int app_config_set_threshold(uint8_t db);
 /** Set feedback mode bitmask and persist to NVS. */
 int app_config_set_feedback_mode(uint8_t mode);
 
+/** Set frequency weighting curve and persist to NVS. */
+int app_config_set_weighting(uint8_t weighting);
+
 #endif /* APP_CONFIG_H */
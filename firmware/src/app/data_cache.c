@@ -1,69 +1,382 @@
+#include <errno.h>
+#include <string.h>
 #include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
 #include "data_cache.h"
 
-static struct iv_sample cache[CACHE_MAX_SAMPLES];
-static uint32_t head;
-static uint32_t tail;
-static uint32_t count;
+BUILD_ASSERT(IS_POWER_OF_TWO(CACHE_MAX_SAMPLES),
+	     "CACHE_MAX_SAMPLES must be a power of two");
+BUILD_ASSERT(IS_POWER_OF_TWO(CACHE_MAX_SEGMENTS),
+	     "CACHE_MAX_SEGMENTS must be a power of two");
 
-K_MUTEX_DEFINE(cache_mutex);
+#define SLOT(seq)   ((seq) & (CACHE_MAX_SAMPLES - 1))
+#define SEG_SLOT(n) ((n) & (CACHE_MAX_SEGMENTS - 1))
+
+struct cache_segment {
+	int64_t  base_ms;  /* Uptime of the segment's first sample */
+	uint32_t first;    /* Sequence number of the first sample */
+};
+
+/*
+ * Samples are numbered by a free-running sequence: sample n lives at
+ * db_ring[SLOT(n)], segment k at segs[SEG_SLOT(k)], and a segment ends
+ * where the next one (or head) begins.
+ *
+ * head and seg_head are written only by the producer, which never waits
+ * for readers: when full it reuses the oldest slot. The slot it reuses
+ * next is never handed out, so a sample is available while it is within
+ * CACHE_MAX_SAMPLES - 1 of head, inside one of the newest
+ * CACHE_MAX_SEGMENTS - 1 segments, and not before tail. tail (moved by
+ * clear and release) and flushed (the flash log mark) are only written
+ * by readers.
+ */
+static uint8_t db_ring[CACHE_MAX_SAMPLES];
+static struct cache_segment segs[CACHE_MAX_SEGMENTS];
+static atomic_t head;
+static atomic_t seg_head;
+static atomic_t tail;
+static atomic_t flushed;
+
+/* Producer positions seen by a reader, and the oldest available sample */
+struct cache_pos {
+	uint32_t head;
+	uint32_t seg_head;
+	uint32_t oldest;
+};
+
+static bool seq_before(uint32_t a, uint32_t b)
+{
+	return (int32_t)(a - b) < 0;
+}
+
+static uint32_t seq_max(uint32_t a, uint32_t b)
+{
+	return seq_before(a, b) ? b : a;
+}
+
+/* Producer publish. With one writer no read-modify-write is needed
+ * (atomic_set() is an exchange): the release store orders the slot
+ * before the new position, and the fence orders the new position before
+ * the next push overwrites the oldest slot.
+ */
+static void publish(atomic_t *pos, uint32_t v)
+{
+	__atomic_store_n(pos, (atomic_val_t)v, __ATOMIC_RELEASE);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/* Reader side of publish(): orders the copies already made before the
+ * re-check of the producer position. Free where loads are not reordered.
+ */
+static void copy_fence(void)
+{
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+}
+
+/* Move a reader mark forward to seq; it never moves back */
+static void advance_mark(atomic_t *mark, uint32_t seq)
+{
+	atomic_val_t cur;
+
+	do {
+		cur = atomic_get(mark);
+		if (!seq_before((uint32_t)cur, seq)) {
+			return;
+		}
+	} while (!atomic_cas(mark, cur, (atomic_val_t)seq));
+}
+
+static void pos_take(struct cache_pos *p)
+{
+	for (;;) {
+		/* head before seg_head: every sample below head then has
+		 * its segment below seg_head
+		 */
+		p->head = (uint32_t)atomic_get(&head);
+		p->seg_head = (uint32_t)atomic_get(&seg_head);
+		p->oldest = seq_max((uint32_t)atomic_get(&tail),
+				    p->head - (CACHE_MAX_SAMPLES - 1));
+
+		if (p->seg_head < CACHE_MAX_SEGMENTS) {
+			return;
+		}
+
+		uint32_t seg_lo = p->seg_head - (CACHE_MAX_SEGMENTS - 1);
+
+		p->oldest = seq_max(p->oldest, segs[SEG_SLOT(seg_lo)].first);
+
+		/* The oldest segment is reused only when a new one starts */
+		copy_fence();
+		if ((uint32_t)atomic_get(&seg_head) == p->seg_head) {
+			return;
+		}
+	}
+}
+
+/* True if nothing read since pos_take() from sequence seq onwards, or
+ * from segment seg onwards, can have been reused by the producer
+ */
+static bool pos_valid(uint32_t seq, uint32_t seg)
+{
+	copy_fence();
+
+	uint32_t h = (uint32_t)atomic_get(&head);
+	uint32_t sh = (uint32_t)atomic_get(&seg_head);
+
+	return h - seq < CACHE_MAX_SAMPLES && sh - seg < CACHE_MAX_SEGMENTS;
+}
+
+/* Segment holding available sample seq: the last one starting at or
+ * before it. Offsets from the oldest segment so the sequence may wrap.
+ */
+static uint32_t find_segment(const struct cache_pos *p, uint32_t seq)
+{
+	uint32_t lo = p->seg_head < CACHE_MAX_SEGMENTS ? 0 :
+		      p->seg_head - (CACHE_MAX_SEGMENTS - 1);
+	uint32_t hi = p->seg_head - 1;
+	uint32_t base = segs[SEG_SLOT(lo)].first;
+
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo + 1) / 2;
+
+		if (segs[SEG_SLOT(mid)].first - base <= seq - base) {
+			lo = mid;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	return lo;
+}
+
+static uint32_t seg_end(const struct cache_pos *p, uint32_t seg)
+{
+	return seg + 1 < p->seg_head ? segs[SEG_SLOT(seg + 1)].first : p->head;
+}
 
 void data_cache_init(void)
 {
-	k_mutex_lock(&cache_mutex, K_FOREVER);
-	head = 0;
-	tail = 0;
-	count = 0;
-	k_mutex_unlock(&cache_mutex);
+	atomic_set(&head, 0);
+	atomic_set(&seg_head, 0);
+	atomic_set(&tail, 0);
+	atomic_set(&flushed, 0);
 }
 
 void data_cache_push(uint8_t db)
 {
-	k_mutex_lock(&cache_mutex, K_FOREVER);
+	int64_t now = k_uptime_get();
+	uint32_t h = (uint32_t)atomic_get(&head);
+	uint32_t sh = (uint32_t)atomic_get(&seg_head);
+	bool on_cadence = false;
+
+	if (sh > 0) {
+		const struct cache_segment *last = &segs[SEG_SLOT(sh - 1)];
+		int64_t expected = last->base_ms +
+				   (int64_t)(h - last->first) *
+				   CACHE_INTERVAL_MS;
+		int64_t skew = now - expected;
+
+		on_cadence = skew >= -CACHE_INTERVAL_MS / 2 &&
+			     skew <= CACHE_INTERVAL_MS / 2;
+	}
 
-	if (count == CACHE_MAX_SAMPLES) {
-		/* Overwrite oldest */
-		tail = (tail + 1) % CACHE_MAX_SAMPLES;
-	} else {
-		count++;
+	if (!on_cadence) {
+		segs[SEG_SLOT(sh)] = (struct cache_segment){
+			.base_ms = now,
+			.first = h,
+		};
+		/* Publish the segment before the sample that needs it */
+		publish(&seg_head, sh + 1);
 	}
 
-	cache[head].uptime_ms = (uint32_t)k_uptime_get();
-	cache[head].db = db;
-	head = (head + 1) % CACHE_MAX_SAMPLES;
+	db_ring[SLOT(h)] = db;
 
-	k_mutex_unlock(&cache_mutex);
+	/* Publish the sample before advancing head */
+	publish(&head, h + 1);
 }
 
 uint32_t data_cache_count(void)
 {
-	k_mutex_lock(&cache_mutex, K_FOREVER);
-	uint32_t n = count;
-	k_mutex_unlock(&cache_mutex);
-	return n;
+	struct cache_pos p;
+
+	pos_take(&p);
+	return p.head - p.oldest;
+}
+
+void data_cache_clear(void)
+{
+	advance_mark(&tail, (uint32_t)atomic_get(&head));
+}
+
+void data_cache_snapshot(struct iv_cursor *cur)
+{
+	struct cache_pos p;
+
+	pos_take(&p);
+	cur->start = p.oldest;
+	cur->end = p.head;
+}
+
+/* Copy n samples from seq, which lies in segment seg */
+static void copy_samples(const struct cache_pos *p, uint32_t seg,
+			 uint32_t seq, struct iv_sample *buf, uint32_t n)
+{
+	while (n > 0) {
+		const struct cache_segment *s = &segs[SEG_SLOT(seg)];
+		uint32_t run = MIN(n, seg_end(p, seg) - seq);
+		uint32_t t = (uint32_t)(s->base_ms +
+					(int64_t)(seq - s->first) *
+					CACHE_INTERVAL_MS);
+		uint32_t slot = SLOT(seq);
+
+		for (uint32_t i = 0; i < run; i++) {
+			buf[i].uptime_ms = t;
+			buf[i].db = db_ring[slot];
+			t += CACHE_INTERVAL_MS;
+			slot = SLOT(slot + 1);
+		}
+
+		buf += run;
+		seq += run;
+		n -= run;
+		seg++;
+	}
+}
+
+/* Copy n available samples from seq. Returns -EAGAIN if the producer
+ * reused them meanwhile.
+ */
+static int read_at(const struct cache_pos *p, uint32_t seq,
+		   struct iv_sample *buf, uint32_t n)
+{
+	uint32_t seg = find_segment(p, seq);
+
+	copy_samples(p, seg, seq, buf, n);
+	return pos_valid(seq, seg) ? (int)n : -EAGAIN;
+}
+
+int data_cache_read(const struct iv_cursor *cur, uint32_t start,
+		    struct iv_sample *buf, uint32_t n)
+{
+	if (start >= iv_cursor_count(cur)) {
+		return 0;
+	}
+
+	uint32_t seq = cur->start + start;
+	int ret;
+
+	n = MIN(n, cur->end - seq);
+
+	do {
+		struct cache_pos p;
+
+		pos_take(&p);
+		if (seq_before(seq, p.oldest)) {
+			return -ENODATA;
+		}
+		/* If overwritten while copying, seq is no longer available
+		 * on the next pass
+		 */
+		ret = read_at(&p, seq, buf, n);
+	} while (ret == -EAGAIN);
+
+	return ret;
 }
 
 bool data_cache_get(uint32_t idx, struct iv_sample *out)
 {
-	k_mutex_lock(&cache_mutex, K_FOREVER);
+	for (;;) {
+		struct cache_pos p;
 
-	if (idx >= count) {
-		k_mutex_unlock(&cache_mutex);
-		return false;
+		pos_take(&p);
+		if (idx >= p.head - p.oldest) {
+			return false;
+		}
+
+		/* One sample: no run to split across segments */
+		uint32_t seq = p.oldest + idx;
+		uint32_t seg = find_segment(&p, seq);
+		const struct cache_segment *s = &segs[SEG_SLOT(seg)];
+
+		out->uptime_ms = (uint32_t)(s->base_ms +
+					    (int64_t)(seq - s->first) *
+					    CACHE_INTERVAL_MS);
+		out->db = db_ring[SLOT(seq)];
+		if (pos_valid(seq, seg)) {
+			return true;
+		}
 	}
+}
 
-	uint32_t actual_idx = (tail + idx) % CACHE_MAX_SAMPLES;
-	*out = cache[actual_idx];
+void data_cache_release(const struct iv_cursor *cur)
+{
+	advance_mark(&tail, cur->end);
+}
+
+int data_cache_ack(uint32_t seq)
+{
+	struct cache_pos p;
 
-	k_mutex_unlock(&cache_mutex);
-	return true;
+	pos_take(&p);
+	if (seq_before(p.head, seq)) {
+		return -ERANGE;
+	}
+	advance_mark(&tail, seq);
+	return 0;
 }
 
-void data_cache_clear(void)
+uint32_t data_cache_peek_unflushed(uint8_t *db, uint32_t max, int64_t *base_ms)
+{
+	for (;;) {
+		struct cache_pos p;
+
+		pos_take(&p);
+
+		/* Samples overwritten before the flash log took them are lost */
+		uint32_t seq = seq_max((uint32_t)atomic_get(&flushed), p.oldest);
+
+		if (seq == p.head) {
+			return 0;
+		}
+
+		uint32_t seg = find_segment(&p, seq);
+		const struct cache_segment *s = &segs[SEG_SLOT(seg)];
+		uint32_t n = MIN(max, seg_end(&p, seg) - seq);
+		uint32_t first = MIN(n, CACHE_MAX_SAMPLES - SLOT(seq));
+
+		*base_ms = s->base_ms + (int64_t)(seq - s->first) *
+			   CACHE_INTERVAL_MS;
+		memcpy(db, &db_ring[SLOT(seq)], first);
+		memcpy(db + first, db_ring, n - first);
+
+		if (pos_valid(seq, seg)) {
+			advance_mark(&flushed, seq);
+			return n;
+		}
+	}
+}
+
+uint32_t data_cache_unflushed(void)
+{
+	struct cache_pos p;
+
+	pos_take(&p);
+	return p.head - seq_max((uint32_t)atomic_get(&flushed), p.oldest);
+}
+
+void data_cache_mark_flushed(uint32_t n)
+{
+	uint32_t h = (uint32_t)atomic_get(&head);
+	uint32_t f = (uint32_t)atomic_get(&flushed);
+
+	advance_mark(&flushed, f + MIN(n, h - f));
+}
+
+void data_cache_pack(const struct iv_sample *s, uint8_t *out)
 {
-	k_mutex_lock(&cache_mutex, K_FOREVER);
-	head = 0;
-	tail = 0;
-	count = 0;
-	k_mutex_unlock(&cache_mutex);
+	out[0] = (uint8_t)(s->uptime_ms & 0xFF);
+	out[1] = (uint8_t)((s->uptime_ms >> 8) & 0xFF);
+	out[2] = (uint8_t)((s->uptime_ms >> 16) & 0xFF);
+	out[3] = (uint8_t)((s->uptime_ms >> 24) & 0xFF);
+	out[4] = s->db;
 }
@@ -4,17 +4,112 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-#define CACHE_MAX_SAMPLES 8000  /* 8000 s ~2.2 hours; 5 bytes each = 40 KB */
+/*
+ * Columnar sample cache: one dB byte per sample in a ring, plus a small
+ * table of segments holding the 64-bit uptime of their first sample.
+ * Samples inside a segment sit CACHE_INTERVAL_MS apart, so timestamps
+ * are implicit; a push that misses the cadence by more than half an
+ * interval (capture paused, clock jump) starts a new segment.
+ *
+ * The cache is lock-free with a single producer: only the monitor
+ * thread pushes. Readers never block it; they copy and then check that
+ * the producer has not overwritten what they copied, retrying if so.
+ */
+#define CACHE_INTERVAL_MS  1000       /* Sample cadence (analysis cache interval) */
+/* Test builds for small-RAM targets (QEMU has 64 KB) pass a smaller ring,
+ * and more segments where every push comes off cadence
+ */
+#ifndef CACHE_MAX_SAMPLES
+#define CACHE_MAX_SAMPLES  (1U << 17) /* ~36 hours at 1 Hz; 1 byte each = 128 KB */
+#endif
+#ifndef CACHE_MAX_SEGMENTS
+#define CACHE_MAX_SEGMENTS 128        /* Gaps held before old samples are dropped */
+#endif
+
+/* Sync wire format: [uptime_ms_le32, db] */
+#define IV_SAMPLE_RECORD_SIZE 5
 
 struct iv_sample {
-	uint32_t uptime_ms;
+	uint32_t uptime_ms;  /* Low 32 bits of the sample uptime */
 	uint8_t  db;
 };
 
+/*
+ * A fixed view of the history by sequence number, [start, end). Samples
+ * pushed after the snapshot stay outside it, and releasing it drops only
+ * what it covered, so a sync never races with new samples.
+ */
+struct iv_cursor {
+	uint32_t start;
+	uint32_t end;
+};
+
+static inline uint32_t iv_cursor_count(const struct iv_cursor *cur)
+{
+	return cur->end - cur->start;
+}
+
+/** Reset the cache. Not safe while the producer is pushing. */
 void     data_cache_init(void);
+
+/** Append a sample. Producer (monitor thread) only. */
 void     data_cache_push(uint8_t db);
+
 uint32_t data_cache_count(void);
 bool     data_cache_get(uint32_t idx, struct iv_sample *out);
 void     data_cache_clear(void);
 
+/** Take a snapshot of the samples cached now. */
+void     data_cache_snapshot(struct iv_cursor *cur);
+
+/**
+ * Copy samples out of a snapshot.
+ *
+ * Copies contiguous spans of the ring, so one call replaces n
+ * data_cache_get() calls.
+ *
+ * @param cur    Snapshot from data_cache_snapshot().
+ * @param start  Index from the start of the snapshot.
+ * @param buf    Output samples.
+ * @param n      Capacity of buf.
+ * @return Number of samples copied (0 past the end of the snapshot),
+ *         -ENODATA if the sample at start has since been overwritten or
+ *         released.
+ */
+int      data_cache_read(const struct iv_cursor *cur, uint32_t start,
+			 struct iv_sample *buf, uint32_t n);
+
+/** Drop the samples covered by a snapshot; newer ones are kept. */
+void     data_cache_release(const struct iv_cursor *cur);
+
+/**
+ * Drop every sample before sequence number seq, as acknowledged by a
+ * sync.
+ *
+ * @return 0, also if they were already dropped; -ERANGE if seq is past
+ *         the newest sample.
+ */
+int      data_cache_ack(uint32_t seq);
+
+/**
+ * Copy the oldest samples not yet marked flushed, for the flash log.
+ *
+ * Stops at a segment boundary so the copied run is evenly spaced.
+ *
+ * @param db       Output dB bytes.
+ * @param max      Capacity of db.
+ * @param base_ms  Output: uptime of the first copied sample.
+ * @return Number of samples copied.
+ */
+uint32_t data_cache_peek_unflushed(uint8_t *db, uint32_t max, int64_t *base_ms);
+
+/** Number of samples not yet marked flushed. */
+uint32_t data_cache_unflushed(void);
+
+/** Mark the n oldest unflushed samples as written to the flash log. */
+void     data_cache_mark_flushed(uint32_t n);
+
+/** Pack a sample into its IV_SAMPLE_RECORD_SIZE-byte sync record. */
+void     data_cache_pack(const struct iv_sample *s, uint8_t *out);
+
 #endif /* APP_DATA_CACHE_H */
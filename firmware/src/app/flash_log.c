@@ -0,0 +1,703 @@
+#include "flash_log.h"
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/sys/util.h>
+
+LOG_MODULE_REGISTER(flash_log, LOG_LEVEL_INF);
+
+#define CHUNK_MAGIC 0x4956  /* "IV" */
+#define SEQ_NONE    UINT32_MAX
+#define BAD_CHUNKS  8
+
+/*
+ * Chunk header, little-endian:
+ *   [0..1] magic  [2] count  [3] reserved  [4..7] first_seq
+ *   [8..15] base_ms  [16..19] CRC32 of the dB bytes
+ *   [20..23] CRC32 of bytes 0..19
+ */
+struct chunk_hdr {
+	uint8_t  count;
+	uint32_t first_seq;
+	int64_t  base_ms;
+	uint32_t data_crc;
+};
+
+enum hdr_state {
+	HDR_VALID,
+	HDR_ERASED,
+	HDR_CORRUPT,
+};
+
+static const struct flash_area *area;
+static uint32_t num_sectors;
+
+/* First sample sequence number per sector, SEQ_NONE if none */
+static uint32_t sector_seq[CONFIG_IV_FLASH_LOG_MAX_SECTORS];
+
+/* advance_sector() erases the sector after the head */
+BUILD_ASSERT(CONFIG_IV_FLASH_LOG_MAX_SECTORS >= 2);
+
+static uint32_t cur_sector;     /* Sector being filled */
+static uint32_t cur_page;       /* Next page to program in it */
+static bool     cur_erased;     /* cur_sector known erased from cur_page */
+static uint32_t oldest_sector;
+static uint32_t end_seq;
+static int64_t  end_ms;
+static uint32_t synced_seq;
+
+/* One-page read cache for sequential sync */
+static struct {
+	bool     valid;
+	uint32_t sector;
+	uint32_t page;
+	struct chunk_hdr hdr;
+	uint8_t  db[FLASH_LOG_CHUNK_SAMPLES];
+} rd;
+
+/* Pages whose payload failed its CRC. count 0: the samples are held by a
+ * later page (a torn tail rewritten after recovery), so only the page is
+ * skipped; otherwise reads of [first_seq, first_seq + count) fail
+ * without touching flash
+ */
+static struct bad_chunk {
+	uint32_t sector;
+	uint32_t page;
+	uint32_t first_seq;
+	uint32_t count;
+} bad[BAD_CHUNKS];
+static uint32_t num_bad;
+
+static struct flash_log_stats stats;
+
+K_MUTEX_DEFINE(log_mutex);
+
+static off_t page_off(uint32_t sector, uint32_t page)
+{
+	return (off_t)sector * FLASH_LOG_SECTOR_SIZE +
+	       (off_t)page * FLASH_LOG_PAGE_SIZE;
+}
+
+static void hdr_encode(const struct chunk_hdr *h, uint8_t *buf)
+{
+	sys_put_le16(CHUNK_MAGIC, &buf[0]);
+	buf[2] = h->count;
+	buf[3] = 0;
+	sys_put_le32(h->first_seq, &buf[4]);
+	sys_put_le64((uint64_t)h->base_ms, &buf[8]);
+	sys_put_le32(h->data_crc, &buf[16]);
+	sys_put_le32(crc32_ieee(buf, 20), &buf[20]);
+}
+
+static enum hdr_state hdr_decode(const uint8_t *buf, struct chunk_hdr *h)
+{
+	static const uint8_t erased[FLASH_LOG_HDR_SIZE] = {
+		[0 ... FLASH_LOG_HDR_SIZE - 1] = 0xFF,
+	};
+
+	if (memcmp(buf, erased, sizeof(erased)) == 0) {
+		return HDR_ERASED;
+	}
+	if (sys_get_le16(&buf[0]) != CHUNK_MAGIC ||
+	    sys_get_le32(&buf[20]) != crc32_ieee(buf, 20) ||
+	    buf[2] == 0 || buf[2] > FLASH_LOG_CHUNK_SAMPLES) {
+		return HDR_CORRUPT;
+	}
+
+	h->count = buf[2];
+	h->first_seq = sys_get_le32(&buf[4]);
+	h->base_ms = (int64_t)sys_get_le64(&buf[8]);
+	h->data_crc = sys_get_le32(&buf[16]);
+	return HDR_VALID;
+}
+
+static int read_hdr(uint32_t sector, uint32_t page, struct chunk_hdr *h,
+		    enum hdr_state *state)
+{
+	uint8_t buf[FLASH_LOG_HDR_SIZE];
+	int err = flash_area_read(area, page_off(sector, page), buf,
+				  sizeof(buf));
+
+	if (err) {
+		return err;
+	}
+	*state = hdr_decode(buf, h);
+	return 0;
+}
+
+/* Oldest entry goes once the table is full; it is found again on read */
+static void mark_bad(uint32_t sector, uint32_t page, uint32_t first_seq,
+		     uint32_t count)
+{
+	bad[num_bad % BAD_CHUNKS] = (struct bad_chunk){
+		.sector = sector,
+		.page = page,
+		.first_seq = first_seq,
+		.count = count,
+	};
+	num_bad++;
+}
+
+static bool page_bad(uint32_t sector, uint32_t page)
+{
+	for (uint32_t i = 0; i < MIN(num_bad, BAD_CHUNKS); i++) {
+		if (bad[i].sector == sector && bad[i].page == page) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool seq_bad(uint32_t seq)
+{
+	for (uint32_t i = 0; i < MIN(num_bad, BAD_CHUNKS); i++) {
+		if (seq >= bad[i].first_seq &&
+		    seq - bad[i].first_seq < bad[i].count) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Drop the entries of a sector about to be erased */
+static void forget_bad(uint32_t sector)
+{
+	uint32_t n = MIN(num_bad, BAD_CHUNKS);
+	uint32_t kept = 0;
+
+	for (uint32_t i = 0; i < n; i++) {
+		if (bad[i].sector != sector) {
+			bad[kept++] = bad[i];
+		}
+	}
+	num_bad = kept;
+}
+
+/* Recovery reads are counted for the boot-time statistic */
+static int recover_hdr(uint32_t sector, uint32_t page, struct chunk_hdr *h,
+		       enum hdr_state *state)
+{
+	stats.recovery_reads++;
+	stats.recovery_bytes += FLASH_LOG_HDR_SIZE;
+	return read_hdr(sector, page, h, state);
+}
+
+static bool page_erased(uint32_t sector, uint32_t page)
+{
+	uint32_t buf[FLASH_LOG_PAGE_SIZE / sizeof(uint32_t)];
+
+	stats.recovery_reads++;
+	stats.recovery_bytes += sizeof(buf);
+	if (flash_area_read(area, page_off(sector, page), buf, sizeof(buf))) {
+		return false;
+	}
+	for (size_t i = 0; i < ARRAY_SIZE(buf); i++) {
+		if (buf[i] != UINT32_MAX) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* First valid chunk of a sector; pages are written in order, so the
+ * scan stops at the first erased page
+ */
+static int scan_sector_start(uint32_t sector)
+{
+	sector_seq[sector] = SEQ_NONE;
+
+	for (uint32_t page = 0; page < FLASH_LOG_PAGES; page++) {
+		struct chunk_hdr h;
+		enum hdr_state state;
+		int err = recover_hdr(sector, page, &h, &state);
+
+		if (err) {
+			return err;
+		}
+		if (state == HDR_VALID) {
+			sector_seq[sector] = h.first_seq;
+			return 0;
+		}
+		if (state == HDR_ERASED) {
+			return 0;
+		}
+		stats.torn_chunks++;
+	}
+	return 0;
+}
+
+/* Find the write position and end of the log in the newest sector */
+static int scan_head_sector(void)
+{
+	uint32_t next = 0;
+	uint32_t last = 0;
+	struct chunk_hdr last_hdr = { 0 };
+	bool seen_valid = false;
+	int err;
+
+	/* Torn pages before the first valid one were counted already */
+	for (uint32_t page = 0; page < FLASH_LOG_PAGES; page++) {
+		struct chunk_hdr h;
+		enum hdr_state state;
+
+		err = recover_hdr(cur_sector, page, &h, &state);
+		if (err) {
+			return err;
+		}
+		if (state == HDR_VALID) {
+			last = page;
+			last_hdr = h;
+			next = page + 1;
+			seen_valid = true;
+		} else if (state == HDR_CORRUPT) {
+			if (seen_valid) {
+				stats.torn_chunks++;
+			}
+			next = page + 1;
+		}
+	}
+
+	/* A write torn after its header leaves a valid header over a short
+	 * payload. The log ends before such a chunk; its samples are
+	 * written again on a later page, so only the page is skipped.
+	 */
+	end_seq = last_hdr.first_seq + last_hdr.count;
+	end_ms = last_hdr.base_ms +
+		 (int64_t)last_hdr.count * CACHE_INTERVAL_MS;
+
+	stats.recovery_reads++;
+	stats.recovery_bytes += last_hdr.count;
+	err = flash_area_read(area, page_off(cur_sector, last) +
+			      FLASH_LOG_HDR_SIZE, rd.db, last_hdr.count);
+	if (err) {
+		return err;
+	}
+	if (crc32_ieee(rd.db, last_hdr.count) != last_hdr.data_crc) {
+		stats.torn_chunks++;
+		mark_bad(cur_sector, last, last_hdr.first_seq, 0);
+		end_seq = last_hdr.first_seq;
+		end_ms = last_hdr.base_ms;
+	}
+
+	/* A write torn before its header leaves a page that reads as
+	 * neither erased nor valid; step past it
+	 */
+	while (next < FLASH_LOG_PAGES && !page_erased(cur_sector, next)) {
+		next++;
+	}
+
+	cur_page = next;
+	cur_erased = true;
+	return 0;
+}
+
+int flash_log_init(const struct flash_area *fa)
+{
+	int err = 0;
+
+	if (fa->fa_size % FLASH_LOG_SECTOR_SIZE != 0 ||
+	    fa->fa_size / FLASH_LOG_SECTOR_SIZE < 2) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&log_mutex, K_FOREVER);
+
+	area = fa;
+	num_sectors = MIN(fa->fa_size / FLASH_LOG_SECTOR_SIZE,
+			  CONFIG_IV_FLASH_LOG_MAX_SECTORS);
+	memset(&stats, 0, sizeof(stats));
+	rd.valid = false;
+	num_bad = 0;
+	end_seq = 0;
+	end_ms = 0;
+	synced_seq = 0;
+
+	bool any = false;
+
+	for (uint32_t s = 0; s < num_sectors; s++) {
+		err = scan_sector_start(s);
+		if (err) {
+			goto out;
+		}
+		if (sector_seq[s] != SEQ_NONE &&
+		    (!any || sector_seq[s] > sector_seq[cur_sector])) {
+			cur_sector = s;
+			any = true;
+		}
+	}
+
+	if (!any) {
+		/* Empty (or unformatted) partition: start at sector 0 */
+		cur_sector = 0;
+		cur_page = 0;
+		cur_erased = false;
+		oldest_sector = 0;
+		goto out;
+	}
+
+	err = scan_head_sector();
+	if (err) {
+		goto out;
+	}
+
+	/* The oldest data follows the head, past any erased sectors */
+	oldest_sector = cur_sector;
+	for (uint32_t i = 1; i < num_sectors; i++) {
+		uint32_t s = (cur_sector + i) % num_sectors;
+
+		if (sector_seq[s] != SEQ_NONE) {
+			oldest_sector = s;
+			break;
+		}
+	}
+
+out:
+	k_mutex_unlock(&log_mutex);
+	if (!err) {
+		LOG_INF("Recovered %u samples in %u sectors (%u header reads)",
+			end_seq - (any ? sector_seq[oldest_sector] : 0),
+			num_sectors, stats.recovery_reads);
+	}
+	return err;
+}
+
+static uint32_t sectors_used(void)
+{
+	if (sector_seq[cur_sector] == SEQ_NONE && cur_sector == oldest_sector) {
+		return 0;
+	}
+	return (cur_sector + num_sectors - oldest_sector) % num_sectors + 1;
+}
+
+static uint32_t oldest_seq(void)
+{
+	uint32_t seq = sector_seq[oldest_sector];
+
+	return seq == SEQ_NONE ? end_seq : seq;
+}
+
+/* Move to the next sector, recycling the oldest one when full */
+static void advance_sector(void)
+{
+	uint32_t next = (cur_sector + 1) % num_sectors;
+
+	if (sector_seq[next] != SEQ_NONE) {
+		sector_seq[next] = SEQ_NONE;
+		oldest_sector = (next + 1) % num_sectors;
+	}
+	if (rd.valid && rd.sector == next) {
+		rd.valid = false;
+	}
+	forget_bad(next);
+	cur_sector = next;
+	cur_page = 0;
+	cur_erased = false;
+}
+
+static int write_chunk(int64_t base_ms, const uint8_t *db, uint32_t count)
+{
+	uint8_t page[FLASH_LOG_PAGE_SIZE];
+	struct chunk_hdr h = {
+		.count = (uint8_t)count,
+		.first_seq = end_seq,
+		.base_ms = base_ms,
+		.data_crc = crc32_ieee(db, count),
+	};
+	int err;
+
+	if (cur_page == FLASH_LOG_PAGES) {
+		advance_sector();
+	}
+	if (!cur_erased) {
+		err = flash_area_erase(area, page_off(cur_sector, 0),
+				       FLASH_LOG_SECTOR_SIZE);
+		if (err) {
+			return err;
+		}
+		stats.erases++;
+		cur_erased = true;
+	}
+
+	memset(page, 0xFF, sizeof(page));
+	hdr_encode(&h, page);
+	memcpy(&page[FLASH_LOG_HDR_SIZE], db, count);
+
+	/* Program only what is used; word-aligned for the QSPI driver */
+	err = flash_area_write(area, page_off(cur_sector, cur_page), page,
+			       ROUND_UP(FLASH_LOG_HDR_SIZE + count, 4));
+	cur_page++;
+	if (err) {
+		/* The page is spent either way; recovery skips it */
+		return err;
+	}
+
+	if (sector_seq[cur_sector] == SEQ_NONE) {
+		sector_seq[cur_sector] = end_seq;
+	}
+	end_seq += count;
+	end_ms = base_ms + (int64_t)count * CACHE_INTERVAL_MS;
+	stats.payload_bytes += count;
+	stats.pages_written++;
+	return 0;
+}
+
+int flash_log_append(int64_t base_ms, const uint8_t *db, uint32_t count)
+{
+	int err = 0;
+
+	k_mutex_lock(&log_mutex, K_FOREVER);
+
+	while (count > 0 && !err) {
+		uint32_t n = MIN(count, FLASH_LOG_CHUNK_SAMPLES);
+
+		err = write_chunk(base_ms, db, n);
+		base_ms += (int64_t)n * CACHE_INTERVAL_MS;
+		db += n;
+		count -= n;
+	}
+
+	k_mutex_unlock(&log_mutex);
+	return err;
+}
+
+static uint32_t first_unsynced(void)
+{
+	uint32_t oldest = oldest_seq();
+
+	return synced_seq > oldest ? MIN(synced_seq, end_seq) : oldest;
+}
+
+uint32_t flash_log_count(void)
+{
+	k_mutex_lock(&log_mutex, K_FOREVER);
+	uint32_t n = end_seq - first_unsynced();
+	k_mutex_unlock(&log_mutex);
+	return n;
+}
+
+/* Sector holding seq: sectors from oldest to current start at
+ * increasing sequence numbers
+ */
+static uint32_t find_sector(uint32_t seq)
+{
+	uint32_t lo = 0;
+	uint32_t hi = sectors_used() - 1;
+
+	while (lo < hi) {
+		uint32_t mid = (lo + hi + 1) / 2;
+		uint32_t s = (oldest_sector + mid) % num_sectors;
+
+		if (sector_seq[s] != SEQ_NONE && sector_seq[s] <= seq) {
+			lo = mid;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	return (oldest_sector + lo) % num_sectors;
+}
+
+static int load_chunk(uint32_t seq)
+{
+	uint32_t sector = find_sector(seq);
+	struct bad_chunk torn = { .count = 0 };
+
+	if (seq_bad(seq)) {
+		return -EIO;
+	}
+
+	for (uint32_t page = 0; page < FLASH_LOG_PAGES; page++) {
+		struct chunk_hdr h;
+		enum hdr_state state;
+		int err;
+
+		if (page_bad(sector, page)) {
+			continue;
+		}
+		err = read_hdr(sector, page, &h, &state);
+		if (err) {
+			return err;
+		}
+		if (state == HDR_ERASED) {
+			break;
+		}
+		if (state != HDR_VALID || seq < h.first_seq ||
+		    seq >= h.first_seq + h.count) {
+			continue;
+		}
+
+		err = flash_area_read(area, page_off(sector, page) +
+				      FLASH_LOG_HDR_SIZE, rd.db, h.count);
+		if (err) {
+			return err;
+		}
+		if (crc32_ieee(rd.db, h.count) != h.data_crc) {
+			/* A torn tail from before a reset; the samples may
+			 * have been written again further on
+			 */
+			if (torn.count) {
+				mark_bad(sector, torn.page, torn.first_seq, 0);
+			}
+			torn = (struct bad_chunk){
+				.sector = sector,
+				.page = page,
+				.first_seq = h.first_seq,
+				.count = h.count,
+			};
+			continue;
+		}
+		if (torn.count) {
+			mark_bad(sector, torn.page, torn.first_seq, 0);
+		}
+		rd.sector = sector;
+		rd.page = page;
+		rd.hdr = h;
+		rd.valid = true;
+		return 0;
+	}
+
+	/* Nothing else holds them: fail the whole chunk from now on */
+	if (torn.count) {
+		mark_bad(sector, torn.page, torn.first_seq, torn.count);
+		stats.torn_chunks++;
+		return -EIO;
+	}
+	return -ENOENT;
+}
+
+bool flash_log_get(uint32_t idx, struct iv_sample *out)
+{
+	bool ok = false;
+
+	k_mutex_lock(&log_mutex, K_FOREVER);
+
+	uint32_t start = first_unsynced();
+
+	if (idx >= end_seq - start) {
+		goto out;
+	}
+
+	uint32_t seq = start + idx;
+
+	if (!rd.valid || seq < rd.hdr.first_seq ||
+	    seq >= rd.hdr.first_seq + rd.hdr.count) {
+		rd.valid = false;
+		if (load_chunk(seq)) {
+			goto out;
+		}
+	}
+
+	uint32_t off = seq - rd.hdr.first_seq;
+
+	out->uptime_ms = (uint32_t)(rd.hdr.base_ms +
+				    (int64_t)off * CACHE_INTERVAL_MS);
+	out->db = rd.db[off];
+	ok = true;
+
+out:
+	k_mutex_unlock(&log_mutex);
+	return ok;
+}
+
+void flash_log_snapshot(struct iv_cursor *cur)
+{
+	k_mutex_lock(&log_mutex, K_FOREVER);
+	cur->start = first_unsynced();
+	cur->end = end_seq;
+	k_mutex_unlock(&log_mutex);
+}
+
+int flash_log_read(const struct iv_cursor *cur, uint32_t start,
+		   struct iv_sample *buf, uint32_t n)
+{
+	int ret = 0;
+
+	if (start >= iv_cursor_count(cur)) {
+		return 0;
+	}
+
+	uint32_t seq = cur->start + start;
+
+	k_mutex_lock(&log_mutex, K_FOREVER);
+
+	if (seq < first_unsynced()) {
+		/* Recycled or marked synced since the snapshot */
+		ret = -ENODATA;
+		goto out;
+	}
+
+	if (!rd.valid || seq < rd.hdr.first_seq ||
+	    seq >= rd.hdr.first_seq + rd.hdr.count) {
+		rd.valid = false;
+		ret = load_chunk(seq);
+		if (ret) {
+			goto out;
+		}
+	}
+
+	uint32_t off = seq - rd.hdr.first_seq;
+	uint32_t t = (uint32_t)(rd.hdr.base_ms +
+				(int64_t)off * CACHE_INTERVAL_MS);
+
+	n = MIN(n, MIN(rd.hdr.count - off, cur->end - seq));
+	for (uint32_t i = 0; i < n; i++) {
+		buf[i].uptime_ms = t;
+		buf[i].db = rd.db[off + i];
+		t += CACHE_INTERVAL_MS;
+	}
+	ret = (int)n;
+
+out:
+	k_mutex_unlock(&log_mutex);
+	return ret;
+}
+
+uint32_t flash_log_end_seq(void)
+{
+	k_mutex_lock(&log_mutex, K_FOREVER);
+	uint32_t seq = end_seq;
+	k_mutex_unlock(&log_mutex);
+	return seq;
+}
+
+int64_t flash_log_end_ms(void)
+{
+	k_mutex_lock(&log_mutex, K_FOREVER);
+	int64_t ms = end_ms;
+	k_mutex_unlock(&log_mutex);
+	return ms;
+}
+
+uint32_t flash_log_advance_synced(uint32_t seq)
+{
+	k_mutex_lock(&log_mutex, K_FOREVER);
+	if (seq > synced_seq) {
+		synced_seq = MIN(seq, end_seq);
+	}
+	seq = synced_seq;
+	k_mutex_unlock(&log_mutex);
+	return seq;
+}
+
+uint32_t flash_log_synced(void)
+{
+	k_mutex_lock(&log_mutex, K_FOREVER);
+	uint32_t seq = synced_seq;
+	k_mutex_unlock(&log_mutex);
+	return seq;
+}
+
+void flash_log_get_stats(struct flash_log_stats *st)
+{
+	k_mutex_lock(&log_mutex, K_FOREVER);
+	*st = stats;
+	st->sectors = num_sectors;
+	st->sectors_used = sectors_used();
+	st->oldest_seq = oldest_seq();
+	st->end_seq = end_seq;
+	st->synced_seq = synced_seq;
+	k_mutex_unlock(&log_mutex);
+}
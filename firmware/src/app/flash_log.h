@@ -0,0 +1,127 @@
+#ifndef APP_FLASH_LOG_H
+#define APP_FLASH_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <zephyr/storage/flash_map.h>
+
+#include "data_cache.h"
+
+/*
+ * Append-only dB history in a flash partition.
+ *
+ * The partition is a circular sequence of erase sectors, each holding
+ * page-sized chunks: a CRC-protected header (first sample sequence
+ * number, timestamp of the first sample) followed by up to
+ * FLASH_LOG_CHUNK_SAMPLES dB bytes at CACHE_INTERVAL_MS spacing. Every
+ * page is programmed once. Sectors are erased strictly in order, so
+ * wear is spread evenly, and the oldest sector is recycled once the
+ * partition is full.
+ *
+ * There is no separate index to corrupt: at boot the first chunk header
+ * of every sector is read to rebuild a RAM table of sector start
+ * sequence numbers, and only the newest sector is scanned page by page.
+ * A torn page write fails its CRC and is skipped: the log ends before a
+ * torn tail, and a chunk whose payload fails on read is remembered so
+ * later reads of its samples fail without touching flash.
+ *
+ * Free of threads and drivers beyond the flash_area API, so the host
+ * bench (tools/bench) runs it against a simulated partition.
+ */
+
+#define FLASH_LOG_SECTOR_SIZE   4096
+#define FLASH_LOG_PAGE_SIZE     256
+#define FLASH_LOG_PAGES         (FLASH_LOG_SECTOR_SIZE / FLASH_LOG_PAGE_SIZE)
+#define FLASH_LOG_HDR_SIZE      24
+#define FLASH_LOG_CHUNK_SAMPLES (FLASH_LOG_PAGE_SIZE - FLASH_LOG_HDR_SIZE)
+
+struct flash_log_stats {
+	uint32_t sectors;
+	uint32_t sectors_used;
+	uint32_t oldest_seq;       /* First sample still in flash */
+	uint32_t end_seq;          /* One past the newest sample */
+	uint32_t synced_seq;       /* Samples before this were synced */
+	uint64_t payload_bytes;    /* dB bytes appended since boot */
+	uint64_t pages_written;    /* Pages programmed since boot */
+	uint32_t erases;           /* Sectors erased since boot */
+	uint32_t torn_chunks;      /* Chunks failing CRC since boot */
+	uint32_t recovery_reads;   /* Flash reads during recovery */
+	uint32_t recovery_bytes;   /* Bytes read during recovery */
+};
+
+/**
+ * Attach to a partition and recover the log state.
+ *
+ * @param fa  Open flash area, a whole number of sectors.
+ * @return 0 on success, -EINVAL for an unusable partition, or a flash
+ *         read error.
+ */
+int flash_log_init(const struct flash_area *fa);
+
+/**
+ * Append evenly spaced samples.
+ *
+ * Written as one chunk per FLASH_LOG_CHUNK_SAMPLES, so callers batch a
+ * full chunk where they can; a short run still takes a whole page.
+ *
+ * @param base_ms  Timestamp of the first sample.
+ * @param db       dB bytes, CACHE_INTERVAL_MS apart.
+ * @param count    Number of samples.
+ * @return 0 on success, negative errno from the flash driver.
+ */
+int flash_log_append(int64_t base_ms, const uint8_t *db, uint32_t count);
+
+/** Number of samples in flash after the synced mark. */
+uint32_t flash_log_count(void);
+
+/**
+ * Read a sample after the synced mark.
+ *
+ * Sequential reads are served from a one-page cache.
+ *
+ * @param idx  Index from the oldest unsynced sample.
+ * @param out  Output sample; uptime_ms is the low 32 bits of the log
+ *             timestamp.
+ * @return false if idx is out of range or its chunk is corrupt.
+ */
+bool flash_log_get(uint32_t idx, struct iv_sample *out);
+
+/** Snapshot the unsynced samples, by log sequence number. */
+void flash_log_snapshot(struct iv_cursor *cur);
+
+/**
+ * Copy samples out of a snapshot, up to the end of one chunk.
+ *
+ * @param cur    Snapshot from flash_log_snapshot().
+ * @param start  Index from the start of the snapshot.
+ * @param buf    Output samples.
+ * @param n      Capacity of buf.
+ * @return Number of samples copied (0 past the end of the snapshot),
+ *         -ENODATA if the sample at start has since been recycled or
+ *         marked synced, or a negative errno if its chunk is unreadable.
+ */
+int flash_log_read(const struct iv_cursor *cur, uint32_t start,
+		   struct iv_sample *buf, uint32_t n);
+
+/** Sequence number one past the newest sample. */
+uint32_t flash_log_end_seq(void);
+
+/** Timestamp the sample after the newest one would carry (0 if empty). */
+int64_t flash_log_end_ms(void);
+
+/**
+ * Move the synced mark forward to seq, capped at the newest sample. A
+ * mark already at or past seq is kept, so a late or repeated ack cannot
+ * hand synced samples out again.
+ *
+ * @return The synced mark after the call.
+ */
+uint32_t flash_log_advance_synced(uint32_t seq);
+
+/** The synced mark: samples before it were synced. */
+uint32_t flash_log_synced(void);
+
+/** Snapshot of the log position and wear counters. */
+void flash_log_get_stats(struct flash_log_stats *st);
+
+#endif /* APP_FLASH_LOG_H */
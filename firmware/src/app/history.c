@@ -0,0 +1,425 @@
+#include "history.h"
+#include "flash_log.h"
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/storage/flash_map.h>
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+#endif
+
+LOG_MODULE_REGISTER(history, LOG_LEVEL_INF);
+
+#define HISTORY_STACK_SIZE 1024
+#define HISTORY_PRIORITY   10  /* Below the capture and monitor threads */
+#define SYNCED_SAVE_S      10  /* At most one mark write per this, mid-sync */
+
+BUILD_ASSERT(HISTORY_TAIL_SAMPLES == FLASH_LOG_CHUNK_SAMPLES,
+	     "A sync's RAM tail holds one flash log chunk");
+
+/* Flash writes and erases block; keep them off the system workqueue */
+K_THREAD_STACK_DEFINE(history_stack, HISTORY_STACK_SIZE);
+static struct k_work_q history_wq;
+static struct k_work flush_work;
+static struct k_work ack_work;
+static struct k_work_delayable periodic_work;
+static struct k_work_delayable save_work;
+
+static K_MUTEX_DEFINE(flush_mutex);
+
+/* Log time = uptime + offset, continuing from the last logged sample */
+static int64_t boot_offset_ms;
+static uint32_t saved_seq;  /* Synced mark last in settings */
+static int64_t recovery_ms;
+static uint32_t flush_errors;
+
+/* Under tail_lock: the sequence number the flash log gives the oldest
+ * sample still in RAM only, moved with the cache's flushed mark so a
+ * snapshot sees them agree; the flash log's first unsynced sample as of
+ * the last history_wq update; and the newest ack, which may be past
+ * both. Acks arrive on the BT RX thread and only move acked_seq; the
+ * history workqueue applies it to the flash log, whose mutex is held
+ * across erases.
+ */
+static struct k_spinlock tail_lock;
+static uint32_t logged_seq;
+static uint32_t logged_start;
+static uint32_t acked_seq;
+
+/* Until the log is recovered (or if it cannot be), the RAM cache
+ * serves as history on its own
+ */
+static bool ready;
+
+/* --- Synced mark (settings "ivlog/synced") --- */
+
+static int history_set(const char *name, size_t len,
+		       settings_read_cb read_cb, void *cb_arg)
+{
+	if (!strcmp(name, "synced")) {
+		if (len != sizeof(saved_seq)) {
+			return -EINVAL;
+		}
+		return read_cb(cb_arg, &saved_seq, len);
+	}
+
+	return -ENOENT;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(iv_log, "ivlog", NULL, history_set, NULL,
+			       NULL);
+
+/* Apply the ack mark to the flash log, on history_wq; the mark is
+ * capped at what the log holds, and the rest waits for a flush
+ */
+static uint32_t apply_acked(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&tail_lock);
+	uint32_t acked = acked_seq;
+	struct iv_cursor cur;
+
+	k_spin_unlock(&tail_lock, key);
+
+	uint32_t seq = flash_log_advance_synced(acked);
+
+	flash_log_snapshot(&cur);
+	key = k_spin_lock(&tail_lock);
+	logged_start = cur.start;
+	k_spin_unlock(&tail_lock, key);
+	return seq;
+}
+
+/* Acks move the mark in RAM only; this work writes it out. An NVS write
+ * can block for an erase, so it stays off the BT threads.
+ */
+static void save_work_handler(struct k_work *work)
+{
+	uint32_t seq = apply_acked();
+	int err;
+
+	if (seq == saved_seq) {
+		return;
+	}
+	err = settings_save_one("ivlog/synced", &seq, sizeof(seq));
+	if (err) {
+		LOG_WRN("Synced mark not saved: %d", err);
+		return;
+	}
+	saved_seq = seq;
+}
+
+/* Save now at the end of a sync, else once SYNCED_SAVE_S after the
+ * first ack since the last save
+ */
+static void save_synced(bool now)
+{
+	if (now) {
+		k_work_reschedule_for_queue(&history_wq, &save_work, K_NO_WAIT);
+	} else {
+		k_work_schedule_for_queue(&history_wq, &save_work,
+					  K_SECONDS(SYNCED_SAVE_S));
+	}
+}
+
+static void ack_work_handler(struct k_work *work)
+{
+	apply_acked();
+	save_synced(false);
+}
+
+/* --- Flushing --- */
+
+/* Write buffered samples a chunk at a time. A short chunk is written
+ * only at a gap (the next sample starts a new run) or when forced.
+ */
+static int flush(bool force)
+{
+	uint8_t db[FLASH_LOG_CHUNK_SAMPLES];
+	int err = 0;
+
+	k_mutex_lock(&flush_mutex, K_FOREVER);
+
+	for (;;) {
+		int64_t base_ms;
+		uint32_t n = data_cache_peek_unflushed(db, ARRAY_SIZE(db),
+						       &base_ms);
+
+		if (n == 0 || (n < ARRAY_SIZE(db) && !force &&
+			       n == data_cache_unflushed())) {
+			break;
+		}
+
+		err = flash_log_append(base_ms + boot_offset_ms, db, n);
+		if (err) {
+			flush_errors++;
+			LOG_ERR("Flash log write failed: %d", err);
+			break;
+		}
+
+		k_spinlock_key_t key = k_spin_lock(&tail_lock);
+
+		data_cache_mark_flushed(n);
+		logged_seq += n;
+		k_spin_unlock(&tail_lock, key);
+
+		/* Acks that came in while these were in RAM only, and the
+		 * oldest sector the append may have recycled
+		 */
+		if (apply_acked() != saved_seq) {
+			save_synced(false);
+		}
+	}
+
+	k_mutex_unlock(&flush_mutex);
+	return err;
+}
+
+static void flush_work_handler(struct k_work *work)
+{
+	flush(false);
+}
+
+static void periodic_work_handler(struct k_work *work)
+{
+	flush(true);
+	k_work_schedule_for_queue(&history_wq, &periodic_work,
+				  K_SECONDS(CONFIG_IV_FLASH_LOG_FLUSH_S));
+}
+
+/* --- API --- */
+
+int history_init(void)
+{
+	const struct flash_area *fa;
+	int64_t start = k_uptime_get();
+	int err = flash_area_open(FIXED_PARTITION_ID(history_partition), &fa);
+
+	if (err) {
+		LOG_ERR("History partition unavailable: %d", err);
+		return err;
+	}
+
+	err = flash_log_init(fa);
+	if (err) {
+		LOG_ERR("Flash log recovery failed: %d", err);
+		return err;
+	}
+	recovery_ms = k_uptime_get() - start;
+
+	boot_offset_ms = flash_log_end_ms();
+	logged_seq = flash_log_end_seq();
+	acked_seq = saved_seq;
+	apply_acked();
+
+	k_work_queue_start(&history_wq, history_stack,
+			   K_THREAD_STACK_SIZEOF(history_stack),
+			   HISTORY_PRIORITY, NULL);
+	k_thread_name_set(&history_wq.thread, "history");
+	k_work_init(&flush_work, flush_work_handler);
+	k_work_init(&ack_work, ack_work_handler);
+	k_work_init_delayable(&periodic_work, periodic_work_handler);
+	k_work_init_delayable(&save_work, save_work_handler);
+	k_work_schedule_for_queue(&history_wq, &periodic_work,
+				  K_SECONDS(CONFIG_IV_FLASH_LOG_FLUSH_S));
+
+	ready = true;
+	LOG_INF("History: %u unsynced samples, recovered in %lld ms",
+		flash_log_count(), recovery_ms);
+	return 0;
+}
+
+void history_push(uint8_t db)
+{
+	data_cache_push(db);
+	if (ready && data_cache_unflushed() >= FLASH_LOG_CHUNK_SAMPLES) {
+		k_work_submit_to_queue(&history_wq, &flush_work);
+	}
+}
+
+int history_flush(void)
+{
+	return ready ? flush(true) : 0;
+}
+
+/* Sequence number after the newest sample, in flash or RAM */
+static uint32_t newest_end(void)
+{
+	return logged_seq + data_cache_unflushed();
+}
+
+/* Move the ack mark to seq, if it is not past the newest sample */
+static int mark_acked(uint32_t seq)
+{
+	k_spinlock_key_t key = k_spin_lock(&tail_lock);
+
+	if (seq > newest_end()) {
+		k_spin_unlock(&tail_lock, key);
+		return -ERANGE;
+	}
+	acked_seq = MAX(acked_seq, seq);
+	k_spin_unlock(&tail_lock, key);
+	return 0;
+}
+
+uint32_t history_count(void)
+{
+	if (!ready) {
+		return data_cache_count();
+	}
+
+	/* Read on the BT RX thread: no flash log mutex here */
+	k_spinlock_key_t key = k_spin_lock(&tail_lock);
+	uint32_t end = newest_end();
+	uint32_t start = MAX(logged_start, acked_seq);
+
+	k_spin_unlock(&tail_lock, key);
+	return end > start ? end - start : 0;
+}
+
+void history_snapshot(struct iv_cursor *cur, struct history_tail *tail)
+{
+	if (!ready) {
+		data_cache_snapshot(cur);
+		tail->seq = cur->end;
+		tail->count = 0;
+		return;
+	}
+
+	/* The RAM part first: a flush after this only moves samples the
+	 * tail already holds into flash, past the end taken here
+	 */
+	k_spinlock_key_t key = k_spin_lock(&tail_lock);
+	uint32_t acked = acked_seq;
+
+	tail->seq = logged_seq;
+	tail->count = data_cache_peek_unflushed(tail->db, ARRAY_SIZE(tail->db),
+						&tail->base_ms);
+	k_spin_unlock(&tail_lock, key);
+	tail->base_ms += boot_offset_ms;
+
+	flash_log_snapshot(cur);
+	cur->end = tail->seq + tail->count;
+	cur->start = MIN(MAX(cur->start, acked), cur->end);
+}
+
+int history_read(const struct iv_cursor *cur, const struct history_tail *tail,
+		 uint32_t start, struct iv_sample *buf, uint32_t n)
+{
+	if (!ready) {
+		return data_cache_read(cur, start, buf, n);
+	}
+	if (start >= iv_cursor_count(cur)) {
+		return 0;
+	}
+
+	uint32_t seq = cur->start + start;
+
+	if (seq < tail->seq) {
+		const struct iv_cursor logged = {
+			.start = cur->start,
+			.end = tail->seq,
+		};
+
+		return flash_log_read(&logged, start, buf, n);
+	}
+
+	uint32_t off = seq - tail->seq;
+
+	n = MIN(n, tail->count - off);
+	for (uint32_t i = 0; i < n; i++) {
+		buf[i].uptime_ms = (uint32_t)(tail->base_ms +
+					      (int64_t)(off + i) *
+					      CACHE_INTERVAL_MS);
+		buf[i].db = tail->db[off + i];
+	}
+	return (int)n;
+}
+
+void history_release(const struct iv_cursor *cur)
+{
+	if (!ready) {
+		data_cache_release(cur);
+		return;
+	}
+
+	mark_acked(cur->end);
+	save_synced(true);
+}
+
+int history_ack(uint32_t seq)
+{
+	if (!ready) {
+		return data_cache_ack(seq);
+	}
+
+	/* Called on the BT RX thread: the flash log is updated on
+	 * history_wq, never under its mutex here
+	 */
+	int err = mark_acked(seq);
+
+	if (err) {
+		return err;
+	}
+	k_work_submit_to_queue(&history_wq, &ack_work);
+	return 0;
+}
+
+void history_clear(void)
+{
+	if (!ready) {
+		data_cache_clear();
+		return;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&tail_lock);
+
+	acked_seq = MAX(acked_seq, newest_end());
+	k_spin_unlock(&tail_lock, key);
+	save_synced(true);
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_iv_log(const struct shell *sh, size_t argc, char **argv)
+{
+	struct flash_log_stats st;
+
+	if (!ready) {
+		shell_error(sh, "Flash log not available");
+		return -ENODEV;
+	}
+
+	if (argc == 2 && !strcmp(argv[1], "flush")) {
+		int err = history_flush();
+
+		if (err) {
+			shell_error(sh, "Flush failed: %d", err);
+			return err;
+		}
+	}
+
+	flash_log_get_stats(&st);
+
+	uint64_t consumed = st.pages_written * FLASH_LOG_PAGE_SIZE;
+
+	shell_print(sh, "sectors     %u/%u used, %u erased since boot",
+		    st.sectors_used, st.sectors, st.erases);
+	shell_print(sh, "samples     %u in flash, %u unsynced, %u in RAM only",
+		    st.end_seq - st.oldest_seq, flash_log_count(),
+		    data_cache_unflushed());
+	shell_print(sh, "written     %llu samples, %llu pages (%u.%02ux)",
+		    st.payload_bytes, st.pages_written,
+		    st.payload_bytes ? (uint32_t)(consumed / st.payload_bytes) : 0,
+		    st.payload_bytes ?
+		    (uint32_t)(consumed * 100 / st.payload_bytes % 100) : 0);
+	shell_print(sh, "recovery    %lld ms, %u reads, %u bytes, %u torn",
+		    recovery_ms, st.recovery_reads, st.recovery_bytes,
+		    st.torn_chunks);
+	shell_print(sh, "errors      %u", flush_errors);
+	return 0;
+}
+
+SHELL_SUBCMD_ADD((iv), log, NULL,
+		 "Flash history log: log [flush]", cmd_iv_log, 1, 1);
+#endif
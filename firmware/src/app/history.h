@@ -0,0 +1,120 @@
+#ifndef APP_HISTORY_H
+#define APP_HISTORY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "data_cache.h"
+
+/*
+ * The dB history offered to sync.
+ *
+ * With CONFIG_IV_FLASH_LOG the RAM cache is the write buffer of the
+ * flash log: samples are flushed a page at a time (or at a capture gap,
+ * or after CONFIG_IV_FLASH_LOG_FLUSH_S), sync reads from flash and a
+ * clear only moves a persistent synced mark. Timestamps then continue
+ * across resets from the last logged sample, as there is no RTC.
+ * Without it, history is the RAM cache.
+ *
+ * A sync does not wait for a flush: its snapshot ends with the samples
+ * still in RAM only, copied into a history_tail, which carry the
+ * sequence numbers the flash log will give them.
+ */
+
+#if defined(CONFIG_IV_FLASH_LOG)
+#define HISTORY_TAIL_SAMPLES 232  /* One flash log chunk */
+#else
+#define HISTORY_TAIL_SAMPLES 1    /* Unused: history is the RAM cache */
+#endif
+
+/* Samples of a snapshot not yet in flash, [seq, seq + count) */
+struct history_tail {
+	uint32_t seq;
+	uint32_t count;
+	int64_t  base_ms;  /* Log time of the first */
+	uint8_t  db[HISTORY_TAIL_SAMPLES];
+};
+
+#if defined(CONFIG_IV_FLASH_LOG)
+
+/**
+ * Recover the flash log. Call after app_config_init() so the synced
+ * mark has been loaded from settings.
+ *
+ * @return 0 on success, negative errno on failure.
+ */
+int history_init(void);
+
+/** Cache one sample and schedule a flush once a page is buffered. */
+void history_push(uint8_t db);
+
+/** Write every buffered sample to flash (`iv log flush`). */
+int history_flush(void);
+
+/** Number of unsynced samples, in flash or RAM; does not block. */
+uint32_t history_count(void);
+
+/**
+ * Snapshot the unsynced samples for a sync, without flushing: those in
+ * flash stay there, and up to HISTORY_TAIL_SAMPLES of the ones after are
+ * copied from the RAM cache into tail. Later samples wait for the next
+ * sync.
+ */
+void history_snapshot(struct iv_cursor *cur, struct history_tail *tail);
+
+/**
+ * Copy samples out of a snapshot, oldest first.
+ *
+ * @return Number of samples copied, 0 at the end of the snapshot, or a
+ *         negative errno if the sample at start cannot be read (skip it).
+ */
+int history_read(const struct iv_cursor *cur, const struct history_tail *tail,
+		 uint32_t start, struct iv_sample *buf, uint32_t n);
+
+/** Mark the samples of a snapshot as synced; later ones are kept. */
+void history_release(const struct iv_cursor *cur);
+
+/**
+ * Mark every sample before sequence number seq as synced, including
+ * ones still in RAM. Only the RAM mark moves here, under a spinlock; the
+ * history workqueue applies it to the flash log and saves it to settings
+ * later, so this neither blocks nor takes the flash log's mutex.
+ *
+ * @return 0, also if they already were; -ERANGE if seq is past the
+ *         newest sample.
+ */
+int history_ack(uint32_t seq);
+
+/** Mark everything, in flash or RAM, as synced. */
+void history_clear(void);
+
+#else
+
+static inline int history_init(void) { return 0; }
+static inline void history_push(uint8_t db) { data_cache_push(db); }
+static inline int history_flush(void) { return 0; }
+static inline uint32_t history_count(void) { return data_cache_count(); }
+static inline void history_snapshot(struct iv_cursor *cur,
+				    struct history_tail *tail)
+{
+	data_cache_snapshot(cur);
+	tail->seq = cur->end;
+	tail->count = 0;
+}
+static inline int history_read(const struct iv_cursor *cur,
+			       const struct history_tail *tail,
+			       uint32_t start, struct iv_sample *buf,
+			       uint32_t n)
+{
+	return data_cache_read(cur, start, buf, n);
+}
+static inline void history_release(const struct iv_cursor *cur)
+{
+	data_cache_release(cur);
+}
+static inline int history_ack(uint32_t seq) { return data_cache_ack(seq); }
+static inline void history_clear(void) { data_cache_clear(); }
+
+#endif /* CONFIG_IV_FLASH_LOG */
+
+#endif /* APP_HISTORY_H */
@@ -0,0 +1,147 @@
+#include "level_detector.h"
+#include "profiler.h"
+#include "../audio/sound_level.h"
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/sys/util.h>
+
+/*
+ * Streaming threshold detector.
+ *
+ * Sums of squares are accumulated per sub-frame and kept in a small ring,
+ * so the sliding-window RMS costs one add and one subtract per sub-frame
+ * regardless of window length. A sub-frame may straddle two PDM blocks;
+ * the partial sum is carried over in partial_sum/partial_count.
+ */
+
+int level_detector_init(struct level_detector *det,
+			const struct level_det_cfg *cfg)
+{
+	if (cfg->subframe_ms == 0 || cfg->sample_rate == 0) {
+		return -EINVAL;
+	}
+
+	/* Longer windows are clamped rather than rejected, so any
+	 * CONFIG_IV_LEVEL_WINDOW_MS still starts the monitor
+	 */
+	uint32_t frames = CLAMP(cfg->window_ms / cfg->subframe_ms, 1U,
+				LEVEL_DET_MAX_WINDOW_FRAMES);
+
+	memset(det, 0, sizeof(*det));
+	det->cfg = *cfg;
+	det->subframe_samples = cfg->sample_rate * cfg->subframe_ms / 1000;
+	det->window_frames = (uint8_t)frames;
+
+	if (det->subframe_samples == 0) {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+void level_detector_reset(struct level_detector *det)
+{
+	memset(det->frame_sum, 0, sizeof(det->frame_sum));
+	det->window_sum = 0;
+	det->frame_idx = 0;
+	det->frames_filled = 0;
+	det->partial_sum = 0;
+	det->partial_count = 0;
+	det->over_ms = 0;
+	det->under_ms = 0;
+}
+
+/* Push a completed sub-frame and return true if the active state changed */
+static bool subframe_done(struct level_detector *det, uint64_t sum,
+			  uint8_t threshold_db, bool gate)
+{
+	det->window_sum -= det->frame_sum[det->frame_idx];
+	det->frame_sum[det->frame_idx] = sum;
+	det->window_sum += sum;
+	det->frame_idx = (det->frame_idx + 1) % det->window_frames;
+	if (det->frames_filled < det->window_frames) {
+		det->frames_filled++;
+	}
+
+	PROF_START(t_db);
+	uint16_t rms = sound_level_rms_from_sum(
+		det->window_sum, det->frames_filled * det->subframe_samples);
+
+	det->window_db = sound_level_rms_to_db(rms);
+	PROF_END(PROF_STAGE_DB, t_db);
+
+	/* A loud sub-frame the VAD rejects holds both timers: it can delay
+	 * an attack, but never counts towards a release
+	 */
+	if (det->window_db >= threshold_db && !gate) {
+		return false;
+	}
+
+	if (det->window_db >= threshold_db) {
+		det->over_ms += det->cfg.subframe_ms;
+		det->under_ms = 0;
+
+		if (!det->active && det->over_ms >= det->cfg.attack_ms) {
+			det->active = true;
+			return true;
+		}
+	} else {
+		det->under_ms += det->cfg.subframe_ms;
+		det->over_ms = 0;
+
+		if (det->active && det->under_ms >= det->cfg.release_ms) {
+			det->active = false;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void level_detector_process(struct level_detector *det,
+			    const int16_t *samples, size_t count,
+			    uint8_t threshold_db, bool gate,
+			    struct level_det_result *res)
+{
+	bool was_active = det->active;
+	uint64_t block_sum = 0;
+	size_t pos = 0;
+
+	res->event = LEVEL_DET_EVENT_NONE;
+	res->event_db = 0;
+	res->event_offset = 0;
+
+	while (pos < count) {
+		size_t need = det->subframe_samples - det->partial_count;
+		size_t n = MIN(need, count - pos);
+		PROF_START(t_rms);
+		uint64_t sum = sound_level_sum_sq(&samples[pos], n);
+
+		PROF_END(PROF_STAGE_RMS, t_rms);
+
+		block_sum += sum;
+		det->partial_sum += sum;
+		det->partial_count += n;
+		pos += n;
+
+		if (det->partial_count < det->subframe_samples) {
+			break;
+		}
+
+		if (subframe_done(det, det->partial_sum, threshold_db, gate)) {
+			res->event_db = det->window_db;
+			res->event_offset = pos;
+		}
+		det->partial_sum = 0;
+		det->partial_count = 0;
+	}
+
+	if (det->active != was_active) {
+		res->event = det->active ? LEVEL_DET_EVENT_TRIGGER
+					 : LEVEL_DET_EVENT_RELEASE;
+	}
+
+	res->block_db = sound_level_rms_to_db(
+		sound_level_rms_from_sum(block_sum, count));
+}
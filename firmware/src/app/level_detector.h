@@ -0,0 +1,95 @@
+#ifndef APP_LEVEL_DETECTOR_H
+#define APP_LEVEL_DETECTOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Upper bound on sub-frames held in the sliding RMS window */
+#define LEVEL_DET_MAX_WINDOW_FRAMES 16
+
+enum level_det_event {
+	LEVEL_DET_EVENT_NONE,
+	LEVEL_DET_EVENT_TRIGGER,   /* Level held over threshold for attack_ms */
+	LEVEL_DET_EVENT_RELEASE,   /* Level held under threshold for release_ms */
+};
+
+struct level_det_cfg {
+	uint32_t sample_rate;  /* Hz */
+	uint16_t subframe_ms;  /* Decision granularity */
+	uint16_t window_ms;    /* Sliding RMS window, 1-16 whole sub-frames */
+	uint16_t attack_ms;    /* Time over threshold before triggering */
+	uint16_t release_ms;   /* Time under threshold before releasing */
+};
+
+struct level_detector {
+	struct level_det_cfg cfg;
+	uint32_t subframe_samples;
+	uint8_t  window_frames;
+
+	/* Sliding window of per-sub-frame sums of squares */
+	uint64_t frame_sum[LEVEL_DET_MAX_WINDOW_FRAMES];
+	uint64_t window_sum;
+	uint8_t  frame_idx;
+	uint8_t  frames_filled;
+
+	/* Sub-frame carried across block boundaries */
+	uint64_t partial_sum;
+	uint32_t partial_count;
+
+	uint32_t over_ms;
+	uint32_t under_ms;
+	bool     active;
+	uint8_t  window_db;
+};
+
+struct level_det_result {
+	uint8_t  block_db;      /* Level of the whole block */
+	uint8_t  event_db;      /* Window level when the event fired */
+	enum level_det_event event;
+	uint32_t event_offset;  /* Sample index in the block of the event */
+};
+
+/**
+ * Initialize a streaming level detector.
+ *
+ * Each block passed to level_detector_process() is cut into sub-frames of
+ * subframe_ms. After every sub-frame the detector re-evaluates a sliding
+ * RMS over the last window_ms and advances the attack/release timers, so
+ * decisions are made at sub-frame rather than block granularity.
+ *
+ * @param det  Detector state.
+ * @param cfg  Timing configuration.
+ * @return 0 on success, -EINVAL for a zero rate or a sub-frame shorter
+ *         than one sample.
+ */
+int level_detector_init(struct level_detector *det,
+			const struct level_det_cfg *cfg);
+
+/**
+ * Drop the sliding window and hysteresis timers (e.g. after a capture gap).
+ * The active/inactive state is kept.
+ */
+void level_detector_reset(struct level_detector *det);
+
+/**
+ * Run one PCM block through the detector.
+ *
+ * If the state toggles more than once inside a block only the net change
+ * is reported.
+ *
+ * @param det           Detector state.
+ * @param samples       Signed 16-bit PCM block.
+ * @param count         Number of samples.
+ * @param threshold_db  Trigger threshold in dB.
+ * @param gate          When false, sub-frames over threshold hold the
+ *                      attack and release timers instead of counting as
+ *                      over (e.g. the VAD found no speech in this block).
+ * @param res           Output: block level and any state change.
+ */
+void level_detector_process(struct level_detector *det,
+			    const int16_t *samples, size_t count,
+			    uint8_t threshold_db, bool gate,
+			    struct level_det_result *res);
+
+#endif /* APP_LEVEL_DETECTOR_H */
@@ -0,0 +1,53 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/sys/byteorder.h>
+#include "level_feed.h"
+
+int level_feed_set(struct level_feed *f, uint8_t mode, uint8_t arg)
+{
+	if (mode >= LEVEL_FEED_MODE_COUNT ||
+	    (mode == LEVEL_FEED_BATCH &&
+	     (arg == 0 || arg > LEVEL_FEED_BATCH_MAX)) ||
+	    (mode == LEVEL_FEED_CHANGE && arg == 0)) {
+		return -EINVAL;
+	}
+
+	*f = (struct level_feed){
+		.mode = mode,
+		.arg = arg,
+		.last = -1,
+	};
+	return 0;
+}
+
+uint16_t level_feed_push(struct level_feed *f, uint8_t db, uint8_t *out)
+{
+	uint16_t seq = f->seq++;
+
+	switch (f->mode) {
+	case LEVEL_FEED_BATCH:
+		if (f->n == 0) {
+			sys_put_le16(seq, f->batch);
+		}
+		f->batch[2 + f->n++] = db;
+		if (f->n < f->arg) {
+			return 0;
+		}
+		memcpy(out, f->batch, 2 + f->n);
+		f->n = 0;
+		return 2 + f->arg;
+
+	case LEVEL_FEED_CHANGE:
+		if (f->last >= 0 && abs(db - f->last) < f->arg) {
+			return 0;
+		}
+		f->last = db;
+		out[0] = db;
+		return 1;
+
+	default:
+		out[0] = db;
+		return 1;
+	}
+}
@@ -0,0 +1,52 @@
+#ifndef APP_LEVEL_FEED_H
+#define APP_LEVEL_FEED_H
+
+#include <stdint.h>
+
+/*
+ * Packs the live level stream (one level per notify interval) into
+ * Sound Level notifications, trading latency for radio wake-ups:
+ *
+ *   - STREAM: every level, one byte each (the original behaviour)
+ *   - BATCH:  arg levels per notification, [seq_le16, level...], where
+ *             seq numbers the first level so the app can spot losses
+ *   - CHANGE: one byte, only when the level has moved at least arg dB
+ *             from the last one sent
+ */
+#define LEVEL_FEED_BATCH_MAX 18  /* Fills a notification at the default MTU */
+#define LEVEL_FEED_MAX_SIZE  (2 + LEVEL_FEED_BATCH_MAX)
+
+enum level_feed_mode {
+	LEVEL_FEED_STREAM,
+	LEVEL_FEED_BATCH,
+	LEVEL_FEED_CHANGE,
+	LEVEL_FEED_MODE_COUNT,
+};
+
+struct level_feed {
+	uint8_t  mode;
+	uint8_t  arg;
+	uint16_t seq;   /* Levels pushed since the last set */
+	uint8_t  n;     /* Levels in the open batch */
+	int16_t  last;  /* Last level sent in CHANGE mode, -1 before one */
+	uint8_t  batch[LEVEL_FEED_MAX_SIZE];
+};
+
+/**
+ * Select a mode and start afresh.
+ *
+ * @param arg  BATCH: levels per notification, 1..LEVEL_FEED_BATCH_MAX.
+ *             CHANGE: minimum step in dB, at least 1. STREAM: ignored.
+ * @return 0 on success, -EINVAL for an unknown mode or bad argument.
+ */
+int level_feed_set(struct level_feed *f, uint8_t mode, uint8_t arg);
+
+/**
+ * Add the next level.
+ *
+ * @param out  LEVEL_FEED_MAX_SIZE bytes for a notification.
+ * @return Length of the notification to send now, 0 for none.
+ */
+uint16_t level_feed_push(struct level_feed *f, uint8_t db, uint8_t *out);
+
+#endif /* APP_LEVEL_FEED_H */
@@ -0,0 +1,171 @@
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+#endif
+#include "level_stats.h"
+
+/* 10^(-k/10) in Q24 for k = 0..LEVEL_STATS_BINS-1: the energy of a level
+ * k dB below a reference
+ */
+static const uint32_t energy_q24[LEVEL_STATS_BINS] = {
+	16777216, 13326616, 10585708, 8408526, 6679130, 5305422, 4214246, 3347495,
+	2659010, 2112126, 1677722, 1332662, 1058571, 840853, 667913, 530542,
+	421425, 334749, 265901, 211213, 167772, 133266, 105857, 84085,
+	66791, 53054, 42142, 33475, 26590, 21121, 16777, 13327,
+	10586, 8409, 6679, 5305, 4214, 3347, 2659, 2112,
+	1678, 1333, 1059, 841, 668, 531, 421, 335,
+	266, 211, 168, 133, 106, 84, 67, 53,
+	42, 33, 27, 21, 17, 13, 11, 8,
+	7, 5, 4, 3, 3, 2, 2, 1,
+	1, 1, 1, 1, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0,
+};
+
+static uint32_t hist_ms[LEVEL_STATS_BINS];
+static uint32_t total_ms;
+static uint32_t over_ms;
+static uint32_t episodes;
+static bool     over;
+
+/* Updated per block by the monitor thread, read over BLE and shell */
+K_MUTEX_DEFINE(stats_mutex);
+
+void level_stats_update(uint8_t db, uint32_t ms, enum level_det_event event)
+{
+	k_mutex_lock(&stats_mutex, K_FOREVER);
+
+	if (event == LEVEL_DET_EVENT_TRIGGER) {
+		over = true;
+		episodes++;
+	} else if (event == LEVEL_DET_EVENT_RELEASE) {
+		over = false;
+	}
+
+	hist_ms[MIN(db, LEVEL_STATS_BINS - 1)] += ms;
+	total_ms += ms;
+	if (over) {
+		over_ms += ms;
+	}
+
+	k_mutex_unlock(&stats_mutex);
+}
+
+/* Lowest level exceeded for at least pct percent of the time */
+static uint8_t percentile(uint32_t pct)
+{
+	uint64_t target = (uint64_t)total_ms * pct;
+	uint64_t above = 0;
+
+	for (int d = LEVEL_STATS_BINS - 1; d > 0; d--) {
+		above += (uint64_t)hist_ms[d] * 100U;
+		if (above >= target) {
+			return (uint8_t)d;
+		}
+	}
+	return 0;
+}
+
+/* 10 * log10(r / 2^24) in 0.1 dB, negated, for 0 < r <= 2^24 */
+static uint32_t attenuation_ddb(uint32_t r)
+{
+	for (uint32_t k = 0; k + 1 < LEVEL_STATS_BINS; k++) {
+		uint32_t hi = energy_q24[k];
+		uint32_t lo = energy_q24[k + 1];
+
+		if (r > lo) {
+			/* Linear between whole dB */
+			return k * 10U + (hi - MIN(r, hi)) * 10U / (hi - lo);
+		}
+	}
+	return (LEVEL_STATS_BINS - 1) * 10U;
+}
+
+void level_stats_get(struct level_stats *out)
+{
+	*out = (struct level_stats){ 0 };
+
+	k_mutex_lock(&stats_mutex, K_FOREVER);
+
+	out->duration_ms = total_ms;
+	out->over_ms = over_ms;
+	out->episodes = episodes;
+
+	if (total_ms == 0) {
+		k_mutex_unlock(&stats_mutex);
+		return;
+	}
+
+	int dmax = LEVEL_STATS_BINS - 1;
+
+	while (dmax > 0 && hist_ms[dmax] == 0) {
+		dmax--;
+	}
+
+	/* Energy relative to the loudest level present, ms x Q24 */
+	uint64_t energy = 0;
+
+	for (int d = 0; d <= dmax; d++) {
+		energy += (uint64_t)hist_ms[d] * energy_q24[dmax - d];
+	}
+
+	out->lmax_db = (uint8_t)dmax;
+	out->l10_db = percentile(10);
+	out->l50_db = percentile(50);
+	out->l90_db = percentile(90);
+
+	uint32_t att = attenuation_ddb((uint32_t)(energy / total_ms));
+
+	out->leq_ddb = (uint16_t)(dmax * 10U > att ? dmax * 10U - att : 0);
+
+	/* Dose: time at the loudest level, scaled to the criterion level */
+	uint64_t at_max_ms = energy >> 24;
+	uint64_t at_crit_ms = dmax <= LEVEL_STATS_DOSE_DB ?
+		(at_max_ms * energy_q24[LEVEL_STATS_DOSE_DB - dmax]) >> 24 :
+		(at_max_ms << 24) / energy_q24[dmax - LEVEL_STATS_DOSE_DB];
+
+	out->dose_cpct = (uint32_t)MIN(at_crit_ms * 10000U / LEVEL_STATS_DOSE_MS,
+				       UINT32_MAX);
+
+	k_mutex_unlock(&stats_mutex);
+}
+
+void level_stats_reset(void)
+{
+	k_mutex_lock(&stats_mutex, K_FOREVER);
+	for (int d = 0; d < LEVEL_STATS_BINS; d++) {
+		hist_ms[d] = 0;
+	}
+	total_ms = 0;
+	over_ms = 0;
+	episodes = 0;
+	k_mutex_unlock(&stats_mutex);
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_iv_exposure(const struct shell *sh, size_t argc, char **argv)
+{
+	struct level_stats st;
+
+	if (argc == 2 && !strcmp(argv[1], "reset")) {
+		level_stats_reset();
+	}
+
+	level_stats_get(&st);
+	shell_print(sh, "duration  %u s", st.duration_ms / 1000U);
+	shell_print(sh, "leq       %u.%u dB", st.leq_ddb / 10U, st.leq_ddb % 10U);
+	shell_print(sh, "l10/50/90 %u / %u / %u dB, max %u dB", st.l10_db,
+		    st.l50_db, st.l90_db, st.lmax_db);
+	shell_print(sh, "over      %u s in %u episodes", st.over_ms / 1000U,
+		    st.episodes);
+	shell_print(sh, "dose      %u.%02u %%", st.dose_cpct / 100U,
+		    st.dose_cpct % 100U);
+	return 0;
+}
+
+SHELL_SUBCMD_ADD((iv), exposure, NULL,
+		 "Session level statistics: exposure [reset]", cmd_iv_exposure,
+		 1, 1);
+#endif
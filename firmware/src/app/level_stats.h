@@ -0,0 +1,48 @@
+#ifndef APP_LEVEL_STATS_H
+#define APP_LEVEL_STATS_H
+
+#include <stdint.h>
+
+#include "level_detector.h"
+
+/*
+ * Running noise-exposure statistics for the current session, kept as a
+ * time-weighted histogram of block levels (1 dB bins) plus threshold
+ * episode counters. An update is O(1); the levels are derived from the
+ * histogram when read.
+ */
+#define LEVEL_STATS_BINS 91  /* sound_level_rms_to_db() range, 0–90 dB */
+
+/* Nominal dose criterion: 85 dB for 8 hours, 3 dB exchange rate */
+#define LEVEL_STATS_DOSE_DB 85
+#define LEVEL_STATS_DOSE_MS (8U * 3600U * 1000U)
+
+struct level_stats {
+	uint32_t duration_ms;  /* Time covered, capture gaps included */
+	uint16_t leq_ddb;      /* Energy-average level, 0.1 dB */
+	uint8_t  l10_db;       /* Level exceeded 10% of the time */
+	uint8_t  l50_db;
+	uint8_t  l90_db;
+	uint8_t  lmax_db;
+	uint32_t over_ms;      /* Time in the triggered state */
+	uint32_t episodes;     /* Threshold triggers */
+	uint32_t dose_cpct;    /* Dose against the criterion, 0.01 % */
+};
+
+/**
+ * Add one analysed block.
+ *
+ * @param db     Block level.
+ * @param ms     Block duration plus the capture gap before it; a gap
+ *               is only taken in quiet, so it counts at this level.
+ * @param event  Level detector event for the block.
+ */
+void level_stats_update(uint8_t db, uint32_t ms, enum level_det_event event);
+
+/** Current statistics; all zero before the first block. */
+void level_stats_get(struct level_stats *out);
+
+/** Start a new session. The triggered state carries over. */
+void level_stats_reset(void);
+
+#endif /* APP_LEVEL_STATS_H */
@@ -1,114 +1,366 @@
 #include "monitor.h"
+#include "analysis.h"
+#include "block_queue.h"
 #include "config.h"
 #include "data_cache.h"
+#include "history.h"
+#include "level_stats.h"
+#include "profiler.h"
+#include "rollup.h"
 #include "../audio/pdm_capture.h"
-#include "../audio/sound_level.h"
+#include "../audio/band_analyzer.h"
+#include "../audio/capture_sched.h"
 #include "../feedback/led.h"
 #include "../feedback/vibration.h"
+#include "../ble/ble_manager.h"
 #include "../ble/config_service.h"
 
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#if defined(CONFIG_SHELL)
+#include <stdlib.h>
+#include <zephyr/shell/shell.h>
+#endif
 
 LOG_MODULE_REGISTER(monitor, LOG_LEVEL_INF);
 
 #define MONITOR_STACK_SIZE 2048
 #define MONITOR_PRIORITY   5
 
-/* Hysteresis: require N consecutive blocks over/under threshold */
-#define HYSTERESIS_COUNT 3
+/* Capture only shuffles slab pointers, so it runs above analysis */
+#define CAPTURE_STACK_SIZE 1024
+#define CAPTURE_PRIORITY   4
 
-static void monitor_thread_fn(void *p1, void *p2, void *p3)
+/* One cache sample per duty period needs a period within the interval */
+#if defined(CONFIG_IV_CAPTURE_DUTY_CYCLE)
+BUILD_ASSERT(CONFIG_IV_CAPTURE_DUTY_PERIOD_MS <= CACHE_INTERVAL_MS,
+	     "Duty-cycle period longer than the cache interval");
+#endif
+
+/*
+ * Keep at least two slab blocks free for the DMIC driver: the blocks the
+ * app holds, queued plus the one under analysis, may use the rest. If
+ * analysis falls this far behind, new blocks are dropped instead of
+ * queued. The slab geometry can change at runtime, so this is evaluated
+ * per block.
+ */
+static uint32_t held_limit(void)
+{
+	return MIN(BLOCK_QUEUE_SIZE, pdm_capture_num_blocks() - 2);
+}
+
+static struct block_queue queue;
+static K_SEM_DEFINE(queue_sem, 0, BLOCK_QUEUE_SIZE);
+
+/* 1 while the monitor holds a block; set before it leaves the queue so
+ * the capture thread may overcount by one, never undercount
+ */
+static atomic_t analysing;
+
+/* Pipeline counters; capture-side fields are atomics, the monitor-side
+ * ones change together under stat_lock so a reader never sees a 64-bit
+ * sum torn or out of step with stat_blocks
+ */
+static atomic_t stat_dropped;
+static atomic_t stat_queue_hwm;
+static struct k_spinlock stat_lock;
+static uint32_t stat_blocks;
+static uint64_t stat_queue_lat_sum;
+static uint32_t stat_queue_lat_max;
+static uint64_t stat_analysis_sum;
+static uint32_t stat_analysis_max;
+
+static struct analysis analysis;
+
+static void capture_thread_fn(void *p1, void *p2, void *p3)
 {
 	ARG_UNUSED(p1);
 	ARG_UNUSED(p2);
 	ARG_UNUSED(p3);
 
-	int over_count = 0;
-	int under_count = 0;
-	bool feedback_active = false;
-	static int block_count = 0;
-	static uint32_t db_accum = 0;
-
-	int err = pdm_capture_start();
+	int err = capture_sched_start();
 
 	if (err) {
 		LOG_ERR("Failed to start PDM capture: %d", err);
 		return;
 	}
 
-	LOG_INF("Monitor thread running");
-
 	while (1) {
-		void *buf;
-		size_t size;
+		struct pdm_block blk;
 
-		err = pdm_capture_read(&buf, &size);
+		err = capture_sched_read(&blk.buf, &blk.size, &blk.gap_ms);
 		if (err) {
 			k_sleep(K_MSEC(100));
 			continue;
 		}
+		blk.captured_at = k_cycle_get_32();
+#if defined(CONFIG_IV_PROFILER)
+		blk.read_cyc = DWT->CYCCNT;
+#endif
 
-		size_t sample_count = size / sizeof(int16_t);
-		uint16_t rms = sound_level_rms((const int16_t *)buf, sample_count);
-		uint8_t db = sound_level_rms_to_db(rms);
+		if (block_queue_count(&queue) + atomic_get(&analysing) >=
+		    held_limit() || !block_queue_put(&queue, &blk)) {
+			pdm_capture_buf_free(blk.buf);
+			atomic_inc(&stat_dropped);
+			continue;
+		}
 
-		pdm_capture_buf_free(buf);
+		uint32_t depth = block_queue_count(&queue);
+
+		if (depth > (uint32_t)atomic_get(&stat_queue_hwm)) {
+			atomic_set(&stat_queue_hwm, depth);
+		}
 
-		/* Notify BLE clients of current level */
-		config_service_notify_level(db);
+		k_sem_give(&queue_sem);
+	}
+}
 
-		db_accum += db;
-		block_count++;
-		if (block_count >= 10) {
-			uint8_t avg_db = (uint8_t)(db_accum / block_count);
-			data_cache_push(avg_db);
-			block_count = 0;
-			db_accum = 0;
+static void monitor_thread_fn(void *p1, void *p2, void *p3)
+{
+	ARG_UNUSED(p1);
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+#if defined(CONFIG_IV_BAND_ANALYZER)
+	uint32_t band_ms = 0;
+#endif
+
+	uint32_t rate = pdm_capture_sample_rate();
+
+	LOG_INF("Monitor thread running at %u Hz", rate);
+
+	while (1) {
+		struct pdm_block blk;
+
+		k_sem_take(&queue_sem, K_FOREVER);
+		atomic_set(&analysing, 1);
+		if (!block_queue_get(&queue, &blk)) {
+			atomic_set(&analysing, 0);
+			continue;
 		}
 
+		uint32_t start = k_cycle_get_32();
+
+		PROF_END(PROF_STAGE_READ, blk.read_cyc);
+		PROF_START(t_block);
+		uint32_t queue_us = k_cyc_to_us_floor32(start - blk.captured_at);
+		void *buf = blk.buf;
+		uint32_t gap_ms = blk.gap_ms;
+		size_t sample_count = blk.size / sizeof(int16_t);
+
 		/* Get current config */
 		struct app_config cfg = app_config_get();
+		struct analysis_result ares;
+
+		/* Spectrum is taken before weighting so rumble stays visible */
+#if defined(CONFIG_IV_BAND_ANALYZER)
+		PROF_START(t_bands);
+		band_analyzer_process((const int16_t *)buf, sample_count);
+		PROF_END(PROF_STAGE_BANDS, t_bands);
+#endif
+
+		analysis_process(&analysis, (int16_t *)buf, sample_count, gap_ms,
+				 cfg.threshold_db, cfg.weighting, &ares);
+
+		const struct level_det_result *res = &ares.level;
+		uint8_t db = res->block_db;
+
+		pdm_capture_buf_free(buf);
+		atomic_set(&analysing, 0);
+
+		level_stats_update(db, gap_ms + sample_count * 1000 / rate,
+				   res->event);
+
+		/* Notify BLE clients of the loudest block per interval
+		 * (deferred to a work item), whatever the block duration.
+		 */
+		if (ares.notify) {
+			PROF_START(t_notify);
+			config_service_notify_level(ares.notify_db);
+			ble_manager_broadcast_level(ares.notify_db,
+						    analysis_is_active(&analysis));
+			PROF_END(PROF_STAGE_NOTIFY, t_notify);
+		}
+
+		/* 1 Hz cache averaging, counted in time. A duty period is at
+		 * most one interval, so duty-cycled gaps still give one sample
+		 * per second; a longer gap (a geometry change) gives none for
+		 * the intervals it skipped, and the cache starts a segment.
+		 */
+		if (ares.cache) {
+			PROF_START(t_cache);
+			history_push(ares.cache_db);
+			PROF_END(PROF_STAGE_CACHE, t_cache);
+		}
+
+		capture_sched_update(db, cfg.threshold_db,
+				     analysis_is_active(&analysis));
+
+#if defined(CONFIG_IV_BAND_ANALYZER)
+		band_ms += gap_ms + sample_count * 1000 / rate;
+		if (band_ms >= CONFIG_IV_BAND_NOTIFY_INTERVAL_MS) {
+			uint8_t bands[BAND_COUNT];
 
-		/* Threshold comparison with hysteresis */
-		if (db >= cfg.threshold_db) {
-			over_count++;
-			under_count = 0;
-
-			if (!feedback_active && over_count >= HYSTERESIS_COUNT) {
-				feedback_active = true;
-				LOG_INF("Over threshold (%u dB >= %u dB)",
-					db, cfg.threshold_db);
-
-				if (cfg.feedback_mode & FEEDBACK_MODE_LED) {
-					led_set_pattern(LED_PATTERN_PULSE_WARM);
-				}
-				if (cfg.feedback_mode & FEEDBACK_MODE_VIBRATION) {
-					vibration_play(VIB_PATTERN_GENTLE_TAP);
-				}
+			if (band_analyzer_read(bands) > 0) {
+				config_service_notify_bands(bands);
 			}
-		} else {
-			under_count++;
-			over_count = 0;
+			band_ms = 0;
+		}
+#endif
 
-			if (feedback_active && under_count >= HYSTERESIS_COUNT) {
-				feedback_active = false;
-				LOG_INF("Under threshold (%u dB < %u dB)",
-					db, cfg.threshold_db);
+		/* Threshold comparison with attack/release hysteresis */
+		PROF_START(t_feedback);
+		if (res->event == LEVEL_DET_EVENT_TRIGGER) {
+			LOG_INF("Over threshold (%u dB >= %u dB)",
+				res->event_db, cfg.threshold_db);
 
-				led_set_pattern(LED_PATTERN_BREATHE_GREEN);
-				vibration_stop();
+			if (cfg.feedback_mode & FEEDBACK_MODE_LED) {
+				led_set_pattern(LED_PATTERN_PULSE_WARM);
+			}
+			if (cfg.feedback_mode & FEEDBACK_MODE_VIBRATION) {
+				vibration_play(VIB_PATTERN_GENTLE_TAP);
 			}
+		} else if (res->event == LEVEL_DET_EVENT_RELEASE) {
+			LOG_INF("Under threshold (%u dB < %u dB)",
+				res->event_db, cfg.threshold_db);
+
+			led_set_pattern(LED_PATTERN_BREATHE_GREEN);
+			vibration_stop();
 		}
+		PROF_END(PROF_STAGE_FEEDBACK, t_feedback);
+
+		/* Rollups share a lock with the rollup sync, so they are fed
+		 * here, after feedback, and not from the cache push
+		 */
+		if (ares.cache) {
+			rollup_push(k_uptime_get(), ares.cache_db,
+				    ares.cache_db >= cfg.threshold_db);
+		}
+		PROF_END(PROF_STAGE_BLOCK, t_block);
+
+		uint32_t analysis_us = k_cyc_to_us_floor32(k_cycle_get_32() -
+							   start);
+
+		k_spinlock_key_t key = k_spin_lock(&stat_lock);
+
+		stat_blocks++;
+		stat_queue_lat_sum += queue_us;
+		stat_queue_lat_max = MAX(stat_queue_lat_max, queue_us);
+		stat_analysis_sum += analysis_us;
+		stat_analysis_max = MAX(stat_analysis_max, analysis_us);
+		k_spin_unlock(&stat_lock, key);
 	}
 }
 
+void monitor_get_stats(struct monitor_stats *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&stat_lock);
+	uint32_t blocks = stat_blocks;
+	uint64_t lat_sum = stat_queue_lat_sum;
+	uint64_t analysis_sum = stat_analysis_sum;
+
+	out->queue_lat_max_us = stat_queue_lat_max;
+	out->analysis_max_us = stat_analysis_max;
+	k_spin_unlock(&stat_lock, key);
+
+	/* Divide outside the lock; a 64-bit division is a library call */
+	out->blocks = blocks;
+	out->dropped = (uint32_t)atomic_get(&stat_dropped);
+	out->queue_hwm = (uint32_t)atomic_get(&stat_queue_hwm);
+	out->queue_lat_avg_us = blocks ? (uint32_t)(lat_sum / blocks) : 0;
+	out->analysis_avg_us = blocks ? (uint32_t)(analysis_sum / blocks) : 0;
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_iv_stats(const struct shell *sh, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	struct monitor_stats st;
+
+	monitor_get_stats(&st);
+	shell_print(sh, "blocks:        %u", st.blocks);
+	shell_print(sh, "dropped:       %u", st.dropped);
+	shell_print(sh, "queue hwm:     %u / %u", st.queue_hwm, held_limit());
+	shell_print(sh, "queue latency: avg %u us, max %u us",
+		    st.queue_lat_avg_us, st.queue_lat_max_us);
+	shell_print(sh, "analysis:      avg %u us, max %u us",
+		    st.analysis_avg_us, st.analysis_max_us);
+	return 0;
+}
+
+SHELL_SUBCMD_ADD((iv), stats, NULL, "Capture/analysis pipeline counters",
+		 cmd_iv_stats, 1, 0);
+
+static int cmd_iv_pdm(const struct shell *sh, size_t argc, char **argv)
+{
+	if (argc == 3) {
+		uint32_t block_ms = strtoul(argv[1], NULL, 10);
+		uint32_t num_blocks = strtoul(argv[2], NULL, 10);
+		int err = capture_sched_set_geometry(block_ms, num_blocks);
+
+		if (err) {
+			shell_error(sh, "Invalid geometry: %d", err);
+			return err;
+		}
+		shell_print(sh, "Requested %u x %u ms blocks", num_blocks,
+			    block_ms);
+		return 0;
+	}
+
+	shell_print(sh, "rate:    %u Hz", pdm_capture_sample_rate());
+	shell_print(sh, "block:   %u ms (%u samples)", pdm_capture_block_ms(),
+		    (uint32_t)pdm_capture_block_samples());
+	shell_print(sh, "blocks:  %u (%u in use)", pdm_capture_num_blocks(),
+		    pdm_capture_blocks_in_use());
+	return 0;
+}
+
+SHELL_SUBCMD_ADD((iv), pdm, NULL,
+		 "Show or set PDM geometry: pdm [<block_ms> <num_blocks>]",
+		 cmd_iv_pdm, 1, 2);
+#endif
+
+K_THREAD_STACK_DEFINE(capture_stack, CAPTURE_STACK_SIZE);
+static struct k_thread capture_thread_data;
 K_THREAD_STACK_DEFINE(monitor_stack, MONITOR_STACK_SIZE);
 static struct k_thread monitor_thread_data;
 
 int monitor_start(void)
 {
+	uint32_t rate = pdm_capture_sample_rate();
+	const struct analysis_cfg cfg = {
+		.sample_rate = rate,
+		.subframe_ms = CONFIG_IV_LEVEL_SUBFRAME_MS,
+		.window_ms = CONFIG_IV_LEVEL_WINDOW_MS,
+		.attack_ms = CONFIG_IV_LEVEL_ATTACK_MS,
+		.release_ms = CONFIG_IV_LEVEL_RELEASE_MS,
+#if defined(CONFIG_IV_VAD)
+		.vad = true,
+		.vad_margin_db = CONFIG_IV_VAD_MARGIN_DB,
+		.vad_hangover_ms = CONFIG_IV_VAD_HANGOVER_MS,
+#endif
+		.notify_interval_ms = CONFIG_IV_LEVEL_NOTIFY_INTERVAL_MS,
+		.cache_interval_ms = CACHE_INTERVAL_MS,
+	};
+	int err = analysis_init(&analysis, &cfg);
+
+	if (err) {
+		LOG_ERR("Invalid level detector config: %d", err);
+		return err;
+	}
+
+#if defined(CONFIG_IV_BAND_ANALYZER)
+	err = band_analyzer_init(rate);
+	if (err) {
+		LOG_WRN("No band table for %u Hz: %d", rate, err);
+	}
+#endif
+
 	data_cache_init();
+	rollup_init();
+	block_queue_init(&queue);
 
 	k_thread_create(&monitor_thread_data, monitor_stack,
 			K_THREAD_STACK_SIZEOF(monitor_stack),
@@ -116,5 +368,11 @@ int monitor_start(void)
 			MONITOR_PRIORITY, 0, K_NO_WAIT);
 	k_thread_name_set(&monitor_thread_data, "monitor");
 
+	k_thread_create(&capture_thread_data, capture_stack,
+			K_THREAD_STACK_SIZEOF(capture_stack),
+			capture_thread_fn, NULL, NULL, NULL,
+			CAPTURE_PRIORITY, 0, K_NO_WAIT);
+	k_thread_name_set(&capture_thread_data, "capture");
+
 	return 0;
 }
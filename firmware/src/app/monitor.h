@@ -1,12 +1,28 @@
 #ifndef APP_MONITOR_H
 #define APP_MONITOR_H
 
+#include <stdint.h>
+
+/* Capture/analysis pipeline counters */
+struct monitor_stats {
+	uint32_t blocks;            /* Blocks analysed */
+	uint32_t dropped;           /* Blocks dropped, analysis too far behind */
+	uint32_t queue_hwm;         /* Highest capture queue occupancy */
+	uint32_t queue_lat_avg_us;  /* Capture -> analysis start */
+	uint32_t queue_lat_max_us;
+	uint32_t analysis_avg_us;   /* Analysis time per block */
+	uint32_t analysis_max_us;
+};
+
 /**
- * Start the monitor thread.
+ * Start the capture and monitor threads.
  *
- * The thread continuously reads PDM audio blocks, computes RMS/dB,
- * applies threshold comparison with hysteresis (3 consecutive blocks
- * over threshold to trigger, 3 under to release), and drives LED +
+ * The capture thread only reads PDM blocks and hands the slab pointers
+ * to the monitor thread through a lock-free queue. The monitor thread
+ * computes RMS/dB, applies threshold comparison on a sliding sub-frame
+ * window with
+ * attack/release hysteresis (CONFIG_IV_LEVEL_ATTACK_MS over threshold to
+ * trigger, CONFIG_IV_LEVEL_RELEASE_MS under to release), and drives LED +
  * vibration feedback accordingly. Also sends BLE notifications of
  * current sound level.
  *
@@ -14,4 +30,12 @@
  */
 int monitor_start(void);
 
+/**
+ * Snapshot the pipeline counters. Safe from any thread; the monitor-side
+ * counters are copied together under a spinlock.
+ *
+ * @param out  Output: current counters.
+ */
+void monitor_get_stats(struct monitor_stats *out);
+
 #endif /* APP_MONITOR_H */
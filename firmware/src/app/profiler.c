@@ -0,0 +1,139 @@
+#include "profiler.h"
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+#endif
+
+LOG_MODULE_REGISTER(profiler, LOG_LEVEL_INF);
+
+/* Bucket b holds samples of [2^b, 2^(b+1)) cycles; the last is open */
+#define PROF_BUCKETS 24
+
+struct prof_stage_data {
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint64_t sum;
+	uint32_t hist[PROF_BUCKETS];
+};
+
+static struct prof_stage_data stages[PROF_STAGE_COUNT];
+
+static const char *const stage_names[PROF_STAGE_COUNT] = {
+	[PROF_STAGE_READ] = "read",
+	[PROF_STAGE_BANDS] = "bands",
+	[PROF_STAGE_WEIGHTING] = "weighting",
+	[PROF_STAGE_VAD] = "vad",
+	[PROF_STAGE_RMS] = "rms",
+	[PROF_STAGE_DB] = "db",
+	[PROF_STAGE_NOTIFY] = "notify",
+	[PROF_STAGE_CACHE] = "cache",
+	[PROF_STAGE_FEEDBACK] = "feedback",
+	[PROF_STAGE_BLOCK] = "block",
+	[PROF_STAGE_SYNC] = "sync",
+	[PROF_STAGE_PATTERN] = "led",
+	[PROF_STAGE_VIB] = "vib",
+};
+
+void profiler_init(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	profiler_reset();
+	LOG_INF("DWT profiler enabled, %u stages, %u B",
+		PROF_STAGE_COUNT, (unsigned int)sizeof(stages));
+}
+
+void profiler_reset(void)
+{
+	memset(stages, 0, sizeof(stages));
+	for (int i = 0; i < PROF_STAGE_COUNT; i++) {
+		stages[i].min = UINT32_MAX;
+	}
+}
+
+void profiler_record(enum prof_stage stage, uint32_t cycles)
+{
+	struct prof_stage_data *s = &stages[stage];
+	uint32_t bucket = cycles ? 31 - __builtin_clz(cycles) : 0;
+
+	s->count++;
+	s->sum += cycles;
+	s->min = MIN(s->min, cycles);
+	s->max = MAX(s->max, cycles);
+	s->hist[MIN(bucket, PROF_BUCKETS - 1)]++;
+}
+
+static uint32_t cycles_to_us(uint64_t cycles)
+{
+	return (uint32_t)(cycles / (SystemCoreClock / 1000000));
+}
+
+void profiler_get(enum prof_stage stage, struct prof_summary *out)
+{
+	const struct prof_stage_data *s = &stages[stage];
+	uint32_t count = s->count;
+
+	memset(out, 0, sizeof(*out));
+	if (count == 0) {
+		return;
+	}
+
+	/* First bucket at which 99% of samples are accounted for */
+	uint32_t target = count - count / 100;
+	uint32_t seen = 0;
+	uint64_t p99 = s->max;
+
+	for (int b = 0; b < PROF_BUCKETS - 1; b++) {
+		seen += s->hist[b];
+		if (seen >= target) {
+			p99 = MIN((2ULL << b) - 1, s->max);
+			break;
+		}
+	}
+
+	out->count = count;
+	out->min_us = cycles_to_us(s->min);
+	out->avg_us = cycles_to_us(s->sum / count);
+	out->max_us = cycles_to_us(s->max);
+	out->p99_us = cycles_to_us(p99);
+}
+
+const char *profiler_stage_name(enum prof_stage stage)
+{
+	return stage < PROF_STAGE_COUNT ? stage_names[stage] : "?";
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_iv_prof(const struct shell *sh, size_t argc, char **argv)
+{
+	if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+		profiler_reset();
+		shell_print(sh, "Profiler reset");
+		return 0;
+	} else if (argc != 1) {
+		shell_error(sh, "Usage: iv prof [reset]");
+		return -EINVAL;
+	}
+
+	shell_print(sh, "%-10s %8s %8s %8s %8s %8s", "stage", "count",
+		    "min us", "avg us", "p99 us", "max us");
+	for (int i = 0; i < PROF_STAGE_COUNT; i++) {
+		struct prof_summary p;
+
+		profiler_get(i, &p);
+		shell_print(sh, "%-10s %8u %8u %8u %8u %8u",
+			    profiler_stage_name(i), p.count, p.min_us,
+			    p.avg_us, p.p99_us, p.max_us);
+	}
+	return 0;
+}
+
+SHELL_SUBCMD_ADD((iv), prof, NULL, "Per-stage cycle profile: prof [reset]",
+		 cmd_iv_prof, 1, 1);
+#endif
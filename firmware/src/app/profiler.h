@@ -0,0 +1,85 @@
+#ifndef APP_PROFILER_H
+#define APP_PROFILER_H
+
+#include <stdint.h>
+
+/*
+ * Per-stage cycle profiler on the Cortex-M DWT cycle counter.
+ *
+ * Wrap a stage in PROF_START()/PROF_END(); each sample updates the
+ * stage's count, min, max, sum and a log2 histogram in fixed memory.
+ * Every stage has a single writer, so recording takes no lock.
+ *
+ * With CONFIG_IV_PROFILER disabled the macros expand to nothing and the
+ * functions become empty inlines.
+ */
+
+enum prof_stage {
+	PROF_STAGE_READ,       /* Block read return -> analysis start */
+	PROF_STAGE_BANDS,      /* Octave-band analyzer */
+	PROF_STAGE_WEIGHTING,  /* A/C weighting filter */
+	PROF_STAGE_VAD,        /* Voice activity detector */
+	PROF_STAGE_RMS,        /* Sum of squares, per sub-frame */
+	PROF_STAGE_DB,         /* RMS -> dB conversion */
+	PROF_STAGE_NOTIFY,     /* Level notify hand-off */
+	PROF_STAGE_CACHE,      /* 1 Hz cache push */
+	PROF_STAGE_FEEDBACK,   /* LED/vibration dispatch */
+	PROF_STAGE_BLOCK,      /* Whole analysis of one block */
+	PROF_STAGE_SYNC,       /* sync_work_handler */
+	PROF_STAGE_PATTERN,    /* LED pattern_handler */
+	PROF_STAGE_VIB,        /* vib_handler */
+	PROF_STAGE_COUNT,
+};
+
+/* Summary of one stage, in microseconds */
+struct prof_summary {
+	uint32_t count;
+	uint32_t min_us;
+	uint32_t avg_us;
+	uint32_t max_us;
+	uint32_t p99_us;   /* Upper edge of the 99th percentile bucket */
+};
+
+#if defined(CONFIG_IV_PROFILER)
+
+#include <cmsis_core.h>
+
+#define PROF_START(t)      uint32_t t = DWT->CYCCNT
+#define PROF_END(stage, t) profiler_record((stage), DWT->CYCCNT - (t))
+
+/** Enable the DWT cycle counter and clear all stages. */
+void profiler_init(void);
+
+/**
+ * Add one sample to a stage.
+ *
+ * @param stage   Stage to update.
+ * @param cycles  Elapsed CPU cycles.
+ */
+void profiler_record(enum prof_stage stage, uint32_t cycles);
+
+/**
+ * Summarise a stage.
+ *
+ * @param stage  Stage to read.
+ * @param out    Output: count and min/avg/max/p99 in microseconds.
+ */
+void profiler_get(enum prof_stage stage, struct prof_summary *out);
+
+/** Clear all stages. */
+void profiler_reset(void);
+
+/** Short stage name for dumps. */
+const char *profiler_stage_name(enum prof_stage stage);
+
+#else
+
+#define PROF_START(t)
+#define PROF_END(stage, t)
+
+static inline void profiler_init(void) {}
+static inline void profiler_reset(void) {}
+
+#endif /* CONFIG_IV_PROFILER */
+
+#endif /* APP_PROFILER_H */
@@ -0,0 +1,234 @@
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+#endif
+#include "rollup.h"
+
+/* Accumulator of the bucket being filled */
+struct rollup_open {
+	uint32_t sum;
+	uint16_t count;
+	uint16_t over;
+	uint8_t  min;
+	uint8_t  max;
+};
+
+/*
+ * Bucket b of a tier is kept at ring[b % size]. open is the number of
+ * the bucket being filled; closed buckets are [first, open), of which
+ * the newest size are still in the ring.
+ */
+struct rollup_state {
+	uint32_t bucket_ms;
+	uint32_t size;
+	struct rollup_bucket *ring;
+	uint32_t first;
+	uint32_t open;
+	bool     started;
+	struct rollup_open acc;
+};
+
+static struct rollup_bucket minute_ring[ROLLUP_MINUTE_BUCKETS];
+static struct rollup_bucket hour_ring[ROLLUP_HOUR_BUCKETS];
+
+static struct rollup_state tiers[ROLLUP_TIER_COUNT] = {
+	[ROLLUP_TIER_MINUTE] = {
+		.bucket_ms = 60U * 1000U,
+		.size = ROLLUP_MINUTE_BUCKETS,
+		.ring = minute_ring,
+	},
+	[ROLLUP_TIER_HOUR] = {
+		.bucket_ms = 60U * 60U * 1000U,
+		.size = ROLLUP_HOUR_BUCKETS,
+		.ring = hour_ring,
+	},
+};
+
+/* Pushes come from the monitor thread after its feedback decision, reads
+ * from the rollup sync; both are brief
+ */
+K_MUTEX_DEFINE(rollup_mutex);
+
+static const struct rollup_bucket no_data = {
+	.min_db = ROLLUP_NO_DATA,
+	.avg_db = ROLLUP_NO_DATA,
+	.max_db = ROLLUP_NO_DATA,
+	.over = ROLLUP_NO_DATA,
+};
+
+static void open_reset(struct rollup_open *acc)
+{
+	*acc = (struct rollup_open){ .min = UINT8_MAX };
+}
+
+static uint32_t oldest(const struct rollup_state *st)
+{
+	return st->open - st->first > st->size ? st->open - st->size : st->first;
+}
+
+static void close_bucket(struct rollup_state *st)
+{
+	const struct rollup_open *acc = &st->acc;
+	struct rollup_bucket *b = &st->ring[st->open % st->size];
+
+	if (acc->count == 0) {
+		*b = no_data;
+		return;
+	}
+
+	/* Over-threshold samples as 1/60ths of the bucket, rounded */
+	uint32_t over = ((uint64_t)acc->over * CACHE_INTERVAL_MS * 60U +
+			 st->bucket_ms / 2) / st->bucket_ms;
+
+	b->min_db = acc->min;
+	b->avg_db = (uint8_t)((acc->sum + acc->count / 2) / acc->count);
+	b->max_db = acc->max;
+	b->over = (uint8_t)MIN(over, 60U);
+}
+
+static void tier_push(struct rollup_state *st, int64_t now_ms, uint8_t db,
+		      bool over)
+{
+	uint32_t b = (uint32_t)(now_ms / st->bucket_ms);
+
+	if (!st->started) {
+		st->first = b;
+		st->open = b;
+		st->started = true;
+		open_reset(&st->acc);
+	} else if ((int32_t)(b - st->open) > 0) {
+		close_bucket(st);
+
+		/* Buckets skipped entirely had no samples */
+		uint32_t skip = MAX(st->open + 1, b > st->size ? b - st->size : 0);
+
+		for (uint32_t i = skip; i < b; i++) {
+			st->ring[i % st->size] = no_data;
+		}
+		st->open = b;
+		open_reset(&st->acc);
+	}
+
+	/* A sample behind the open bucket (clock step back) joins it */
+	st->acc.sum += db;
+	st->acc.count++;
+	st->acc.over += over;
+	st->acc.min = MIN(st->acc.min, db);
+	st->acc.max = MAX(st->acc.max, db);
+}
+
+void rollup_init(void)
+{
+	k_mutex_lock(&rollup_mutex, K_FOREVER);
+	for (int t = 0; t < ROLLUP_TIER_COUNT; t++) {
+		tiers[t].started = false;
+	}
+	k_mutex_unlock(&rollup_mutex);
+}
+
+void rollup_push(int64_t now_ms, uint8_t db, bool over)
+{
+	k_mutex_lock(&rollup_mutex, K_FOREVER);
+	for (int t = 0; t < ROLLUP_TIER_COUNT; t++) {
+		tier_push(&tiers[t], now_ms, db, over);
+	}
+	k_mutex_unlock(&rollup_mutex);
+}
+
+uint32_t rollup_bucket_ms(enum rollup_tier tier)
+{
+	return tiers[tier].bucket_ms;
+}
+
+void rollup_snapshot(enum rollup_tier tier, struct iv_cursor *cur)
+{
+	const struct rollup_state *st = &tiers[tier];
+
+	k_mutex_lock(&rollup_mutex, K_FOREVER);
+	if (st->started) {
+		cur->start = oldest(st);
+		cur->end = st->open;
+	} else {
+		cur->start = 0;
+		cur->end = 0;
+	}
+	k_mutex_unlock(&rollup_mutex);
+}
+
+uint32_t rollup_read(enum rollup_tier tier, const struct iv_cursor *cur,
+		     uint32_t start, struct rollup_bucket *buf, uint32_t n)
+{
+	const struct rollup_state *st = &tiers[tier];
+
+	if (start >= iv_cursor_count(cur)) {
+		return 0;
+	}
+
+	uint32_t b = cur->start + start;
+
+	n = MIN(n, cur->end - b);
+
+	k_mutex_lock(&rollup_mutex, K_FOREVER);
+
+	uint32_t lo = oldest(st);
+
+	for (uint32_t i = 0; i < n; i++, b++) {
+		buf[i] = (int32_t)(b - lo) < 0 ? no_data : st->ring[b % st->size];
+	}
+
+	k_mutex_unlock(&rollup_mutex);
+	return n;
+}
+
+void rollup_pack(const struct rollup_bucket *b, uint8_t *out)
+{
+	out[0] = b->min_db;
+	out[1] = b->avg_db;
+	out[2] = b->max_db;
+	out[3] = b->over;
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_iv_rollup(const struct shell *sh, size_t argc, char **argv)
+{
+	enum rollup_tier tier;
+	struct iv_cursor cur;
+	uint32_t show = argc == 3 ? strtoul(argv[2], NULL, 10) : 10;
+
+	if (!strcmp(argv[1], "minute")) {
+		tier = ROLLUP_TIER_MINUTE;
+	} else if (!strcmp(argv[1], "hour")) {
+		tier = ROLLUP_TIER_HOUR;
+	} else {
+		shell_error(sh, "Tier must be minute or hour");
+		return -EINVAL;
+	}
+
+	rollup_snapshot(tier, &cur);
+
+	uint32_t count = iv_cursor_count(&cur);
+	uint32_t bucket_s = rollup_bucket_ms(tier) / 1000U;
+
+	shell_print(sh, "%u buckets of %u s; newest last", count, bucket_s);
+	shell_print(sh, "%10s %4s %4s %4s %4s", "start_s", "min", "avg", "max",
+		    "over");
+	for (uint32_t i = count - MIN(show, count); i < count; i++) {
+		struct rollup_bucket b;
+
+		if (rollup_read(tier, &cur, i, &b, 1) != 1) {
+			break;
+		}
+		shell_print(sh, "%10u %4u %4u %4u %4u",
+			    (cur.start + i) * bucket_s, b.min_db, b.avg_db,
+			    b.max_db, b.over);
+	}
+	return 0;
+}
+
+SHELL_SUBCMD_ADD((iv), rollup, NULL,
+		 "dB rollups: rollup <minute|hour> [count]", cmd_iv_rollup,
+		 2, 1);
+#endif
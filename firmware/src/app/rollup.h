@@ -0,0 +1,74 @@
+#ifndef APP_ROLLUP_H
+#define APP_ROLLUP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "data_cache.h"
+
+/*
+ * Coarse dB history kept alongside the 1 Hz cache: per-minute and
+ * per-hour min, mean, max and time over threshold, fed by the monitor
+ * thread with every cache sample. Buckets are aligned to uptime and numbered by uptime /
+ * bucket length, so a bucket's number is also its timestamp. Each tier
+ * has its own ring and outlives the raw samples by days.
+ */
+#define ROLLUP_MINUTE_BUCKETS 2880  /* 2 days of minutes, 11.25 KB */
+#define ROLLUP_HOUR_BUCKETS   720   /* 30 days of hours, 2.8 KB */
+
+#define ROLLUP_NO_DATA     0xFF  /* Every field of a bucket without samples */
+#define ROLLUP_RECORD_SIZE 4     /* Sync wire format: [min, avg, max, over] */
+
+enum rollup_tier {
+	ROLLUP_TIER_MINUTE,
+	ROLLUP_TIER_HOUR,
+	ROLLUP_TIER_COUNT,
+};
+
+struct rollup_bucket {
+	uint8_t min_db;
+	uint8_t avg_db;
+	uint8_t max_db;
+	uint8_t over;  /* Time over threshold in 1/60ths of the bucket:
+			* seconds per minute, minutes per hour
+			*/
+};
+
+void rollup_init(void);
+
+/**
+ * Add a cache sample to every tier, closing buckets it has moved past.
+ * Monitor thread only.
+ *
+ * @param now_ms  Uptime of the sample.
+ * @param db      Sample level.
+ * @param over    Sample was at or above the threshold.
+ */
+void rollup_push(int64_t now_ms, uint8_t db, bool over);
+
+/** Bucket length of a tier. */
+uint32_t rollup_bucket_ms(enum rollup_tier tier);
+
+/**
+ * Snapshot the closed buckets of a tier, by bucket number.
+ *
+ * The bucket still filling is not included; cur->end * bucket length is
+ * the uptime at which it started.
+ */
+void rollup_snapshot(enum rollup_tier tier, struct iv_cursor *cur);
+
+/**
+ * Copy buckets out of a snapshot, oldest first.
+ *
+ * Buckets overwritten since the snapshot read as ROLLUP_NO_DATA, so
+ * positions (and so timestamps) stay implicit.
+ *
+ * @return Number of buckets copied, 0 past the end of the snapshot.
+ */
+uint32_t rollup_read(enum rollup_tier tier, const struct iv_cursor *cur,
+		     uint32_t start, struct rollup_bucket *buf, uint32_t n);
+
+/** Pack a bucket into its ROLLUP_RECORD_SIZE-byte sync record. */
+void rollup_pack(const struct rollup_bucket *b, uint8_t *out);
+
+#endif /* APP_ROLLUP_H */
@@ -0,0 +1,114 @@
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+#include "history.h"
+#include "sync_stream.h"
+
+void sync_stream_open(struct sync_stream *st)
+{
+	/* Stream everything cached so far, the RAM-only samples from a
+	 * copy rather than after a flush; samples pushed from here on wait
+	 * for the next sync
+	 */
+	history_snapshot(&st->cur, &st->tail);
+	st->pos = 0;
+	st->next = 0;
+	st->batch_len = 0;
+}
+
+bool sync_stream_seek(struct sync_stream *st, uint32_t seq)
+{
+	if (seq - st->cur.start > iv_cursor_count(&st->cur)) {
+		return false;
+	}
+	st->pos = seq - st->cur.start;
+	st->next = st->pos;
+	return true;
+}
+
+/* Next readable sample at or after snapshot position *i */
+static bool take(struct sync_stream *st, uint32_t *i, struct iv_sample *out)
+{
+	for (;;) {
+		if (*i - st->batch_pos < st->batch_len) {
+			*out = st->batch[*i - st->batch_pos];
+			return true;
+		}
+
+		int n = history_read(&st->cur, &st->tail, *i, st->batch,
+				     ARRAY_SIZE(st->batch));
+
+		if (n == 0) {
+			return false;
+		}
+		if (n < 0) {
+			/* Lost or unreadable since the snapshot */
+			(*i)++;
+			continue;
+		}
+		st->batch_pos = *i;
+		st->batch_len = n;
+	}
+}
+
+uint32_t sync_stream_record(struct sync_stream *st, uint8_t *out)
+{
+	uint32_t i = st->pos;
+	struct iv_sample s;
+
+	if (!take(st, &i, &s)) {
+		st->next = i;
+		memset(out, 0xFF, IV_SAMPLE_RECORD_SIZE);
+		return 0;
+	}
+	data_cache_pack(&s, out);
+	st->next = i + 1;
+	return 1;
+}
+
+uint32_t sync_stream_frame(struct sync_stream *st, uint8_t *out,
+			   uint32_t size, uint16_t *len)
+{
+	uint32_t cap = MIN((size - SYNC_FRAME_HDR_SIZE) / IV_SAMPLE_RECORD_SIZE,
+			   UINT8_MAX);
+	uint32_t i = st->pos;
+	uint32_t first = i;
+	uint32_t count = 0;
+	struct iv_sample s;
+
+	while (count < cap) {
+		uint32_t at = i;
+
+		if (!take(st, &at, &s) || (count > 0 && at != i)) {
+			/* End, or a gap the next frame starts after */
+			break;
+		}
+		if (count == 0) {
+			first = at;
+		}
+		data_cache_pack(&s, &out[SYNC_FRAME_HDR_SIZE +
+					 count * IV_SAMPLE_RECORD_SIZE]);
+		count++;
+		i = at + 1;
+	}
+
+	/* The end frame carries the snapshot end */
+	if (count == 0) {
+		first = iv_cursor_count(&st->cur);
+		i = first;
+	}
+	st->next = i;
+
+	out[0] = SYNC_FRAME_VERSION;
+	out[1] = count == 0 ? SYNC_FRAME_END : 0;
+	out[2] = (uint8_t)count;
+	sys_put_le32(st->cur.start + first, &out[3]);
+	*len = SYNC_FRAME_HDR_SIZE + count * IV_SAMPLE_RECORD_SIZE;
+	return count;
+}
+
+void sync_stream_release(const struct sync_stream *st)
+{
+	history_release(&st->cur);
+}
@@ -0,0 +1,87 @@
+#ifndef APP_SYNC_STREAM_H
+#define APP_SYNC_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "data_cache.h"
+#include "history.h"
+
+/*
+ * Builds sync notifications from a snapshot of the history, independent
+ * of the BLE transport.
+ *
+ * Every sample carries the sequence number history gives it, which only
+ * moves forward (and, with the flash log, persists across resets). A
+ * framed sync can start from a sequence number, so an interrupted one
+ * resumes where the app stopped receiving, and samples are dropped only
+ * when the app acknowledges them with history_ack().
+ *
+ * A frame is [version, flags, count, first_seq_le32] followed by count
+ * records of consecutive sequence numbers; a sample that cannot be read
+ * ends the frame, so the next one starts after the gap. The last frame
+ * is empty, flagged SYNC_FRAME_END, and carries the sequence number to
+ * acknowledge and to resume from next time.
+ */
+#define SYNC_FRAME_VERSION  2
+#define SYNC_FRAME_HDR_SIZE 7
+#define SYNC_FRAME_END      0x01
+
+#define SYNC_STREAM_BATCH 16  /* Samples read from history at a time */
+
+struct sync_stream {
+	struct iv_cursor cur;
+	struct history_tail tail;  /* Snapshot samples not yet in flash */
+	uint32_t pos;   /* Next snapshot position to send */
+	uint32_t next;  /* Position after the last filled notification */
+	struct iv_sample batch[SYNC_STREAM_BATCH];
+	uint32_t batch_pos;  /* Read-ahead of [batch_pos, batch_pos + len) */
+	uint32_t batch_len;
+};
+
+/** Snapshot what is unsynced, oldest first, without a flush. */
+void sync_stream_open(struct sync_stream *st);
+
+/**
+ * Start a freshly opened stream at sequence number seq.
+ *
+ * @return false if seq is outside the snapshot (already acknowledged,
+ *         or numbered before a reset without the flash log); the stream
+ *         then starts at the oldest sample.
+ */
+bool sync_stream_seek(struct sync_stream *st, uint32_t seq);
+
+/** Sequence number of the next sample to send. */
+static inline uint32_t sync_stream_seq(const struct sync_stream *st)
+{
+	return st->cur.start + st->pos;
+}
+
+/**
+ * Fill one legacy notification: a single IV_SAMPLE_RECORD_SIZE record,
+ * or the 0xFF sentinel at the end.
+ *
+ * @return Number of records, 0 for the sentinel.
+ */
+uint32_t sync_stream_record(struct sync_stream *st, uint8_t *out);
+
+/**
+ * Fill one frame of at most size bytes (SYNC_FRAME_HDR_SIZE + one
+ * record or more).
+ *
+ * @param len  Output: frame length.
+ * @return Number of records, 0 for the end frame.
+ */
+uint32_t sync_stream_frame(struct sync_stream *st, uint8_t *out,
+			   uint32_t size, uint16_t *len);
+
+/** The last filled notification was sent; move past it. */
+static inline void sync_stream_commit(struct sync_stream *st)
+{
+	st->pos = st->next;
+}
+
+/** Drop everything the snapshot covered (legacy clear after a sync). */
+void sync_stream_release(const struct sync_stream *st);
+
+#endif /* APP_SYNC_STREAM_H */
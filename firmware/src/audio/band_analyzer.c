@@ -0,0 +1,181 @@
+#include "band_analyzer.h"
+#include "sound_level.h"
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/sys/util.h>
+
+/* Generated at build time by scripts/gen_band_tables.py */
+#include "band_tables.h"
+
+BUILD_ASSERT(BAND_TABLE_COUNT == BAND_COUNT,
+	     "band_tables.h does not match BAND_COUNT");
+BUILD_ASSERT(BAND_FFT_SIZE == CONFIG_IV_BAND_FFT_SIZE,
+	     "band_tables.h was generated for another FFT size");
+BUILD_ASSERT(IS_POWER_OF_TWO(BAND_FFT_SIZE),
+	     "CONFIG_IV_BAND_FFT_SIZE must be a power of two");
+
+/*
+ * Octave-band analyzer.
+ *
+ * One BAND_FFT_SIZE window is taken from each block, Hann-windowed and
+ * left-shifted so its peak uses the available headroom (block floating
+ * point). Blocks shorter than a window are windowed straight into the
+ * FFT buffer as they arrive until it is full. The complex radix-2 FFT halves the data every stage to stay
+ * inside Q15. Bin powers are scaled back to a common exponent before
+ * being summed into per-band 64-bit accumulators.
+ *
+ * Level conversion: with the 1/N FFT scaling, the one-sided band power
+ * times 2 gives mean square, and dividing by the Hann power gain (3/8)
+ * compensates the window, i.e. mean_sq = sum|X|^2 * 16/3.
+ */
+
+/* Accumulators hold energies in units of 2^-(2 * MAX_SHIFT) */
+#define MAX_SHIFT 8
+
+static const struct band_edge_table *edges;
+static uint64_t band_acc[BAND_COUNT];
+static uint32_t windows;
+
+/* Working buffers kept off the monitor thread stack */
+static int16_t fft_re[BAND_FFT_SIZE];
+static int16_t fft_im[BAND_FFT_SIZE];
+
+/* Samples of the current window already in fft_re, and their peak */
+static size_t fill;
+static int32_t peak;
+
+int band_analyzer_init(uint32_t sample_rate)
+{
+	edges = NULL;
+	for (size_t i = 0; i < ARRAY_SIZE(band_edges); i++) {
+		if (band_edges[i].sample_rate == sample_rate) {
+			edges = &band_edges[i];
+		}
+	}
+
+	memset(band_acc, 0, sizeof(band_acc));
+	windows = 0;
+	fill = 0;
+	peak = 0;
+
+	return edges ? 0 : -ENOTSUP;
+}
+
+static void fft_q15(int16_t *re, int16_t *im)
+{
+	for (size_t size = 2; size <= BAND_FFT_SIZE; size <<= 1) {
+		size_t half = size / 2;
+		size_t step = BAND_FFT_SIZE / size;
+
+		for (size_t start = 0; start < BAND_FFT_SIZE; start += size) {
+			for (size_t k = 0; k < half; k++) {
+				/* Twiddle e^(-j*2*pi*k/size) */
+				int32_t wr = band_cos_q15[k * step];
+				int32_t wi = -band_sin_q15[k * step];
+				size_t i = start + k;
+				size_t j = i + half;
+
+				int32_t tr = (re[j] * wr - im[j] * wi) >> 15;
+				int32_t ti = (re[j] * wi + im[j] * wr) >> 15;
+
+				re[j] = (int16_t)((re[i] - tr) >> 1);
+				im[j] = (int16_t)((im[i] - ti) >> 1);
+				re[i] = (int16_t)((re[i] + tr) >> 1);
+				im[i] = (int16_t)((im[i] + ti) >> 1);
+			}
+		}
+	}
+}
+
+/* Window up to count samples into the current window; returns how many */
+static size_t window_in(const int16_t *samples, size_t count)
+{
+	size_t n = MIN(count, BAND_FFT_SIZE - fill);
+
+	for (size_t i = 0; i < n; i++) {
+		int32_t w = (samples[i] * band_window_q15[fill + i]) >> 15;
+
+		fft_re[band_bitrev[fill + i]] = (int16_t)w;
+		fft_im[fill + i] = 0;
+		peak = MAX(peak, w < 0 ? -w : w);
+	}
+
+	fill += n;
+	return n;
+}
+
+void band_analyzer_process(const int16_t *samples, size_t count)
+{
+	if (edges == NULL) {
+		return;
+	}
+
+	size_t used = window_in(samples, count);
+
+	if (fill < BAND_FFT_SIZE) {
+		return;
+	}
+
+	/* Scale up so the peak stays below 2^14, leaving one guard bit */
+	uint32_t shift = 0;
+
+	while (shift < MAX_SHIFT && peak > 0 &&
+	       (peak << (shift + 1)) < (1 << 14)) {
+		shift++;
+	}
+	if (shift) {
+		for (size_t i = 0; i < BAND_FFT_SIZE; i++) {
+			fft_re[i] = (int16_t)(fft_re[i] << shift);
+		}
+	}
+
+	fft_q15(fft_re, fft_im);
+
+	uint32_t rescale = 2 * (MAX_SHIFT - shift);
+
+	for (size_t b = 0; b < BAND_COUNT; b++) {
+		uint64_t e = 0;
+
+		for (size_t k = edges->first_bin[b];
+		     k < edges->first_bin[b + 1]; k++) {
+			e += (uint64_t)(fft_re[k] * fft_re[k] +
+					fft_im[k] * fft_im[k]);
+		}
+		band_acc[b] += e << rescale;
+	}
+
+	windows++;
+
+	/* Start the next window with the rest of the block, unless that
+	 * is a whole window of its own
+	 */
+	fill = 0;
+	peak = 0;
+	if (count - used < BAND_FFT_SIZE) {
+		window_in(samples + used, count - used);
+	}
+}
+
+uint32_t band_analyzer_read(uint8_t levels[BAND_COUNT])
+{
+	uint32_t n = windows;
+
+	for (size_t b = 0; b < BAND_COUNT; b++) {
+		if (n == 0) {
+			levels[b] = 0;
+			continue;
+		}
+
+		/* mean_sq = acc * 16/3 / n / 2^(2 * MAX_SHIFT) */
+		uint16_t rms = sound_level_rms_from_sum(
+			band_acc[b] * 16, (size_t)3 * n << (2 * MAX_SHIFT));
+
+		levels[b] = sound_level_rms_to_db(rms);
+	}
+
+	memset(band_acc, 0, sizeof(band_acc));
+	windows = 0;
+
+	return n;
+}
@@ -0,0 +1,43 @@
+#ifndef AUDIO_BAND_ANALYZER_H
+#define AUDIO_BAND_ANALYZER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Octave bands centred on 63, 125, 250, 500, 1k, 2k, 4k, 8k Hz */
+#define BAND_COUNT 8
+
+/**
+ * Select the band table for the PCM rate and clear the accumulators.
+ *
+ * @param sample_rate  PCM rate in Hz.
+ * @return 0 on success, -ENOTSUP if no band table exists for the rate.
+ */
+int band_analyzer_init(uint32_t sample_rate);
+
+/**
+ * Analyze one window from a PCM block and accumulate band energies.
+ *
+ * At most one BAND_FFT_SIZE window is transformed per call (fixed-point
+ * radix-2 FFT with block floating point input scaling), so the cost per
+ * block is bounded whatever its length. Samples are collected across
+ * calls until a window is full, so a stream of short blocks is analyzed
+ * without gaps. A block that holds more than a whole window after
+ * completing the current one skips the rest.
+ *
+ * @param samples  Signed 16-bit PCM block.
+ * @param count    Number of samples.
+ */
+void band_analyzer_process(const int16_t *samples, size_t count);
+
+/**
+ * Convert accumulated energies to per-band levels and reset.
+ *
+ * Levels use the same pseudo-SPL scale as sound_level_rms_to_db().
+ *
+ * @param levels  Output: BAND_COUNT dB values.
+ * @return Number of windows that were averaged (0 if none).
+ */
+uint32_t band_analyzer_read(uint8_t levels[BAND_COUNT]);
+
+#endif /* AUDIO_BAND_ANALYZER_H */
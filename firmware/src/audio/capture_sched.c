@@ -0,0 +1,204 @@
+#include "capture_sched.h"
+#include "pdm_capture.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(capture_sched, LOG_LEVEL_INF);
+
+/*
+ * duty_cycled is set by the analysis side (capture_sched_update()) and
+ * read by the capture side; window_left is owned by the capture side.
+ */
+static volatile bool duty_cycled;
+static uint32_t quiet_ms;
+static uint32_t window_left;
+
+/* Pending geometry (block_ms << 16 | num_blocks), 0 if none */
+static atomic_t geometry_req;
+
+/* Wait this long for analysis to return blocks before reconfiguring */
+#define GEOMETRY_DRAIN_TIMEOUT_MS 2000
+
+/* Microphone on/off bookkeeping for the duty-cycle statistic */
+static int64_t mic_on_since;
+static int64_t mic_on_total;
+static int64_t stats_since;
+
+static void mic_on(void)
+{
+	mic_on_since = k_uptime_get();
+}
+
+static void mic_off(void)
+{
+	mic_on_total += k_uptime_get() - mic_on_since;
+	mic_on_since = 0;
+}
+
+int capture_sched_start(void)
+{
+	int err = pdm_capture_start();
+
+	if (err) {
+		return err;
+	}
+
+	stats_since = k_uptime_get();
+	mic_on();
+	return 0;
+}
+
+int capture_sched_set_geometry(uint32_t block_ms, uint32_t num_blocks)
+{
+	if (num_blocks > UINT16_MAX) {
+		return -EINVAL;
+	}
+
+	/* Reject here, before capture is stopped for a geometry that fails */
+	int err = pdm_capture_check_geometry(block_ms, num_blocks);
+
+	if (err) {
+		return err;
+	}
+
+	atomic_set(&geometry_req, (atomic_val_t)(block_ms << 16 | num_blocks));
+	return 0;
+}
+
+static int apply_geometry(uint32_t req, uint32_t *gap_ms)
+{
+	uint32_t block_ms = req >> 16;
+	uint32_t num_blocks = req & 0xFFFF;
+	int64_t since = k_uptime_get();
+	int err;
+
+	pdm_capture_stop();
+	pdm_capture_drain();
+	mic_off();
+
+	/* Queued blocks go back to the slab as analysis catches up */
+	while (pdm_capture_blocks_in_use() > 0 &&
+	       k_uptime_get() - since < GEOMETRY_DRAIN_TIMEOUT_MS) {
+		k_sleep(K_MSEC(10));
+	}
+
+	err = pdm_capture_reconfigure(block_ms, num_blocks);
+	if (err) {
+		LOG_ERR("PDM geometry %u ms x %u rejected: %d", block_ms,
+			num_blocks, err);
+	}
+
+	/* Restart with whichever geometry is now in place */
+	int start_err = pdm_capture_start();
+
+	if (start_err) {
+		return start_err;
+	}
+	mic_on();
+	window_left = 0;
+	*gap_ms = (uint32_t)(k_uptime_get() - since);
+	return 0;
+}
+
+int capture_sched_read(void **buf, size_t *size, uint32_t *gap_ms)
+{
+	*gap_ms = 0;
+
+	atomic_val_t req = atomic_clear(&geometry_req);
+
+	if (req) {
+		int err = apply_geometry((uint32_t)req, gap_ms);
+
+		if (err) {
+			return err;
+		}
+	}
+
+#if defined(CONFIG_IV_CAPTURE_DUTY_CYCLE)
+	if (duty_cycled && window_left == 0) {
+		uint32_t block_ms = pdm_capture_block_ms();
+		uint32_t blocks = MAX(1U, DIV_ROUND_UP(
+			CONFIG_IV_CAPTURE_DUTY_WINDOW_MS, block_ms));
+		uint32_t window_ms = blocks * block_ms;
+		uint32_t gap = CONFIG_IV_CAPTURE_DUTY_PERIOD_MS > window_ms ?
+			       CONFIG_IV_CAPTURE_DUTY_PERIOD_MS - window_ms : 0;
+
+		pdm_capture_stop();
+		pdm_capture_drain();
+		mic_off();
+
+		k_sleep(K_MSEC(gap));
+
+		int err = pdm_capture_start();
+
+		if (err) {
+			return err;
+		}
+		mic_on();
+		window_left = blocks;
+		*gap_ms += gap;
+	}
+#endif
+
+	int err = pdm_capture_read(buf, size);
+
+	if (!err && window_left > 0) {
+		window_left--;
+	}
+	return err;
+}
+
+void capture_sched_update(uint8_t db, uint8_t threshold_db, bool active)
+{
+#if defined(CONFIG_IV_CAPTURE_DUTY_CYCLE)
+	bool quiet = !active &&
+		     db + CONFIG_IV_CAPTURE_DUTY_MARGIN_DB < threshold_db;
+
+	if (!quiet) {
+		quiet_ms = 0;
+		if (duty_cycled) {
+			duty_cycled = false;
+			LOG_INF("Level %u dB near threshold, continuous capture "
+				"(duty %u permille)", db,
+				capture_sched_duty_permille());
+		}
+		return;
+	}
+
+	if (!duty_cycled) {
+		quiet_ms += pdm_capture_block_ms();
+		if (quiet_ms >= CONFIG_IV_CAPTURE_DUTY_QUIET_MS) {
+			duty_cycled = true;
+			LOG_INF("Quiet for %u ms, duty cycling capture",
+				quiet_ms);
+		}
+	}
+#else
+	ARG_UNUSED(db);
+	ARG_UNUSED(threshold_db);
+	ARG_UNUSED(active);
+#endif
+}
+
+bool capture_sched_is_duty_cycled(void)
+{
+	return duty_cycled;
+}
+
+uint16_t capture_sched_duty_permille(void)
+{
+	int64_t now = k_uptime_get();
+	int64_t on = mic_on_total;
+
+	if (mic_on_since) {
+		on += now - mic_on_since;
+	}
+
+	int64_t total = now - stats_since;
+
+	if (total <= 0) {
+		return 1000;
+	}
+	return (uint16_t)MIN(on * 1000 / total, 1000);
+}
@@ -0,0 +1,74 @@
+#ifndef AUDIO_CAPTURE_SCHED_H
+#define AUDIO_CAPTURE_SCHED_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Adaptive capture scheduler on top of pdm_capture.
+ *
+ * In continuous mode every block is captured. After the level has stayed
+ * CONFIG_IV_CAPTURE_DUTY_MARGIN_DB below the threshold for
+ * CONFIG_IV_CAPTURE_DUTY_QUIET_MS the scheduler switches to duty-cycled
+ * mode: the DMIC is stopped and only a short window is captured every
+ * CONFIG_IV_CAPTURE_DUTY_PERIOD_MS. The first window that comes within
+ * the margin of the threshold switches back to continuous capture.
+ */
+
+/**
+ * Start capture in continuous mode.
+ *
+ * @return 0 on success, negative errno on failure.
+ */
+int capture_sched_start(void);
+
+/**
+ * Read the next audio block (blocking).
+ *
+ * In duty-cycled mode this may stop the DMIC and sleep before capturing
+ * the next window; the time spent without audio is reported in gap_ms so
+ * downstream timing and filters can account for the discontinuity.
+ *
+ * @param buf     Output: slab buffer, release with pdm_capture_buf_free().
+ * @param size    Output: number of bytes read.
+ * @param gap_ms  Output: milliseconds of audio skipped before this block.
+ * @return 0 on success, negative errno on failure.
+ */
+int capture_sched_read(void **buf, size_t *size, uint32_t *gap_ms);
+
+/**
+ * Request a new PDM block geometry.
+ *
+ * Applied by the capture thread at the start of its next read: the DMIC
+ * is stopped, all outstanding blocks are awaited, the slab is rebuilt
+ * with pdm_capture_reconfigure() and capture restarts. The time without
+ * audio is reported through gap_ms like a duty-cycle gap.
+ *
+ * @param block_ms    Block duration in milliseconds.
+ * @param num_blocks  Number of slab blocks.
+ * @return 0 if queued, -EINVAL for out-of-range values, -ENOMEM if the
+ *         geometry does not fit CONFIG_IV_PDM_SLAB_SIZE.
+ */
+int capture_sched_set_geometry(uint32_t block_ms, uint32_t num_blocks);
+
+/**
+ * Feed back the analysed level of the last block.
+ *
+ * @param db            Block level in dB.
+ * @param threshold_db  Current trigger threshold.
+ * @param active        Feedback is currently active.
+ */
+void capture_sched_update(uint8_t db, uint8_t threshold_db, bool active);
+
+/** True while the scheduler is duty cycling the microphone. */
+bool capture_sched_is_duty_cycled(void);
+
+/**
+ * Fraction of time the microphone has been running since boot.
+ *
+ * @return Duty cycle in permille (1000 = always on).
+ */
+uint16_t capture_sched_duty_permille(void);
+
+#endif /* AUDIO_CAPTURE_SCHED_H */
@@ -6,29 +6,65 @@
 
 LOG_MODULE_REGISTER(pdm_capture, LOG_LEVEL_INF);
 
-K_MEM_SLAB_DEFINE_STATIC(pdm_slab, PDM_BLOCK_SIZE, PDM_NUM_BLOCKS, 4);
+/* Backing store for the slab; the active geometry is carved out of it */
+static char __aligned(4) slab_arena[CONFIG_IV_PDM_SLAB_SIZE];
+
+BUILD_ASSERT(PDM_BLOCK_BYTES(CONFIG_IV_PDM_BLOCK_MS) *
+	     CONFIG_IV_PDM_NUM_BLOCKS <= CONFIG_IV_PDM_SLAB_SIZE,
+	     "CONFIG_IV_PDM_SLAB_SIZE is smaller than the default geometry");
+static struct k_mem_slab pdm_slab;
 
 static const struct device *dmic_dev;
+static uint32_t block_ms;
+static uint32_t num_blocks;
+static size_t block_samples;
 
-int pdm_capture_init(void)
+int pdm_capture_check_geometry(uint32_t new_block_ms, uint32_t new_num_blocks)
 {
-	dmic_dev = DEVICE_DT_GET(DT_NODELABEL(pdm0));
-	if (!device_is_ready(dmic_dev)) {
-		LOG_ERR("PDM device not ready");
-		return -ENODEV;
+	if (new_block_ms < PDM_BLOCK_MS_MIN ||
+	    new_block_ms > PDM_BLOCK_MS_MAX ||
+	    new_num_blocks < PDM_NUM_BLOCKS_MIN) {
+		return -EINVAL;
+	}
+
+	if ((uint64_t)PDM_BLOCK_BYTES(new_block_ms) * new_num_blocks >
+	    sizeof(slab_arena)) {
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static int configure(uint32_t new_block_ms, uint32_t new_num_blocks)
+{
+	int err = pdm_capture_check_geometry(new_block_ms, new_num_blocks);
+
+	if (err) {
+		return err;
+	}
+
+	size_t samples = PDM_SAMPLE_RATE * new_block_ms / 1000;
+	size_t block_size = PDM_BLOCK_BYTES(new_block_ms);
+
+	err = k_mem_slab_init(&pdm_slab, slab_arena, block_size,
+				  new_num_blocks);
+
+	if (err) {
+		LOG_ERR("k_mem_slab_init failed: %d", err);
+		return err;
 	}
 
 	struct pcm_stream_cfg stream_cfg = {
 		.pcm_rate = PDM_SAMPLE_RATE,
 		.pcm_width = PDM_SAMPLE_BITS,
-		.block_size = PDM_BLOCK_SIZE,
+		.block_size = samples * sizeof(int16_t),
 		.mem_slab = &pdm_slab,
 	};
 
 	struct dmic_cfg cfg = {
 		.io = {
-			.min_pdm_clk_freq = 1024000,
-			.max_pdm_clk_freq = 3072000,
+			.min_pdm_clk_freq = PDM_CLK_MIN_HZ,
+			.max_pdm_clk_freq = PDM_CLK_MAX_HZ,
 			.min_pdm_clk_dc = 40,
 			.max_pdm_clk_dc = 60,
 			.pdm_clk_pol = 0,
@@ -43,18 +79,68 @@ int pdm_capture_init(void)
 		},
 	};
 
-	int err = dmic_configure(dmic_dev, &cfg);
-
+	err = dmic_configure(dmic_dev, &cfg);
 	if (err) {
 		LOG_ERR("dmic_configure failed: %d", err);
 		return err;
 	}
 
-	LOG_INF("PDM mic initialized: %u Hz, %u-bit, mono",
-		PDM_SAMPLE_RATE, PDM_SAMPLE_BITS);
+	block_ms = new_block_ms;
+	num_blocks = new_num_blocks;
+	block_samples = samples;
+
+	LOG_INF("PDM mic configured: %u Hz, %u-bit, mono, %u x %u ms blocks "
+		"(%u of %u B slab)", PDM_SAMPLE_RATE, PDM_SAMPLE_BITS,
+		num_blocks, block_ms, (unsigned int)(block_size * num_blocks),
+		(unsigned int)sizeof(slab_arena));
 	return 0;
 }
 
+int pdm_capture_init(void)
+{
+	dmic_dev = DEVICE_DT_GET(DT_NODELABEL(pdm0));
+	if (!device_is_ready(dmic_dev)) {
+		LOG_ERR("PDM device not ready");
+		return -ENODEV;
+	}
+
+	return configure(CONFIG_IV_PDM_BLOCK_MS, CONFIG_IV_PDM_NUM_BLOCKS);
+}
+
+int pdm_capture_reconfigure(uint32_t new_block_ms, uint32_t new_num_blocks)
+{
+	if (pdm_capture_blocks_in_use() > 0) {
+		return -EBUSY;
+	}
+
+	return configure(new_block_ms, new_num_blocks);
+}
+
+uint32_t pdm_capture_num_blocks(void)
+{
+	return num_blocks;
+}
+
+uint32_t pdm_capture_blocks_in_use(void)
+{
+	return k_mem_slab_num_used_get(&pdm_slab);
+}
+
+uint32_t pdm_capture_sample_rate(void)
+{
+	return PDM_SAMPLE_RATE;
+}
+
+size_t pdm_capture_block_samples(void)
+{
+	return block_samples;
+}
+
+uint32_t pdm_capture_block_ms(void)
+{
+	return block_ms;
+}
+
 int pdm_capture_start(void)
 {
 	int err = dmic_trigger(dmic_dev, DMIC_TRIGGER_START);
@@ -67,7 +153,7 @@ int pdm_capture_start(void)
 
 int pdm_capture_read(void **buf, size_t *size)
 {
-	uint32_t bytes = 0;
+	size_t bytes = 0;
 	int err = dmic_read(dmic_dev, 0, buf, &bytes, SYS_FOREVER_MS);
 
 	if (err) {
@@ -93,3 +179,13 @@ int pdm_capture_stop(void)
 	}
 	return err;
 }
+
+void pdm_capture_drain(void)
+{
+	void *buf;
+	size_t bytes;
+
+	while (dmic_read(dmic_dev, 0, &buf, &bytes, 0) == 0) {
+		k_mem_slab_free(&pdm_slab, buf);
+	}
+}
@@ -3,23 +3,88 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <zephyr/sys/util.h>
 
-/* Audio capture parameters */
+/*
+ * Audio capture parameters for the selected profile.
+ *
+ * Full:       16 kHz PCM, PDM clock 1.024-3.072 MHz.
+ * Level-only: 12.5 kHz PCM from the lowest nRF52840 PDM clock
+ *             (1.000 MHz with the 80x decimation ratio).
+ *
+ * Downstream code should use the runtime accessors below rather than
+ * these macros so it follows whichever profile is active.
+ */
+#if defined(CONFIG_IV_AUDIO_PROFILE_LEVEL)
+#define PDM_SAMPLE_RATE    12500
+#define PDM_CLK_MIN_HZ     1000000
+#define PDM_CLK_MAX_HZ     1000000
+#else
 #define PDM_SAMPLE_RATE    16000
+#define PDM_CLK_MIN_HZ     1024000
+#define PDM_CLK_MAX_HZ     3072000
+#endif
 #define PDM_SAMPLE_BITS    16
 #define PDM_CHANNELS       1
-#define PDM_BLOCK_SAMPLES  1600  /* 100 ms at 16 kHz */
-#define PDM_BLOCK_SIZE     (PDM_BLOCK_SAMPLES * sizeof(int16_t))
-#define PDM_NUM_BLOCKS     4
+
+/* Block geometry limits accepted by pdm_capture_reconfigure() */
+#define PDM_BLOCK_MS_MIN   10
+#define PDM_BLOCK_MS_MAX   1000
+#define PDM_NUM_BLOCKS_MIN 3
+
+/* Slab bytes per block of the given duration, word aligned */
+#define PDM_BLOCK_BYTES(ms) \
+	ROUND_UP(PDM_SAMPLE_RATE * (ms) / 1000 * sizeof(int16_t), 4)
 
 /**
  * Initialize the PDM microphone via DMIC driver.
- * Configures 16 kHz mono 16-bit capture with memory slab buffering.
+ * Configures mono 16-bit capture at the profile's rate with memory slab
+ * buffering, using CONFIG_IV_PDM_BLOCK_MS and CONFIG_IV_PDM_NUM_BLOCKS.
  *
  * @return 0 on success, negative errno on failure.
  */
 int pdm_capture_init(void);
 
+/**
+ * Change block length and buffer count.
+ *
+ * The slab is carved out of a static arena of CONFIG_IV_PDM_SLAB_SIZE
+ * bytes. Capture must be stopped and every block returned with
+ * pdm_capture_buf_free() before calling.
+ *
+ * @param block_ms    Block duration in milliseconds.
+ * @param num_blocks  Number of slab blocks.
+ * @return 0 on success, -EINVAL for out-of-range values, -ENOMEM if the
+ *         geometry does not fit the arena, -EBUSY if blocks are in use,
+ *         or a DMIC driver error.
+ */
+int pdm_capture_reconfigure(uint32_t block_ms, uint32_t num_blocks);
+
+/**
+ * Check a block geometry without applying it.
+ *
+ * @param block_ms    Block duration in milliseconds.
+ * @param num_blocks  Number of slab blocks.
+ * @return 0 if pdm_capture_reconfigure() would accept it, -EINVAL for
+ *         out-of-range values, -ENOMEM if it does not fit the arena.
+ */
+int pdm_capture_check_geometry(uint32_t block_ms, uint32_t num_blocks);
+
+/** Number of blocks in the slab. */
+uint32_t pdm_capture_num_blocks(void);
+
+/** Number of slab blocks currently held outside the slab. */
+uint32_t pdm_capture_blocks_in_use(void);
+
+/** Active PCM sample rate in Hz. */
+uint32_t pdm_capture_sample_rate(void);
+
+/** Samples per captured block. */
+size_t pdm_capture_block_samples(void);
+
+/** Duration of one captured block in milliseconds. */
+uint32_t pdm_capture_block_ms(void);
+
 /**
  * Start continuous PDM capture.
  *
@@ -50,4 +115,9 @@ void pdm_capture_buf_free(void *buf);
  */
 int pdm_capture_stop(void);
 
+/**
+ * Free any blocks still queued by the driver after pdm_capture_stop().
+ */
+void pdm_capture_drain(void);
+
 #endif /* AUDIO_PDM_CAPTURE_H */
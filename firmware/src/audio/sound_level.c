@@ -1,7 +1,18 @@
 #include "sound_level.h"
 
+#include <string.h>
 #include <zephyr/sys/util.h>
 
+/* Every kernel the target can run is built, so the kernel tests can
+ * compare them on the same buffers; unused ones are garbage collected
+ */
+#if defined(__ARM_FEATURE_DSP)
+#include <cmsis_core.h>
+#endif
+#if defined(CONFIG_CMSIS_DSP_STATISTICS)
+#include <arm_math.h>
+#endif
+
 /*
  * Integer-only sound level computation.
  *
@@ -13,12 +24,8 @@
  * into a pseudo-SPL range that's more intuitive for the user.
  */
 
-uint16_t sound_level_rms(const int16_t *samples, size_t count)
+uint64_t sound_level_sum_sq_ref(const int16_t *samples, size_t count)
 {
-	if (count == 0) {
-		return 0;
-	}
-
 	uint64_t sum_sq = 0;
 
 	for (size_t i = 0; i < count; i++) {
@@ -26,6 +33,87 @@ uint16_t sound_level_rms(const int16_t *samples, size_t count)
 		sum_sq += (uint64_t)(s * s);
 	}
 
+	return sum_sq;
+}
+
+#if defined(__ARM_FEATURE_DSP)
+/*
+ * SMLALD multiplies both signed halfwords of its operands and adds the two
+ * products to a 64-bit accumulator, so squaring a packed sample pair against
+ * itself handles two samples per instruction. The main loop is unrolled by
+ * four words to keep the load/MAC pipeline busy.
+ */
+uint64_t sound_level_sum_sq_dsp(const int16_t *samples, size_t count)
+{
+	uint64_t acc = 0;
+	size_t i = 0;
+
+	/* Peel one sample if the buffer is only halfword-aligned */
+	if (((uintptr_t)samples & 0x3) && count > 0) {
+		int32_t s = samples[0];
+
+		acc = (uint64_t)(s * s);
+		i = 1;
+	}
+
+	for (; i + 8 <= count; i += 8) {
+		uint32_t p0, p1, p2, p3;
+
+		memcpy(&p0, &samples[i], sizeof(p0));
+		memcpy(&p1, &samples[i + 2], sizeof(p1));
+		memcpy(&p2, &samples[i + 4], sizeof(p2));
+		memcpy(&p3, &samples[i + 6], sizeof(p3));
+		acc = __SMLALD(p0, p0, acc);
+		acc = __SMLALD(p1, p1, acc);
+		acc = __SMLALD(p2, p2, acc);
+		acc = __SMLALD(p3, p3, acc);
+	}
+
+	for (; i + 2 <= count; i += 2) {
+		uint32_t p;
+
+		memcpy(&p, &samples[i], sizeof(p));
+		acc = __SMLALD(p, p, acc);
+	}
+
+	if (i < count) {
+		int32_t s = samples[i];
+
+		acc += (uint64_t)(s * s);
+	}
+
+	return acc;
+}
+#endif
+
+#if defined(CONFIG_CMSIS_DSP_STATISTICS)
+uint64_t sound_level_sum_sq_cmsis(const int16_t *samples, size_t count)
+{
+	/* 1.15 x 1.15 products accumulate in 34.30, i.e. the raw sum */
+	q63_t power = 0;
+
+	arm_power_q15((const q15_t *)samples, (uint32_t)count, &power);
+	return (uint64_t)power;
+}
+#endif
+
+uint64_t sound_level_sum_sq(const int16_t *samples, size_t count)
+{
+#if defined(CONFIG_IV_RMS_KERNEL_DSP) && defined(__ARM_FEATURE_DSP)
+	return sound_level_sum_sq_dsp(samples, count);
+#elif defined(CONFIG_IV_RMS_KERNEL_CMSIS_DSP)
+	return sound_level_sum_sq_cmsis(samples, count);
+#else
+	return sound_level_sum_sq_ref(samples, count);
+#endif
+}
+
+uint16_t sound_level_rms_from_sum(uint64_t sum_sq, size_t count)
+{
+	if (count == 0) {
+		return 0;
+	}
+
 	uint64_t mean_sq = sum_sq / count;
 
 	/* Integer square root via Newton's method */
@@ -33,8 +121,14 @@ uint16_t sound_level_rms(const int16_t *samples, size_t count)
 		return 0;
 	}
 
-	uint32_t x = (uint32_t)mean_sq;
-	uint32_t y = x;
+	uint32_t x = (uint32_t)MIN(mean_sq, UINT32_MAX);
+
+	/*
+	 * Start from the smallest power of two >= sqrt(x) so the iteration
+	 * descends monotonically in a handful of steps instead of ~16.
+	 */
+	uint32_t bits = 32 - __builtin_clz(x);
+	uint32_t y = 1U << ((bits + 1) / 2);
 
 	while (1) {
 		uint32_t next = (y + x / y) / 2;
@@ -47,6 +141,16 @@ uint16_t sound_level_rms(const int16_t *samples, size_t count)
 	return (uint16_t)MIN(y, UINT16_MAX);
 }
 
+uint16_t sound_level_rms(const int16_t *samples, size_t count)
+{
+	if (count == 0) {
+		return 0;
+	}
+
+	return sound_level_rms_from_sum(sound_level_sum_sq(samples, count),
+					count);
+}
+
 /*
  * Approximate 20*log10(rms/32767) using integer math.
  *
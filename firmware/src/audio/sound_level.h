@@ -13,6 +13,43 @@
  */
 uint16_t sound_level_rms(const int16_t *samples, size_t count);
 
+/**
+ * Sum of squared 16-bit PCM samples.
+ *
+ * Dispatches to the kernel chosen by CONFIG_IV_RMS_KERNEL_* (scalar,
+ * Cortex-M DSP SMLALD, or CMSIS-DSP). Every kernel returns exactly the
+ * same value as sound_level_sum_sq_ref().
+ *
+ * @param samples  Pointer to signed 16-bit PCM buffer.
+ * @param count    Number of samples.
+ * @return Sum of samples[i]^2.
+ */
+uint64_t sound_level_sum_sq(const int16_t *samples, size_t count);
+
+/**
+ * Portable scalar reference for sound_level_sum_sq().
+ */
+uint64_t sound_level_sum_sq_ref(const int16_t *samples, size_t count);
+
+#if defined(__ARM_FEATURE_DSP)
+/** SMLALD kernel, built on every core with the DSP extension. */
+uint64_t sound_level_sum_sq_dsp(const int16_t *samples, size_t count);
+#endif
+
+#if defined(CONFIG_CMSIS_DSP_STATISTICS)
+/** CMSIS-DSP arm_power_q15() kernel, built when the library is. */
+uint64_t sound_level_sum_sq_cmsis(const int16_t *samples, size_t count);
+#endif
+
+/**
+ * Integer RMS from a precomputed sum of squares.
+ *
+ * @param sum_sq  Sum of squared samples.
+ * @param count   Number of samples the sum covers.
+ * @return RMS amplitude (0–32767).
+ */
+uint16_t sound_level_rms_from_sum(uint64_t sum_sq, size_t count);
+
 /**
  * Convert RMS amplitude to approximate dB SPL.
  *
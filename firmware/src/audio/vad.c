@@ -0,0 +1,127 @@
+#include "vad.h"
+#include "sound_level.h"
+
+#include <string.h>
+#include <zephyr/sys/util.h>
+
+/*
+ * Lightweight voice activity detector.
+ *
+ * Features are all derived in one pass over the block:
+ *   - energy       sum(x^2), also split into four slices
+ *   - diff energy  sum((x[n] - x[n-1])^2), a first-order high-pass
+ *   - crossings    sign changes
+ *
+ * For a tone of frequency f the diff/energy ratio is ~(2*pi*f/fs)^2, so
+ * the ratio acts as a cheap spectral-centroid estimate: HVAC rumble sits
+ * far below voice, hiss far above. The zero-crossing frequency gives a
+ * second, independent estimate of the dominant frequency.
+ */
+
+/* Voice-band limits for the centroid estimate and zero-crossing rate */
+#define VAD_CENTROID_MIN_HZ  250
+#define VAD_CENTROID_MAX_HZ  3000
+#define VAD_ZC_MIN_HZ        100
+#define VAD_ZC_MAX_HZ        3000
+
+/* Reject blocks whose loudest quarter holds more than this share (Q8) */
+#define VAD_IMPULSE_SHARE_Q8 205  /* 80% */
+
+/* Noise floor rises by 1/16 dB every 100 ms, drops immediately */
+#define VAD_FLOOR_RISE_Q4    1
+#define VAD_FLOOR_RISE_MS    100
+
+/*
+ * (2*pi*f/fs)^2 in Q12, using 2*pi ~ 411775/65536. Q8 is too coarse:
+ * at 16 kHz the 250 Hz bound would round to 2/256, the ratio of 60 Hz
+ * mains hum.
+ */
+static uint32_t ratio_for_hz(uint32_t hz, uint32_t fs)
+{
+	uint64_t x_q16 = (411775ULL * hz) / fs;
+
+	return (uint32_t)((x_q16 * x_q16) >> 20);
+}
+
+void vad_init(struct vad_state *vad, const struct vad_cfg *cfg)
+{
+	memset(vad, 0, sizeof(*vad));
+	vad->cfg = *cfg;
+	vad->ratio_min_q12 = ratio_for_hz(VAD_CENTROID_MIN_HZ, cfg->sample_rate);
+	vad->ratio_max_q12 = ratio_for_hz(VAD_CENTROID_MAX_HZ, cfg->sample_rate);
+	vad->floor_db_q4 = UINT16_MAX;
+}
+
+void vad_process(struct vad_state *vad, const int16_t *samples, size_t count,
+		 struct vad_result *res)
+{
+	memset(res, 0, sizeof(*res));
+
+	if (count < 8) {
+		res->speech = vad->speech;
+		return;
+	}
+
+	uint64_t slice_sum[4] = { 0 };
+	uint64_t diff_sum = 0;
+	uint32_t crossings = 0;
+	size_t slice_len = count / 4;
+	int32_t prev = samples[0];
+
+	for (size_t i = 0; i < count; i++) {
+		int32_t s = samples[i];
+		int32_t d = s - prev;
+		size_t slice = MIN(i / slice_len, 3);
+
+		slice_sum[slice] += (uint64_t)(s * s);
+		diff_sum += (uint64_t)((int64_t)d * d);
+		crossings += (uint32_t)((s ^ prev) < 0);
+		prev = s;
+	}
+
+	uint64_t energy = slice_sum[0] + slice_sum[1] + slice_sum[2] +
+			  slice_sum[3];
+	uint64_t peak = MAX(MAX(slice_sum[0], slice_sum[1]),
+			    MAX(slice_sum[2], slice_sum[3]));
+
+	res->db = sound_level_rms_to_db(sound_level_rms_from_sum(energy, count));
+	res->zc_hz = (uint16_t)MIN(((uint64_t)crossings * vad->cfg.sample_rate) /
+				   (2 * count), UINT16_MAX);
+	res->ratio_q12 = energy ? (uint16_t)MIN((diff_sum << 12) / energy,
+						UINT16_MAX) : 0;
+
+	/* Track the noise floor: fall instantly, rise slowly */
+	uint32_t block_ms = count * 1000 / vad->cfg.sample_rate;
+	uint16_t db_q4 = (uint16_t)res->db << 4;
+
+	if (db_q4 < vad->floor_db_q4) {
+		vad->floor_db_q4 = db_q4;
+		vad->floor_ms = 0;
+	} else {
+		vad->floor_ms += block_ms;
+		while (vad->floor_ms >= VAD_FLOOR_RISE_MS) {
+			vad->floor_ms -= VAD_FLOOR_RISE_MS;
+			vad->floor_db_q4 += VAD_FLOOR_RISE_Q4;
+		}
+	}
+	res->floor_db = (uint8_t)(vad->floor_db_q4 >> 4);
+
+	bool loud = res->db >= res->floor_db + vad->cfg.margin_db;
+	bool voiced_zc = res->zc_hz >= VAD_ZC_MIN_HZ &&
+			 res->zc_hz <= VAD_ZC_MAX_HZ;
+	bool voiced_band = res->ratio_q12 >= vad->ratio_min_q12 &&
+			   res->ratio_q12 <= vad->ratio_max_q12;
+	bool impulse = energy && ((peak << 8) / energy) > VAD_IMPULSE_SHARE_Q8;
+
+	if (loud && voiced_zc && voiced_band && !impulse) {
+		vad->speech = true;
+		vad->hang_ms = vad->cfg.hangover_ms;
+	} else if (vad->hang_ms > block_ms) {
+		vad->hang_ms -= block_ms;
+	} else {
+		vad->hang_ms = 0;
+		vad->speech = false;
+	}
+
+	res->speech = vad->speech;
+}
@@ -0,0 +1,60 @@
+#ifndef AUDIO_VAD_H
+#define AUDIO_VAD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+struct vad_cfg {
+	uint32_t sample_rate;   /* Hz */
+	uint8_t  margin_db;     /* Required level above the noise floor */
+	uint16_t hangover_ms;   /* Hold speech flag through short pauses */
+};
+
+struct vad_state {
+	struct vad_cfg cfg;
+	uint32_t ratio_min_q12; /* Diff/energy ratio bounds for speech */
+	uint32_t ratio_max_q12;
+	uint16_t floor_db_q4;   /* Tracked noise floor, 4 fractional bits */
+	uint16_t floor_ms;      /* Time since the last floor rise step */
+	uint16_t hang_ms;
+	bool     speech;
+};
+
+struct vad_result {
+	bool     speech;        /* Block classified as (or held as) speech */
+	uint8_t  db;            /* Block level */
+	uint8_t  floor_db;      /* Current noise floor estimate */
+	uint16_t zc_hz;         /* Zero-crossing frequency */
+	uint16_t ratio_q12;     /* High/low band energy ratio (Q12) */
+};
+
+/**
+ * Initialize the voice activity detector.
+ *
+ * @param vad  Detector state.
+ * @param cfg  Configuration.
+ */
+void vad_init(struct vad_state *vad, const struct vad_cfg *cfg);
+
+/**
+ * Classify one PCM block as speech or non-speech.
+ *
+ * Integer-only single pass over the block computing short-term energy,
+ * zero-crossing rate, first-difference (high band) to raw energy ratio
+ * and the energy share of the loudest quarter-block. A block counts as
+ * speech when it sits margin_db above the tracked noise floor, its
+ * zero-crossing and band ratio fall in the voice range, and its energy
+ * is not concentrated in a single impulse. Floor tracking and hangover
+ * run on the block duration derived from count, so any block length
+ * works.
+ *
+ * @param vad      Detector state.
+ * @param samples  Signed 16-bit PCM block.
+ * @param count    Number of samples.
+ * @param res      Output: decision and features.
+ */
+void vad_process(struct vad_state *vad, const int16_t *samples, size_t count,
+		 struct vad_result *res);
+
+#endif /* AUDIO_VAD_H */
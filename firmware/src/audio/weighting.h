@@ -0,0 +1,55 @@
+#ifndef AUDIO_WEIGHTING_H
+#define AUDIO_WEIGHTING_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Frequency weighting curves applied ahead of RMS */
+enum weighting_curve {
+	WEIGHTING_Z = 0,  /* Flat (filter bypassed) */
+	WEIGHTING_A = 1,
+	WEIGHTING_C = 2,
+};
+
+#define WEIGHTING_MAX_SECTIONS 3
+
+/* Biquad coefficients in Q30; a0 is implicitly 1.0 */
+struct biquad_q30 {
+	int32_t b[3];
+	int32_t a[2];
+};
+
+struct weighting_filter {
+	enum weighting_curve curve;
+	const struct biquad_q30 *sections;
+	uint8_t num_sections;
+	/* Direct form I history per section: x[n-1], x[n-2], y[n-1], y[n-2] */
+	int32_t state[WEIGHTING_MAX_SECTIONS][4];
+};
+
+/**
+ * Select a weighting curve and clear the filter history.
+ *
+ * @param f            Filter state.
+ * @param curve        Weighting curve.
+ * @param sample_rate  PCM rate in Hz.
+ * @return 0 on success, -ENOTSUP if no coefficients exist for the rate.
+ */
+int weighting_init(struct weighting_filter *f, enum weighting_curve curve,
+		   uint32_t sample_rate);
+
+/**
+ * Filter a PCM block in place.
+ *
+ * Integer-only biquad cascade (Q30 coefficients, 64-bit accumulators).
+ * Filter history carries across calls so consecutive blocks are treated
+ * as one continuous stream. A no-op for WEIGHTING_Z.
+ *
+ * @param f        Filter state.
+ * @param samples  Signed 16-bit PCM buffer, overwritten with the output.
+ * @param count    Number of samples.
+ */
+void weighting_process(struct weighting_filter *f, int16_t *samples,
+		       size_t count);
+
+#endif /* AUDIO_WEIGHTING_H */
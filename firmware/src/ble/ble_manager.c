@@ -3,7 +3,15 @@
 #include <zephyr/kernel.h>
 #include <zephyr/bluetooth/bluetooth.h>
 #include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#if defined(CONFIG_IV_LEVEL_BROADCAST)
+#include <string.h>
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+#endif
+#endif
 
 LOG_MODULE_REGISTER(ble_manager, LOG_LEVEL_INF);
 
@@ -24,6 +32,42 @@ static void start_advertising(void)
 	}
 }
 
+static void mtu_exchange_cb(struct bt_conn *conn, uint8_t err,
+			    struct bt_gatt_exchange_params *params)
+{
+	if (err) {
+		LOG_WRN("MTU exchange failed (err 0x%02x)", err);
+	}
+}
+
+static struct bt_gatt_exchange_params mtu_exchange_params = {
+	.func = mtu_exchange_cb,
+};
+
+/*
+ * Ask for the largest ATT MTU, the longest link-layer packets and the
+ * 2M PHY, so a sync fits many records per notification and per
+ * connection event. The phone may grant less; each result is logged.
+ */
+static void request_fast_link(struct bt_conn *conn)
+{
+	int err = bt_gatt_exchange_mtu(conn, &mtu_exchange_params);
+
+	if (err) {
+		LOG_WRN("MTU exchange request failed: %d", err);
+	}
+
+	err = bt_conn_le_data_len_update(conn, BT_LE_DATA_LEN_PARAM_MAX);
+	if (err) {
+		LOG_WRN("Data length update request failed: %d", err);
+	}
+
+	err = bt_conn_le_phy_update(conn, BT_CONN_LE_PHY_PARAM_2M);
+	if (err) {
+		LOG_WRN("PHY update request failed: %d", err);
+	}
+}
+
 static void connected_cb(struct bt_conn *conn, uint8_t err)
 {
 	if (err) {
@@ -31,6 +75,7 @@ static void connected_cb(struct bt_conn *conn, uint8_t err)
 		return;
 	}
 	LOG_INF("Connected");
+	request_fast_link(conn);
 }
 
 static void disconnected_cb(struct bt_conn *conn, uint8_t reason)
@@ -39,11 +84,257 @@ static void disconnected_cb(struct bt_conn *conn, uint8_t reason)
 	start_advertising();
 }
 
+static void data_len_updated_cb(struct bt_conn *conn,
+				struct bt_conn_le_data_len_info *info)
+{
+	LOG_INF("Data length: tx %u B / %u us, rx %u B / %u us",
+		info->tx_max_len, info->tx_max_time,
+		info->rx_max_len, info->rx_max_time);
+}
+
+static void phy_updated_cb(struct bt_conn *conn,
+			   struct bt_conn_le_phy_info *info)
+{
+	LOG_INF("PHY: tx 0x%02x, rx 0x%02x", info->tx_phy, info->rx_phy);
+}
+
 BT_CONN_CB_DEFINE(conn_callbacks) = {
 	.connected = connected_cb,
 	.disconnected = disconnected_cb,
+	.le_data_len_updated = data_len_updated_cb,
+	.le_phy_updated = phy_updated_cb,
+};
+
+static void att_mtu_updated_cb(struct bt_conn *conn, uint16_t tx, uint16_t rx)
+{
+	LOG_INF("ATT MTU: tx %u, rx %u", tx, rx);
+}
+
+static struct bt_gatt_cb gatt_callbacks = {
+	.att_mtu_updated = att_mtu_updated_cb,
 };
 
+#if defined(CONFIG_IV_LEVEL_BROADCAST)
+
+/* One set for the connectable advertising, one for the broadcast */
+BUILD_ASSERT(CONFIG_BT_EXT_ADV_MAX_ADV_SET >= 2,
+	     "Level broadcast needs a second advertising set");
+
+#define BCAST_SLOT_MS    100
+#define BCAST_SLOTS      (1000 / BCAST_SLOT_MS)
+#define BCAST_DATA_SIZE  8
+
+/* Advertised about twice per payload, in 0.625 ms units */
+#define BCAST_ADV_INT    (MAX(CONFIG_IV_LEVEL_BROADCAST_INTERVAL_MS / 2, \
+			      100) * 8 / 5)
+
+/*
+ * Levels of the last second in 100 ms slots, keyed by uptime so a
+ * duty-cycled capture gap ages them out. Written by the monitor thread,
+ * read by the refresh work.
+ */
+static struct {
+	uint32_t slot;
+	uint8_t  db;
+} bcast_slots[BCAST_SLOTS];
+static uint8_t bcast_db;
+static bool bcast_triggered;
+static struct k_spinlock bcast_lock;
+
+/* The manufacturer data the controller last accepted */
+static uint8_t bcast_data[BCAST_DATA_SIZE];
+
+static struct bt_le_ext_adv *bcast_adv;
+static bool bcast_on;
+static uint32_t bcast_updates;
+
+static void bcast_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(bcast_work, bcast_work_handler);
+
+void ble_manager_broadcast_level(uint8_t db, bool triggered)
+{
+	uint32_t slot = k_uptime_get_32() / BCAST_SLOT_MS;
+	k_spinlock_key_t key = k_spin_lock(&bcast_lock);
+
+	if (bcast_slots[slot % BCAST_SLOTS].slot != slot) {
+		bcast_slots[slot % BCAST_SLOTS].slot = slot;
+		bcast_slots[slot % BCAST_SLOTS].db = db;
+	} else {
+		bcast_slots[slot % BCAST_SLOTS].db =
+			MAX(bcast_slots[slot % BCAST_SLOTS].db, db);
+	}
+	bcast_db = db;
+	bcast_triggered = triggered;
+
+	k_spin_unlock(&bcast_lock, key);
+}
+
+/* Pack [version, db, max_db, flags, battery] into out; true if it changed */
+static bool bcast_pack(uint8_t *out)
+{
+	uint32_t slot = k_uptime_get_32() / BCAST_SLOT_MS;
+	uint8_t max_db = 0;
+	uint8_t db;
+	bool triggered;
+	k_spinlock_key_t key = k_spin_lock(&bcast_lock);
+
+	for (int i = 0; i < BCAST_SLOTS; i++) {
+		if (slot - bcast_slots[i].slot < BCAST_SLOTS) {
+			max_db = MAX(max_db, bcast_slots[i].db);
+		}
+	}
+	db = bcast_db;
+	triggered = bcast_triggered;
+
+	k_spin_unlock(&bcast_lock, key);
+
+	uint8_t p[] = {
+		BLE_BCAST_VERSION,
+		db,
+		max_db,
+		triggered ? BLE_BCAST_FLAG_TRIGGERED : 0,
+		/* No battery gauge on this board yet */
+		BLE_BCAST_BATTERY_NONE,
+	};
+	bool changed = memcmp(out, p, sizeof(p)) != 0;
+
+	memcpy(out, p, sizeof(p));
+	return changed;
+}
+
+/* Advertise data; it becomes bcast_data only once the controller has
+ * taken it, so a failed update is retried with the same sequence number
+ */
+static int bcast_set_data(const uint8_t *data)
+{
+	const struct bt_data ad[] = {
+		BT_DATA(BT_DATA_NAME_COMPLETE, "InsideVoice",
+			sizeof("InsideVoice") - 1),
+		BT_DATA(BT_DATA_MANUFACTURER_DATA, data, BCAST_DATA_SIZE),
+	};
+	int err = bt_le_ext_adv_set_data(bcast_adv, ad, ARRAY_SIZE(ad), NULL,
+					 0);
+
+	if (!err) {
+		memcpy(bcast_data, data, BCAST_DATA_SIZE);
+	}
+	return err;
+}
+
+static void bcast_work_handler(struct k_work *work)
+{
+	uint8_t data[BCAST_DATA_SIZE];
+
+	if (!bcast_on) {
+		return;
+	}
+
+	/* An unchanged payload costs no HCI traffic */
+	memcpy(data, bcast_data, sizeof(data));
+	if (bcast_pack(&data[2])) {
+		data[7]++;
+
+		int err = bcast_set_data(data);
+
+		if (err) {
+			LOG_WRN("Broadcast update failed: %d", err);
+		} else {
+			bcast_updates++;
+		}
+	}
+
+	k_work_schedule(&bcast_work,
+			K_MSEC(CONFIG_IV_LEVEL_BROADCAST_INTERVAL_MS));
+}
+
+static int bcast_start(void)
+{
+	uint8_t data[BCAST_DATA_SIZE];
+	int err;
+
+	if (bcast_on) {
+		return 0;
+	}
+
+	memcpy(data, bcast_data, sizeof(data));
+	bcast_pack(&data[2]);
+	err = bcast_set_data(data);
+	if (!err) {
+		err = bt_le_ext_adv_start(bcast_adv, BT_LE_EXT_ADV_START_DEFAULT);
+	}
+	if (err) {
+		LOG_ERR("Broadcast start failed: %d", err);
+		return err;
+	}
+
+	bcast_on = true;
+	k_work_schedule(&bcast_work,
+			K_MSEC(CONFIG_IV_LEVEL_BROADCAST_INTERVAL_MS));
+	LOG_INF("Level broadcast started, every %u ms",
+		CONFIG_IV_LEVEL_BROADCAST_INTERVAL_MS);
+	return 0;
+}
+
+static int bcast_stop(void)
+{
+	if (!bcast_on) {
+		return 0;
+	}
+
+	bcast_on = false;
+	k_work_cancel_delayable(&bcast_work);
+	return bt_le_ext_adv_stop(bcast_adv);
+}
+
+static int bcast_init(void)
+{
+	/* Legacy non-connectable PDUs, so every phone's scanner sees it */
+	const struct bt_le_adv_param param =
+		BT_LE_ADV_PARAM_INIT(0, BCAST_ADV_INT,
+				     BCAST_ADV_INT + BCAST_ADV_INT / 8, NULL);
+	int err = bt_le_ext_adv_create(&param, NULL, &bcast_adv);
+
+	if (err) {
+		LOG_ERR("Broadcast set create failed: %d", err);
+		return err;
+	}
+
+	sys_put_le16(CONFIG_IV_LEVEL_BROADCAST_COMPANY_ID, &bcast_data[0]);
+	return bcast_start();
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_iv_bcast(const struct shell *sh, size_t argc, char **argv)
+{
+	if (argc == 2) {
+		int err = !strcmp(argv[1], "on") ? bcast_start() :
+			  !strcmp(argv[1], "off") ? bcast_stop() : -EINVAL;
+
+		if (err) {
+			shell_error(sh, "bcast on|off: %d", err);
+			return err;
+		}
+	}
+
+	shell_print(sh, "broadcast %s, every %u ms, %u updates",
+		    bcast_on ? "on" : "off",
+		    CONFIG_IV_LEVEL_BROADCAST_INTERVAL_MS, bcast_updates);
+	shell_print(sh, "payload   %u dB, max %u dB, flags 0x%02x, "
+		    "battery 0x%02x, seq %u", bcast_data[3], bcast_data[4],
+		    bcast_data[5], bcast_data[6], bcast_data[7]);
+	return 0;
+}
+
+SHELL_SUBCMD_ADD((iv), bcast, NULL, "Level broadcast: bcast [on|off]",
+		 cmd_iv_bcast, 1, 1);
+#endif
+
+#else
+
+static inline int bcast_init(void) { return 0; }
+
+#endif /* CONFIG_IV_LEVEL_BROADCAST */
+
 int ble_manager_init(void)
 {
 	int err = bt_enable(NULL);
@@ -54,7 +345,14 @@ int ble_manager_init(void)
 	}
 
 	LOG_INF("Bluetooth initialized");
+	bt_gatt_cb_register(&gatt_callbacks);
 	start_advertising();
 
+	/* The connection does not depend on the broadcast */
+	err = bcast_init();
+	if (err) {
+		LOG_WRN("Level broadcast unavailable: %d", err);
+	}
+
 	return 0;
 }
@@ -1,6 +1,12 @@
 #ifndef BLE_BLE_MANAGER_H
 #define BLE_BLE_MANAGER_H
 
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/sys/util.h>
+
+#if defined(CONFIG_BT)
+
 /**
  * Initialize the BLE stack, register connection callbacks,
  * and begin advertising as "InsideVoice" peripheral.
@@ -9,4 +15,40 @@
  */
 int ble_manager_init(void);
 
+#else
+
+static inline int ble_manager_init(void) { return 0; }
+
+#endif /* CONFIG_BT */
+
+/*
+ * Level broadcast (CONFIG_IV_LEVEL_BROADCAST): a non-connectable set
+ * advertises, alongside the connectable one, the manufacturer data
+ *   [company_le16, version, db, max_db, flags, battery, seq]
+ * where max_db is the loudest level of the last second, flags bit 0 is
+ * the trigger state, battery is in percent (0xFF: not measured) and seq
+ * counts payload changes. It is refreshed every
+ * CONFIG_IV_LEVEL_BROADCAST_INTERVAL_MS.
+ */
+#define BLE_BCAST_VERSION        1
+#define BLE_BCAST_FLAG_TRIGGERED BIT(0)
+#define BLE_BCAST_BATTERY_NONE   0xFF
+
+#if defined(CONFIG_IV_LEVEL_BROADCAST)
+
+/**
+ * Record the current level for the broadcast. Only updates the values
+ * the next refresh advertises; safe from any thread.
+ *
+ * @param db         Current sound level in dB.
+ * @param triggered  True while the level detector is triggered.
+ */
+void ble_manager_broadcast_level(uint8_t db, bool triggered);
+
+#else
+
+static inline void ble_manager_broadcast_level(uint8_t db, bool triggered) {}
+
+#endif /* CONFIG_IV_LEVEL_BROADCAST */
+
 #endif /* BLE_BLE_MANAGER_H */
@@ -0,0 +1,18 @@
+#include "ble_tx.h"
+
+#define BLE_TX_STACK_SIZE 2048
+#define BLE_TX_PRIORITY   8  /* Below the monitor thread, above history */
+
+/* Sync handlers build frames in static buffers, but the GATT and L2CAP
+ * send paths need the stack the system workqueue gave them
+ */
+K_THREAD_STACK_DEFINE(ble_tx_stack, BLE_TX_STACK_SIZE);
+struct k_work_q ble_tx_wq;
+
+void ble_tx_init(void)
+{
+	k_work_queue_start(&ble_tx_wq, ble_tx_stack,
+			   K_THREAD_STACK_SIZEOF(ble_tx_stack),
+			   BLE_TX_PRIORITY, NULL);
+	k_thread_name_set(&ble_tx_wq.thread, "ble_tx");
+}
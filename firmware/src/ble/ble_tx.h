@@ -0,0 +1,34 @@
+#ifndef BLE_BLE_TX_H
+#define BLE_BLE_TX_H
+
+#include <zephyr/kernel.h>
+
+/**
+ * Workqueue for bulk BLE transmission: the history, rollup and L2CAP
+ * syncs. It runs below the capture, monitor and feedback threads, so a
+ * sync only gets the CPU they leave and can be preempted between any
+ * two packets. Unlike the system workqueue, a notification sent from it
+ * may wait for a TX buffer instead of failing.
+ *
+ * The live level and spectrum notifications stay on the system
+ * workqueue: they are one small packet each and are better dropped than
+ * queued behind a sync.
+ */
+
+#if defined(CONFIG_BT)
+
+extern struct k_work_q ble_tx_wq;
+
+/**
+ * Start the BLE TX workqueue. Must be called before advertising
+ * starts, so that no sync can be requested before it runs.
+ */
+void ble_tx_init(void);
+
+#else
+
+static inline void ble_tx_init(void) {}
+
+#endif /* CONFIG_BT */
+
+#endif /* BLE_BLE_TX_H */
@@ -1,12 +1,29 @@
 #include "config_service.h"
 #include "../app/config.h"
 #include "../app/data_cache.h"
+#include "../app/history.h"
+#include "../app/level_feed.h"
+#include "../app/level_stats.h"
+#include "../app/monitor.h"
+#include "../app/profiler.h"
+#include "../app/rollup.h"
+#include "../app/sync_stream.h"
+#include "../audio/band_analyzer.h"
+#include "../audio/weighting.h"
+#include "ble_tx.h"
+#include "conn_policy.h"
 
+#include <string.h>
 #include <zephyr/kernel.h>
 #include <zephyr/bluetooth/bluetooth.h>
 #include <zephyr/bluetooth/gatt.h>
 #include <zephyr/bluetooth/uuid.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+#endif
 
 LOG_MODULE_REGISTER(config_service, LOG_LEVEL_INF);
 
@@ -27,6 +44,16 @@ LOG_MODULE_REGISTER(config_service, LOG_LEVEL_INF);
 	BT_UUID_128_ENCODE(0x4f490005, 0x2ff1, 0x4a5e, 0xa683, 0x4de2c5a10100)
 #define IV_SYNC_DATA_UUID_VAL \
 	BT_UUID_128_ENCODE(0x4f490006, 0x2ff1, 0x4a5e, 0xa683, 0x4de2c5a10100)
+#define IV_WEIGHTING_UUID_VAL \
+	BT_UUID_128_ENCODE(0x4f490007, 0x2ff1, 0x4a5e, 0xa683, 0x4de2c5a10100)
+#define IV_SPECTRUM_UUID_VAL \
+	BT_UUID_128_ENCODE(0x4f490008, 0x2ff1, 0x4a5e, 0xa683, 0x4de2c5a10100)
+#define IV_PIPELINE_STATS_UUID_VAL \
+	BT_UUID_128_ENCODE(0x4f490009, 0x2ff1, 0x4a5e, 0xa683, 0x4de2c5a10100)
+#define IV_LEVEL_STATS_UUID_VAL \
+	BT_UUID_128_ENCODE(0x4f49000a, 0x2ff1, 0x4a5e, 0xa683, 0x4de2c5a10100)
+#define IV_LEVEL_MODE_UUID_VAL \
+	BT_UUID_128_ENCODE(0x4f49000b, 0x2ff1, 0x4a5e, 0xa683, 0x4de2c5a10100)
 
 static struct bt_uuid_128 iv_svc_uuid = BT_UUID_INIT_128(IV_SVC_UUID_VAL);
 static struct bt_uuid_128 iv_threshold_uuid = BT_UUID_INIT_128(IV_THRESHOLD_UUID_VAL);
@@ -35,10 +62,64 @@ static struct bt_uuid_128 iv_fb_mode_uuid = BT_UUID_INIT_128(IV_FB_MODE_UUID_VAL
 static struct bt_uuid_128 iv_sample_count_uuid = BT_UUID_INIT_128(IV_SAMPLE_COUNT_UUID_VAL);
 static struct bt_uuid_128 iv_sync_ctrl_uuid    = BT_UUID_INIT_128(IV_SYNC_CTRL_UUID_VAL);
 static struct bt_uuid_128 iv_sync_data_uuid    = BT_UUID_INIT_128(IV_SYNC_DATA_UUID_VAL);
+static struct bt_uuid_128 iv_weighting_uuid    = BT_UUID_INIT_128(IV_WEIGHTING_UUID_VAL);
+static struct bt_uuid_128 iv_spectrum_uuid     = BT_UUID_INIT_128(IV_SPECTRUM_UUID_VAL);
+static struct bt_uuid_128 iv_pipeline_stats_uuid =
+	BT_UUID_INIT_128(IV_PIPELINE_STATS_UUID_VAL);
+static struct bt_uuid_128 iv_level_stats_uuid =
+	BT_UUID_INIT_128(IV_LEVEL_STATS_UUID_VAL);
+static struct bt_uuid_128 iv_level_mode_uuid =
+	BT_UUID_INIT_128(IV_LEVEL_MODE_UUID_VAL);
+
+#if defined(CONFIG_IV_PROFILER)
+/* Diagnostics service: 4f490100-2ff1-4a5e-a683-4de2c5a10100 */
+#define IV_DIAG_SVC_UUID_VAL \
+	BT_UUID_128_ENCODE(0x4f490100, 0x2ff1, 0x4a5e, 0xa683, 0x4de2c5a10100)
+#define IV_DIAG_PROFILE_UUID_VAL \
+	BT_UUID_128_ENCODE(0x4f490101, 0x2ff1, 0x4a5e, 0xa683, 0x4de2c5a10100)
+
+static struct bt_uuid_128 iv_diag_svc_uuid = BT_UUID_INIT_128(IV_DIAG_SVC_UUID_VAL);
+static struct bt_uuid_128 iv_diag_profile_uuid =
+	BT_UUID_INIT_128(IV_DIAG_PROFILE_UUID_VAL);
+#endif
 
 /* Current sound level (updated from monitor thread) */
 static uint8_t current_level_db;
 
+/*
+ * Live level stream. The feed is only touched by the monitor thread;
+ * a mode written over BLE, or a new subscription, is picked up on its
+ * next level. The notification it builds is handed to level_work under
+ * level_lock.
+ */
+static bool level_subscribed;
+static uint8_t level_mode = LEVEL_FEED_STREAM;
+static uint8_t level_arg;
+static atomic_t level_feed_stale = ATOMIC_INIT(1);
+static struct level_feed level_feed;
+static uint8_t level_tx[LEVEL_FEED_MAX_SIZE];
+static uint16_t level_tx_len;
+static struct k_spinlock level_lock;
+
+/* Latest octave-band levels (updated from monitor thread) */
+static uint8_t current_bands[BAND_COUNT];
+static struct k_spinlock bands_lock;
+
+static void bands_get(uint8_t *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&bands_lock);
+
+	memcpy(out, current_bands, sizeof(current_bands));
+	k_spin_unlock(&bands_lock, key);
+}
+
+/*
+ * Notifications are sent from work items so a slow BLE stack never
+ * stalls the monitor thread.
+ */
+static struct k_work level_work;
+static struct k_work bands_work;
+
 /* --- Threshold characteristic --- */
 
 static ssize_t threshold_read(struct bt_conn *conn,
@@ -97,6 +178,39 @@ static ssize_t fb_mode_write(struct bt_conn *conn,
 	return len;
 }
 
+/* --- Weighting characteristic --- */
+
+static ssize_t weighting_read(struct bt_conn *conn,
+			      const struct bt_gatt_attr *attr,
+			      void *buf, uint16_t len, uint16_t offset)
+{
+	struct app_config cfg = app_config_get();
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset,
+				 &cfg.weighting, sizeof(cfg.weighting));
+}
+
+static ssize_t weighting_write(struct bt_conn *conn,
+			       const struct bt_gatt_attr *attr,
+			       const void *buf, uint16_t len,
+			       uint16_t offset, uint8_t flags)
+{
+	if (len != sizeof(uint8_t) || offset != 0) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	}
+
+	uint8_t val = *((const uint8_t *)buf);
+
+	if (val > WEIGHTING_C) {
+		return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+	}
+
+	app_config_set_weighting(val);
+	LOG_INF("Weighting set via BLE: %u", val);
+
+	return len;
+}
+
 /* --- Sound level characteristic (read + notify) --- */
 
 static ssize_t level_read(struct bt_conn *conn,
@@ -109,10 +223,120 @@ static ssize_t level_read(struct bt_conn *conn,
 
 static void level_ccc_changed(const struct bt_gatt_attr *attr, uint16_t value)
 {
+	level_subscribed = value == BT_GATT_CCC_NOTIFY;
+	atomic_set(&level_feed_stale, 1);
+	conn_policy_demand(CONN_DEMAND_LEVEL, level_subscribed);
 	LOG_INF("Sound level notifications %s",
+		level_subscribed ? "enabled" : "disabled");
+}
+
+/* --- Level mode characteristic (R/W): [mode, arg] --- */
+
+static ssize_t level_mode_read(struct bt_conn *conn,
+			       const struct bt_gatt_attr *attr,
+			       void *buf, uint16_t len, uint16_t offset)
+{
+	uint8_t val[] = { level_mode, level_arg };
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset,
+				 val, sizeof(val));
+}
+
+static ssize_t level_mode_write(struct bt_conn *conn,
+				const struct bt_gatt_attr *attr,
+				const void *buf, uint16_t len,
+				uint16_t offset, uint8_t flags)
+{
+	const uint8_t *data = buf;
+	struct level_feed probe;
+
+	if (len != 2 || offset != 0) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	}
+	if (level_feed_set(&probe, data[0], data[1])) {
+		return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+	}
+
+	level_mode = data[0];
+	level_arg = data[1];
+	atomic_set(&level_feed_stale, 1);
+	LOG_INF("Level mode set via BLE: %u (%u)", level_mode, level_arg);
+
+	return len;
+}
+
+/* --- Spectrum characteristic (read + notify) --- */
+
+static ssize_t spectrum_read(struct bt_conn *conn,
+			     const struct bt_gatt_attr *attr,
+			     void *buf, uint16_t len, uint16_t offset)
+{
+	uint8_t bands[BAND_COUNT];
+
+	bands_get(bands);
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, bands,
+				 sizeof(bands));
+}
+
+static void spectrum_ccc_changed(const struct bt_gatt_attr *attr,
+				 uint16_t value)
+{
+	conn_policy_demand(CONN_DEMAND_SPECTRUM, value == BT_GATT_CCC_NOTIFY);
+	LOG_INF("Spectrum notifications %s",
 		value == BT_GATT_CCC_NOTIFY ? "enabled" : "disabled");
 }
 
+/* --- Pipeline stats characteristic (Read) --- */
+
+static ssize_t pipeline_stats_read(struct bt_conn *conn,
+				   const struct bt_gatt_attr *attr,
+				   void *buf, uint16_t len, uint16_t offset)
+{
+	struct monitor_stats st;
+
+	monitor_get_stats(&st);
+
+	uint32_t val[] = {
+		sys_cpu_to_le32(st.blocks),
+		sys_cpu_to_le32(st.dropped),
+		sys_cpu_to_le32(st.queue_hwm),
+		sys_cpu_to_le32(st.queue_lat_avg_us),
+		sys_cpu_to_le32(st.queue_lat_max_us),
+		sys_cpu_to_le32(st.analysis_avg_us),
+		sys_cpu_to_le32(st.analysis_max_us),
+	};
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset,
+				 val, sizeof(val));
+}
+
+/* --- Level stats characteristic (Read) --- */
+
+#define LEVEL_STATS_SIZE 22
+
+static ssize_t level_stats_read(struct bt_conn *conn,
+				const struct bt_gatt_attr *attr,
+				void *buf, uint16_t len, uint16_t offset)
+{
+	struct level_stats st;
+	uint8_t val[LEVEL_STATS_SIZE];
+
+	level_stats_get(&st);
+
+	sys_put_le32(st.duration_ms, &val[0]);
+	sys_put_le16(st.leq_ddb, &val[4]);
+	val[6] = st.l10_db;
+	val[7] = st.l50_db;
+	val[8] = st.l90_db;
+	val[9] = st.lmax_db;
+	sys_put_le32(st.over_ms, &val[10]);
+	sys_put_le32(st.episodes, &val[14]);
+	sys_put_le32(st.dose_cpct, &val[18]);
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset,
+				 val, sizeof(val));
+}
+
 /* Forward-declare service so sync_work_handler can reference attrs */
 extern const struct bt_gatt_service_static iv_svc;
 
@@ -122,7 +346,7 @@ static ssize_t sample_count_read(struct bt_conn *conn,
 				 const struct bt_gatt_attr *attr,
 				 void *buf, uint16_t len, uint16_t offset)
 {
-	uint32_t count = data_cache_count();
+	uint32_t count = history_count();
 	return bt_gatt_attr_read(conn, attr, buf, len, offset,
 				 &count, sizeof(count));
 }
@@ -135,13 +359,179 @@ static void sync_data_ccc_changed(const struct bt_gatt_attr *attr, uint16_t valu
 		value == BT_GATT_CCC_NOTIFY ? "enabled" : "disabled");
 }
 
-/* Sync work: streams cache samples then sends sentinel */
+/*
+ * Sync work: streams a snapshot of the history, then marks the end.
+ *
+ * 0x01 sends one 5-byte record per notification and ends with a 0xFF x 5
+ * sentinel. 0x04 and 0x05 <seq> send sync_stream frames as large as the
+ * ATT MTU allows, from the oldest unsynced sample or from seq.
+ *
+ * Notifications are paced by their sent callbacks: at most
+ * SYNC_TX_CREDITS are queued in the stack, and each one that completes
+ * wakes the work for the next.
+ *
+ * The work runs on ble_tx_wq, where the BT RX thread can preempt it. Sync
+ * Control writes therefore only post a request under sync_req_lock; the
+ * work takes it and is the only one to touch the sync state.
+ *
+ * A history sync and a rollup sync (0x03) would interleave on Sync Data,
+ * so Sync Control refuses either while the other owns it. The credits are
+ * shared: whichever owns Sync Data refills them when it starts.
+ */
+#define SYNC_TX_CREDITS 6
+#define SYNC_RETRY_MS   20  /* Out of buffers with none of ours in flight */
+
+#define SYNC_FRAME_MAX_SIZE (CONFIG_BT_L2CAP_TX_MTU - 3)
+
+enum sync_state {
+	SYNC_IDLE,
+	SYNC_START,
+	SYNC_STREAMING,
+};
+
+enum sync_owner {
+	SYNC_OWNER_NONE,
+	SYNC_OWNER_HISTORY,  /* 0x01, 0x04, 0x05 until sync_finish() */
+	SYNC_OWNER_ROLLUP,   /* 0x03 until its sentinel */
+};
+
+struct sync_req {
+	bool     start;
+	bool     release;  /* 0x02: drop what the last sync streamed */
+	bool     framed;
+	bool     resume;
+	uint16_t mtu;
+	uint32_t from;
+};
+
+/* Throughput of the last sync, for `iv sync` */
+struct sync_run {
+	bool     framed;
+	uint16_t mtu;
+	uint32_t records;
+	uint32_t notifies;
+	uint32_t bytes;
+	uint32_t ms;
+};
+
+static struct k_spinlock sync_req_lock;
+static struct sync_req sync_req;
+
 static struct k_work_delayable sync_work;
-static uint32_t sync_start_idx;
+static enum sync_state sync_state;
+static bool sync_framed;
+static uint16_t sync_mtu;
+static bool sync_resume;
+static uint32_t sync_from;
+static struct sync_stream sync_stream;
+static bool sync_stream_valid;
+static atomic_t sync_credits = ATOMIC_INIT(SYNC_TX_CREDITS);
+static atomic_t sync_owner = ATOMIC_INIT(SYNC_OWNER_NONE);
+static int64_t sync_t0;
+static struct sync_run sync_run;
+
+/* Work stack is small: the frame being built lives here */
+static uint8_t sync_frame[MAX(SYNC_FRAME_MAX_SIZE, IV_SAMPLE_RECORD_SIZE)];
+
+static void credit_return(void)
+{
+	/* Credits are refilled when a sync starts; drop late returns */
+	if (atomic_inc(&sync_credits) >= SYNC_TX_CREDITS) {
+		atomic_dec(&sync_credits);
+	}
+}
+
+static void sync_sent(struct bt_conn *conn, void *user_data)
+{
+	credit_return();
+	k_work_reschedule_for_queue(&ble_tx_wq, &sync_work, K_NO_WAIT);
+}
+
+/* Hand Sync Data back, unless Sync Control has already asked for the
+ * next history sync
+ */
+static void sync_release_owner(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&sync_req_lock);
+
+	if (!sync_req.start) {
+		atomic_cas(&sync_owner, SYNC_OWNER_HISTORY, SYNC_OWNER_NONE);
+	}
+	k_spin_unlock(&sync_req_lock, key);
+}
+
+static void sync_stop(void)
+{
+	sync_state = SYNC_IDLE;
+	conn_policy_demand(CONN_DEMAND_SYNC, false);
+	sync_release_owner();
+}
+
+static void sync_finish(void)
+{
+	sync_run.ms = (uint32_t)(k_uptime_get() - sync_t0);
+	sync_stop();
+	LOG_INF("Sync done: %u records in %u notifications, %u ms, %u B/s",
+		sync_run.records, sync_run.notifies, sync_run.ms,
+		sync_run.ms ? (uint32_t)((uint64_t)sync_run.bytes * 1000U /
+					 sync_run.ms) : 0);
+}
+
+/* Apply what Sync Control asked for since the last run */
+static void sync_take_request(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&sync_req_lock);
+	struct sync_req req = sync_req;
+
+	sync_req.start = false;
+	sync_req.release = false;
+	k_spin_unlock(&sync_req_lock, key);
+
+	if (req.release) {
+		/* Drop only what the last sync streamed */
+		if (sync_stream_valid) {
+			sync_stream_release(&sync_stream);
+			sync_stream_valid = false;
+		} else {
+			history_clear();
+		}
+		LOG_INF("Cache cleared");
+	}
+	if (req.start) {
+		sync_framed = req.framed;
+		sync_mtu = req.mtu;
+		sync_resume = req.resume;
+		sync_from = req.from;
+		sync_state = SYNC_START;
+	}
+}
 
 static void sync_work_handler(struct k_work *work)
 {
-	uint32_t count = data_cache_count();
+	sync_take_request();
+
+	if (sync_state == SYNC_IDLE) {
+		/* Woken by a late sent callback */
+		return;
+	}
+
+	if (sync_state == SYNC_START) {
+		conn_policy_demand(CONN_DEMAND_SYNC, true);
+		sync_stream_open(&sync_stream);
+		if (sync_resume && !sync_stream_seek(&sync_stream, sync_from)) {
+			LOG_INF("Sync from %u not held, from oldest %u",
+				sync_from, sync_stream_seq(&sync_stream));
+		}
+		sync_stream_valid = true;
+		atomic_set(&sync_credits, SYNC_TX_CREDITS);
+		sync_t0 = k_uptime_get();
+		sync_run = (struct sync_run){
+			.framed = sync_framed,
+			.mtu = sync_mtu,
+		};
+		sync_state = SYNC_STREAMING;
+	}
+
 	/* Find the sync_data notify attribute — index 13 in iv_svc
 	 * Layout: [0]svc [1]thresh_decl [2]thresh_val [3]level_decl [4]level_val
 	 *         [5]level_ccc [6]fbmode_decl [7]fbmode_val
@@ -150,29 +540,216 @@ static void sync_work_handler(struct k_work *work)
 	 */
 	const struct bt_gatt_attr *notify_attr = &iv_svc.attrs[13];
 
-	for (uint32_t i = sync_start_idx; i < count; i++) {
-		struct iv_sample s;
-		if (!data_cache_get(i, &s)) {
-			continue;
+	/* ATT notification header is 3 bytes */
+	uint32_t size = MIN(sync_mtu - 3U, SYNC_FRAME_MAX_SIZE);
+
+	PROF_START(t);
+
+	for (;;) {
+		if (atomic_dec(&sync_credits) <= 0) {
+			/* All in flight — sync_sent() resumes */
+			atomic_inc(&sync_credits);
+			break;
 		}
-		uint8_t record[5];
-		record[0] = (uint8_t)(s.uptime_ms & 0xFF);
-		record[1] = (uint8_t)((s.uptime_ms >> 8) & 0xFF);
-		record[2] = (uint8_t)((s.uptime_ms >> 16) & 0xFF);
-		record[3] = (uint8_t)((s.uptime_ms >> 24) & 0xFF);
-		record[4] = s.db;
-		int ret = bt_gatt_notify(NULL, notify_attr, record, sizeof(record));
+
+		uint16_t len = IV_SAMPLE_RECORD_SIZE;
+		uint32_t count = sync_framed ?
+			sync_stream_frame(&sync_stream, sync_frame, size, &len) :
+			sync_stream_record(&sync_stream, sync_frame);
+		struct bt_gatt_notify_params params = {
+			.attr = notify_attr,
+			.data = sync_frame,
+			.len = len,
+			.func = sync_sent,
+		};
+		int ret = bt_gatt_notify_cb(NULL, &params);
+
 		if (ret == -ENOMEM) {
-			/* Congestion — resume from this index after 20 ms */
-			sync_start_idx = i;
-			k_work_schedule(&sync_work, K_MSEC(20));
-			return;
+			/* Buffers taken by other notifications: resume when
+			 * one of ours completes, or after SYNC_RETRY_MS
+			 */
+			atomic_inc(&sync_credits);
+			k_work_schedule_for_queue(&ble_tx_wq, &sync_work,
+						  K_MSEC(SYNC_RETRY_MS));
+			break;
+		}
+		if (ret) {
+			atomic_inc(&sync_credits);
+			LOG_WRN("Sync aborted: %d", ret);
+			sync_stop();
+			break;
+		}
+
+		sync_stream_commit(&sync_stream);
+		sync_run.records += count;
+		sync_run.notifies++;
+		sync_run.bytes += len;
+		if (count == 0) {
+			sync_finish();
+			break;
 		}
 	}
-	/* Send sentinel */
-	uint8_t sentinel[5] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
-	bt_gatt_notify(NULL, notify_attr, sentinel, sizeof(sentinel));
-	sync_start_idx = 0;
+
+	PROF_END(PROF_STAGE_SYNC, t);
+}
+
+/* Returns -EBUSY for a start while a rollup sync owns Sync Data */
+static int sync_request(const struct sync_req *req)
+{
+	k_spinlock_key_t key = k_spin_lock(&sync_req_lock);
+	bool release = sync_req.release || req->release;
+
+	if (req->start &&
+	    !atomic_cas(&sync_owner, SYNC_OWNER_NONE, SYNC_OWNER_HISTORY) &&
+	    atomic_get(&sync_owner) != SYNC_OWNER_HISTORY) {
+		k_spin_unlock(&sync_req_lock, key);
+		return -EBUSY;
+	}
+	if (req->start) {
+		sync_req = *req;
+	}
+	sync_req.release = release;
+	k_spin_unlock(&sync_req_lock, key);
+	k_work_reschedule_for_queue(&ble_tx_wq, &sync_work, K_NO_WAIT);
+	return 0;
+}
+
+static int sync_start(bool framed, uint16_t mtu, bool resume,
+		      uint32_t from_seq)
+{
+	return sync_request(&(struct sync_req){
+		.start = true,
+		.framed = framed,
+		.resume = resume,
+		.mtu = mtu,
+		.from = from_seq,
+	});
+}
+
+/* Rollup sync: a header, the closed buckets of one tier packed
+ * ROLLUP_PER_NOTIFY to a notification, then the sentinel. Paced by the
+ * sync credits, as the history sync is.
+ */
+#define ROLLUP_PER_NOTIFY 5  /* 20 bytes, within the default ATT MTU */
+#define ROLLUP_HDR_SIZE   13
+
+static struct k_work_delayable rollup_work;
+static atomic_t rollup_req;  /* Tier + 1 requested by Sync Control */
+static enum rollup_tier rollup_tier;
+static struct iv_cursor rollup_cursor;
+static uint32_t rollup_idx;
+static bool rollup_hdr_sent;
+
+static void rollup_sent(struct bt_conn *conn, void *user_data)
+{
+	credit_return();
+	k_work_reschedule_for_queue(&ble_tx_wq, &rollup_work, K_NO_WAIT);
+}
+
+/* Queue one notification on a credit. -EAGAIN when out of credits or
+ * buffers: rollup_sent() resumes, or the retry if none are in flight.
+ */
+static int rollup_notify(const void *data, uint16_t len)
+{
+	if (atomic_dec(&sync_credits) <= 0) {
+		atomic_inc(&sync_credits);
+		return -EAGAIN;
+	}
+
+	struct bt_gatt_notify_params params = {
+		.attr = &iv_svc.attrs[13],
+		.data = data,
+		.len = len,
+		.func = rollup_sent,
+	};
+	int ret = bt_gatt_notify_cb(NULL, &params);
+
+	if (ret == 0) {
+		return 0;
+	}
+	atomic_inc(&sync_credits);
+	if (ret == -ENOMEM) {
+		if (atomic_get(&sync_credits) == SYNC_TX_CREDITS) {
+			k_work_schedule_for_queue(&ble_tx_wq, &rollup_work,
+						  K_MSEC(SYNC_RETRY_MS));
+		}
+		return -EAGAIN;
+	}
+	return ret;
+}
+
+static void rollup_work_handler(struct k_work *work)
+{
+	atomic_val_t req = atomic_clear(&rollup_req);
+	int err;
+
+	if (req) {
+		rollup_tier = req - 1;
+		rollup_hdr_sent = false;
+		atomic_set(&sync_credits, SYNC_TX_CREDITS);
+		conn_policy_demand(CONN_DEMAND_ROLLUP, true);
+	} else if (atomic_get(&sync_owner) != SYNC_OWNER_ROLLUP) {
+		/* Woken by a late sent callback */
+		return;
+	}
+
+	uint32_t bucket_ms = rollup_bucket_ms(rollup_tier);
+
+	if (!rollup_hdr_sent) {
+		/* [tier, count_le16, bucket_s_le16, end_ms_le32, now_ms_le32]:
+		 * bucket i of count started at end_ms - (count - i) * bucket
+		 */
+		uint8_t hdr[ROLLUP_HDR_SIZE];
+
+		rollup_snapshot(rollup_tier, &rollup_cursor);
+		rollup_idx = 0;
+		hdr[0] = rollup_tier;
+		sys_put_le16((uint16_t)iv_cursor_count(&rollup_cursor), &hdr[1]);
+		sys_put_le16((uint16_t)(bucket_ms / 1000U), &hdr[3]);
+		sys_put_le32((uint32_t)((uint64_t)rollup_cursor.end * bucket_ms),
+			     &hdr[5]);
+		sys_put_le32((uint32_t)k_uptime_get(), &hdr[9]);
+		err = rollup_notify(hdr, sizeof(hdr));
+		if (err) {
+			goto out;
+		}
+		rollup_hdr_sent = true;
+	}
+
+	for (;;) {
+		struct rollup_bucket b[ROLLUP_PER_NOTIFY];
+		uint8_t rec[ROLLUP_PER_NOTIFY * ROLLUP_RECORD_SIZE];
+		uint32_t n = rollup_read(rollup_tier, &rollup_cursor, rollup_idx,
+					 b, ARRAY_SIZE(b));
+
+		if (n == 0) {
+			break;
+		}
+		for (uint32_t i = 0; i < n; i++) {
+			rollup_pack(&b[i], &rec[i * ROLLUP_RECORD_SIZE]);
+		}
+		err = rollup_notify(rec, n * ROLLUP_RECORD_SIZE);
+		if (err) {
+			goto out;
+		}
+		rollup_idx += n;
+	}
+
+	static const uint8_t sentinel[IV_SAMPLE_RECORD_SIZE] = {
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	};
+
+	err = rollup_notify(sentinel, sizeof(sentinel));
+
+out:
+	if (err == -EAGAIN) {
+		return;
+	}
+	if (err) {
+		LOG_WRN("Rollup sync aborted: %d", err);
+	}
+	conn_policy_demand(CONN_DEMAND_ROLLUP, false);
+	atomic_cas(&sync_owner, SYNC_OWNER_ROLLUP, SYNC_OWNER_NONE);
 }
 
 /* --- Sync Control characteristic (Write) --- */
@@ -182,17 +759,57 @@ static ssize_t sync_ctrl_write(struct bt_conn *conn,
 			       const void *buf, uint16_t len,
 			       uint16_t offset, uint8_t flags)
 {
-	if (len != 1 || offset != 0) {
+	const uint8_t *data = buf;
+
+	if (len < 1 || offset != 0) {
 		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
 	}
-	uint8_t cmd = *((const uint8_t *)buf);
-	if (cmd == 0x01) {
-		sync_start_idx = 0;
-		k_work_schedule(&sync_work, K_NO_WAIT);
-		LOG_INF("Sync started");
+	uint8_t cmd = data[0];
+
+	/* 0x03 <tier> and 0x05/0x06 <seq_le32> carry an argument; the rest
+	 * are single bytes
+	 */
+	uint16_t want = cmd == 0x03 ? 2 : cmd == 0x05 || cmd == 0x06 ? 5 : 1;
+
+	if (len != want) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	}
+	if (cmd == 0x01 || cmd == 0x04 || cmd == 0x05) {
+		uint16_t mtu = bt_gatt_get_mtu(conn);
+		uint32_t from = cmd == 0x05 ? sys_get_le32(&data[1]) : 0;
+
+		if (sync_start(cmd != 0x01, mtu, cmd == 0x05, from)) {
+			return BT_GATT_ERR(BT_ATT_ERR_PROCEDURE_IN_PROGRESS);
+		}
+		LOG_INF("Sync started (%s, MTU %u)",
+			cmd == 0x01 ? "records" : "framed", mtu);
+	} else if (cmd == 0x06) {
+		uint32_t seq = sys_get_le32(&data[1]);
+
+		/* Acknowledged samples are the only ones dropped */
+		if (history_ack(seq)) {
+			return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+		}
+		LOG_DBG("Acknowledged to %u", seq);
 	} else if (cmd == 0x02) {
-		data_cache_clear();
-		LOG_INF("Cache cleared");
+		sync_request(&(struct sync_req){ .release = true });
+	} else if (cmd == 0x03) {
+		if (data[1] >= ROLLUP_TIER_COUNT) {
+			return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+		}
+		/* A rollup sync may restart itself, not cut into a sync */
+		if (!atomic_cas(&sync_owner, SYNC_OWNER_NONE,
+				SYNC_OWNER_ROLLUP) &&
+		    atomic_get(&sync_owner) != SYNC_OWNER_ROLLUP) {
+			return BT_GATT_ERR(BT_ATT_ERR_PROCEDURE_IN_PROGRESS);
+		}
+		atomic_set(&rollup_req, data[1] + 1);
+		k_work_reschedule_for_queue(&ble_tx_wq, &rollup_work,
+					    K_NO_WAIT);
+		LOG_INF("Rollup sync started (tier %u)", data[1]);
+	} else if (cmd == 0x07) {
+		level_stats_reset();
+		LOG_INF("Level stats reset");
 	}
 	return len;
 }
@@ -241,31 +858,189 @@ BT_GATT_SERVICE_DEFINE(iv_svc,
 			       NULL, NULL, NULL),
 	BT_GATT_CCC(sync_data_ccc_changed,
 		     BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+
+	/* Weighting (R/W) */
+	BT_GATT_CHARACTERISTIC(&iv_weighting_uuid.uuid,
+			       BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+			       BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+			       weighting_read, weighting_write, NULL),
+
+	/* Spectrum (R/Notify) */
+	BT_GATT_CHARACTERISTIC(&iv_spectrum_uuid.uuid,
+			       BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+			       BT_GATT_PERM_READ,
+			       spectrum_read, NULL, NULL),
+	BT_GATT_CCC(spectrum_ccc_changed,
+		     BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+
+	/* Pipeline Stats (Read) */
+	BT_GATT_CHARACTERISTIC(&iv_pipeline_stats_uuid.uuid,
+			       BT_GATT_CHRC_READ,
+			       BT_GATT_PERM_READ,
+			       pipeline_stats_read, NULL, NULL),
+
+	/* Level Stats (Read) */
+	BT_GATT_CHARACTERISTIC(&iv_level_stats_uuid.uuid,
+			       BT_GATT_CHRC_READ,
+			       BT_GATT_PERM_READ,
+			       level_stats_read, NULL, NULL),
+
+	/* Level Mode (R/W) */
+	BT_GATT_CHARACTERISTIC(&iv_level_mode_uuid.uuid,
+			       BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+			       BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+			       level_mode_read, level_mode_write, NULL),
 );
 
+#if defined(CONFIG_IV_PROFILER)
+/* --- Diagnostics: Stage Profile characteristic (Read) --- */
+
+static ssize_t profile_read(struct bt_conn *conn,
+			    const struct bt_gatt_attr *attr,
+			    void *buf, uint16_t len, uint16_t offset)
+{
+	uint8_t out[PROF_STAGE_COUNT * sizeof(struct prof_summary)];
+	uint8_t *p = out;
+
+	for (int i = 0; i < PROF_STAGE_COUNT; i++) {
+		struct prof_summary s;
+
+		profiler_get(i, &s);
+		sys_put_le32(s.count, p);
+		sys_put_le32(s.min_us, p + 4);
+		sys_put_le32(s.avg_us, p + 8);
+		sys_put_le32(s.max_us, p + 12);
+		sys_put_le32(s.p99_us, p + 16);
+		p += sizeof(struct prof_summary);
+	}
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset,
+				 out, sizeof(out));
+}
+
+/*
+ * Kept out of iv_svc so the fixed attribute indices used for
+ * notifications do not depend on whether profiling is built in.
+ */
+BT_GATT_SERVICE_DEFINE(iv_diag_svc,
+	BT_GATT_PRIMARY_SERVICE(&iv_diag_svc_uuid),
+
+	/* Stage Profile (Read) */
+	BT_GATT_CHARACTERISTIC(&iv_diag_profile_uuid.uuid,
+			       BT_GATT_CHRC_READ,
+			       BT_GATT_PERM_READ,
+			       profile_read, NULL, NULL),
+);
+#endif
+
+static void level_work_handler(struct k_work *work)
+{
+	uint8_t val[LEVEL_FEED_MAX_SIZE];
+	k_spinlock_key_t key = k_spin_lock(&level_lock);
+	uint16_t len = level_tx_len;
+
+	memcpy(val, level_tx, len);
+	k_spin_unlock(&level_lock, key);
+
+	/* Notify attribute is at index 4 (after svc + threshold char/val) */
+	bt_gatt_notify(NULL, &iv_svc.attrs[4], val, len);
+}
+
+static void bands_work_handler(struct k_work *work)
+{
+	uint8_t bands[BAND_COUNT];
+
+	bands_get(bands);
+
+	/*
+	 * Spectrum value attribute is at index 18:
+	 *   [15]weight_decl [16]weight_val [17]spec_decl [18]spec_val
+	 *   [19]spec_ccc
+	 */
+	bt_gatt_notify(NULL, &iv_svc.attrs[18], bands, sizeof(bands));
+}
+
 int config_service_init(void)
 {
 	k_work_init_delayable(&sync_work, sync_work_handler);
+	k_work_init_delayable(&rollup_work, rollup_work_handler);
+	k_work_init(&level_work, level_work_handler);
+	k_work_init(&bands_work, bands_work_handler);
 	LOG_INF("InsideVoice GATT service registered");
 	return 0;
 }
 
 void config_service_notify_level(uint8_t db)
 {
+	uint8_t val[LEVEL_FEED_MAX_SIZE];
+
 	current_level_db = db;
+	if (!level_subscribed) {
+		return;
+	}
+	if (atomic_clear(&level_feed_stale)) {
+		level_feed_set(&level_feed, level_mode, level_arg);
+	}
 
-	/* Notify attribute is at index 4 (after svc + threshold char/val) */
-	bt_gatt_notify(NULL, &iv_svc.attrs[4], &current_level_db,
-		       sizeof(current_level_db));
+	uint16_t len = level_feed_push(&level_feed, db, val);
+
+	if (len == 0) {
+		return;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&level_lock);
+
+	memcpy(level_tx, val, len);
+	level_tx_len = len;
+	k_spin_unlock(&level_lock, key);
+	k_work_submit(&level_work);
+}
+
+void config_service_notify_bands(const uint8_t *levels)
+{
+	k_spinlock_key_t key = k_spin_lock(&bands_lock);
+
+	memcpy(current_bands, levels, sizeof(current_bands));
+	k_spin_unlock(&bands_lock, key);
+	k_work_submit(&bands_work);
 }
 
 void config_service_start_sync(void)
 {
-	sync_start_idx = 0;
-	k_work_schedule(&sync_work, K_NO_WAIT);
+	if (sync_start(false, BT_ATT_DEFAULT_LE_MTU, false, 0)) {
+		LOG_WRN("Sync not started: rollup sync running");
+	}
 }
 
 void config_service_clear_cache(void)
 {
-	data_cache_clear();
+	history_clear();
 }
+
+#if defined(CONFIG_SHELL)
+static int cmd_iv_sync(const struct shell *sh, size_t argc, char **argv)
+{
+	struct sync_run r = sync_run;
+
+	if (r.notifies == 0) {
+		shell_print(sh, "No sync yet");
+		return 0;
+	}
+	shell_print(sh, "mode      %s, MTU %u", r.framed ? "framed" : "records",
+		    r.mtu);
+	shell_print(sh, "sent      %u records in %u notifications, %u bytes",
+		    r.records, r.notifies, r.bytes);
+	shell_print(sh, "next seq  %u", sync_stream_seq(&sync_stream));
+	if (sync_state != SYNC_IDLE) {
+		shell_print(sh, "running");
+	} else if (r.ms > 0) {
+		shell_print(sh, "took      %u ms, %u B/s, %u records/s", r.ms,
+			    (uint32_t)((uint64_t)r.bytes * 1000U / r.ms),
+			    (uint32_t)((uint64_t)r.records * 1000U / r.ms));
+	}
+	return 0;
+}
+
+SHELL_SUBCMD_ADD((iv), sync, NULL, "Throughput of the last BLE sync",
+		 cmd_iv_sync, 1, 0);
+#endif
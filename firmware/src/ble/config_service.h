@@ -12,10 +12,41 @@
  *   - Sound Level (R/Notify): 4f490002-...  uint8 current dB
  *   - Feedback Mode (R/W):    4f490003-...  uint8 bitmask
  *   - Sample Count (R):       4f490004-...  uint32 cached sample count
- *   - Sync Control (W):       4f490005-...  uint8 command (0x01=sync, 0x02=clear)
- *   - Sync Data (Notify):     4f490006-...  5-byte records [uptime_ms_le32, db]
+ *   - Sync Control (W):       4f490005-...  uint8 command (0x01=sync, 0x02=clear,
+ *                                            0x03 <tier>=rollup sync (0=minute,
+ *                                            1=hour), 0x04=framed sync, 0x05
+ *                                            <seq_le32>=framed sync from seq,
+ *                                            0x06 <seq_le32>=ack up to seq,
+ *                                            0x07=reset level stats); a sync
+ *                                            and a rollup sync refuse each
+ *                                            other with "procedure in
+ *                                            progress"
+ *   - Sync Data (Notify):     4f490006-...  5-byte records [uptime_ms_le32, db];
+ *                                            framed: [version, flags, count,
+ *                                            first_seq_le32] + count records;
+ *                                            rollup: 13-byte header, then
+ *                                            4-byte [min, avg, max, over]
+ *   - Weighting (R/W):        4f490007-...  uint8 curve (0=Z, 1=A, 2=C)
+ *   - Spectrum (R/Notify):    4f490008-...  8 x uint8 octave-band dB
+ *                                            (63 Hz .. 8 kHz)
+ *   - Pipeline Stats (R):     4f490009-...  7 x uint32 LE: blocks, dropped,
+ *                                            queue hwm, queue latency
+ *                                            avg/max us, analysis avg/max us
+ *   - Level Stats (R):        4f49000a-...  22 bytes LE session statistics
+ *   - Level Mode (R/W):       4f49000b-...  [mode, arg]: 0=every level,
+ *                                            1=arg levels per notify as
+ *                                            [seq_le16, levels], 2=on a
+ *                                            change of arg dB
+ *
+ * Diagnostics service (CONFIG_IV_PROFILER only):
+ *   Base: 4f490100-2ff1-4a5e-a683-4de2c5a10100
+ *   - Stage Profile (R):      4f490101-...  per stage, in enum prof_stage
+ *                                            order, 5 x uint32 LE: count,
+ *                                            min, avg, max, p99 us
  */
 
+#if defined(CONFIG_BT)
+
 /**
  * Register the InsideVoice config GATT service.
  * Must be called after bt_enable().
@@ -25,17 +56,37 @@
 int config_service_init(void);
 
 /**
- * Update the sound level characteristic and send a BLE notification
- * if a client is subscribed.
+ * Update the sound level characteristic and, if a client is subscribed,
+ * feed the level to the live stream in the mode set on Level Mode,
+ * queueing a notification when one is due. Does nothing else without a
+ * subscription. Does not block on the BLE stack.
  *
  * @param db  Current sound level in dB.
  */
 void config_service_notify_level(uint8_t db);
 
+/**
+ * Update the spectrum characteristic and notify subscribed clients.
+ *
+ * @param levels  BAND_COUNT octave-band levels in dB.
+ */
+void config_service_notify_bands(const uint8_t *levels);
+
 /* Sync: start streaming cached samples to connected BLE client */
 void config_service_start_sync(void);
 
 /* Sync: clear the sample cache (called after client acks) */
 void config_service_clear_cache(void);
 
+#else
+
+/* Builds without Bluetooth (native_sim) run the pipeline unobserved */
+static inline int config_service_init(void) { return 0; }
+static inline void config_service_notify_level(uint8_t db) {}
+static inline void config_service_notify_bands(const uint8_t *levels) {}
+static inline void config_service_start_sync(void) {}
+static inline void config_service_clear_cache(void) {}
+
+#endif /* CONFIG_BT */
+
 #endif /* BLE_CONFIG_SERVICE_H */
@@ -0,0 +1,187 @@
+#include "conn_policy.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+#endif
+
+LOG_MODULE_REGISTER(conn_policy, LOG_LEVEL_INF);
+
+BUILD_ASSERT(CONFIG_IV_CONN_ACTIVE_INT_MIN <= CONFIG_IV_CONN_ACTIVE_INT_MAX,
+	     "Active interval range is empty");
+BUILD_ASSERT(CONFIG_IV_CONN_IDLE_INT_MIN <= CONFIG_IV_CONN_IDLE_INT_MAX,
+	     "Idle interval range is empty");
+
+enum conn_profile {
+	PROFILE_CENTRAL,  /* Nothing requested: the central's choice */
+	PROFILE_ACTIVE,
+	PROFILE_IDLE,
+};
+
+static const char *const profile_names[] = {
+	[PROFILE_CENTRAL] = "central's",
+	[PROFILE_ACTIVE] = "active",
+	[PROFILE_IDLE] = "idle",
+};
+
+static const struct bt_le_conn_param profiles[] = {
+	[PROFILE_ACTIVE] = BT_LE_CONN_PARAM_INIT(CONFIG_IV_CONN_ACTIVE_INT_MIN,
+						 CONFIG_IV_CONN_ACTIVE_INT_MAX,
+						 0,
+						 CONFIG_IV_CONN_ACTIVE_TIMEOUT),
+	[PROFILE_IDLE] = BT_LE_CONN_PARAM_INIT(CONFIG_IV_CONN_IDLE_INT_MIN,
+					       CONFIG_IV_CONN_IDLE_INT_MAX,
+					       CONFIG_IV_CONN_IDLE_LATENCY,
+					       CONFIG_IV_CONN_IDLE_TIMEOUT),
+};
+
+static const char *const demand_names[CONN_DEMAND_COUNT] = {
+	[CONN_DEMAND_LEVEL] = "level",
+	[CONN_DEMAND_SPECTRUM] = "spectrum",
+	[CONN_DEMAND_SYNC] = "sync",
+	[CONN_DEMAND_ROLLUP] = "rollup",
+	[CONN_DEMAND_L2CAP] = "l2cap",
+};
+
+/*
+ * demand is a bit per enum conn_demand, set from any thread. The
+ * connection and the profile are only touched by the connection
+ * callbacks and policy_work, which run on the cooperative BT RX thread
+ * and system workqueue and so cannot preempt each other.
+ */
+static atomic_t demand;
+static struct bt_conn *policy_conn;
+static enum conn_profile requested;
+
+static void policy_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(policy_work, policy_work_handler);
+
+/* Interval in 1.25 ms units as "ms.xx" */
+#define INTERVAL_FMT      "%u.%02u ms"
+#define INTERVAL_ARGS(n)  ((n) * 125U / 100U), ((n) * 125U % 100U)
+
+static void policy_work_handler(struct k_work *work)
+{
+	enum conn_profile want = atomic_get(&demand) ? PROFILE_ACTIVE :
+						       PROFILE_IDLE;
+	const struct bt_le_conn_param *p = &profiles[want];
+
+	if (!policy_conn || want == requested) {
+		return;
+	}
+
+	int err = bt_conn_le_param_update(policy_conn, p);
+
+	if (err) {
+		LOG_WRN("Requesting %s parameters failed: %d",
+			profile_names[want], err);
+		return;
+	}
+
+	requested = want;
+	LOG_INF("Requested %s parameters: " INTERVAL_FMT " - " INTERVAL_FMT
+		", latency %u, timeout %u ms", profile_names[want],
+		INTERVAL_ARGS(p->interval_min), INTERVAL_ARGS(p->interval_max),
+		p->latency, p->timeout * 10U);
+}
+
+void conn_policy_demand(enum conn_demand d, bool on)
+{
+	if (on) {
+		atomic_set_bit(&demand, d);
+	} else {
+		atomic_clear_bit(&demand, d);
+	}
+
+	/* Speed up at once; slow down only after a quiet spell, so
+	 * back-to-back syncs and resubscriptions keep the fast link
+	 */
+	k_work_reschedule(&policy_work, atomic_get(&demand) ? K_NO_WAIT :
+			  K_MSEC(CONFIG_IV_CONN_IDLE_DELAY_MS));
+}
+
+static void log_params(const char *what, uint16_t interval,
+		       uint16_t latency, uint16_t timeout)
+{
+	LOG_INF("%s: interval " INTERVAL_FMT ", latency %u, timeout %u ms",
+		what, INTERVAL_ARGS(interval), latency, timeout * 10U);
+}
+
+static void connected_cb(struct bt_conn *conn, uint8_t err)
+{
+	struct bt_conn_info info;
+
+	if (err || policy_conn) {
+		return;
+	}
+
+	policy_conn = bt_conn_ref(conn);
+	requested = PROFILE_CENTRAL;
+	if (!bt_conn_get_info(conn, &info)) {
+		log_params("Connection parameters", info.le.interval,
+			   info.le.latency, info.le.timeout);
+	}
+
+	/* Leave the central's parameters while it discovers and
+	 * subscribes; a demand before then cuts this short
+	 */
+	k_work_reschedule(&policy_work, K_MSEC(CONFIG_IV_CONN_IDLE_DELAY_MS));
+}
+
+static void disconnected_cb(struct bt_conn *conn, uint8_t reason)
+{
+	if (conn != policy_conn) {
+		return;
+	}
+
+	k_work_cancel_delayable(&policy_work);
+	bt_conn_unref(policy_conn);
+	policy_conn = NULL;
+}
+
+static void le_param_updated_cb(struct bt_conn *conn, uint16_t interval,
+				uint16_t latency, uint16_t timeout)
+{
+	log_params("Connection parameters updated", interval, latency,
+		   timeout);
+}
+
+BT_CONN_CB_DEFINE(policy_callbacks) = {
+	.connected = connected_cb,
+	.disconnected = disconnected_cb,
+	.le_param_updated = le_param_updated_cb,
+};
+
+#if defined(CONFIG_SHELL)
+static int cmd_iv_conn(const struct shell *sh, size_t argc, char **argv)
+{
+	struct bt_conn *conn = policy_conn;
+	struct bt_conn_info info;
+	atomic_val_t d = atomic_get(&demand);
+
+	if (!conn || bt_conn_get_info(conn, &info)) {
+		shell_print(sh, "Not connected");
+		return 0;
+	}
+
+	shell_print(sh, "interval  " INTERVAL_FMT ", latency %u, timeout %u ms",
+		    INTERVAL_ARGS(info.le.interval), info.le.latency,
+		    info.le.timeout * 10U);
+	shell_print(sh, "requested %s", profile_names[requested]);
+	shell_fprintf(sh, SHELL_NORMAL, "demand   ");
+	for (int i = 0; i < CONN_DEMAND_COUNT; i++) {
+		if (d & BIT(i)) {
+			shell_fprintf(sh, SHELL_NORMAL, " %s", demand_names[i]);
+		}
+	}
+	shell_print(sh, "%s", d ? "" : " none");
+	return 0;
+}
+
+SHELL_SUBCMD_ADD((iv), conn, NULL, "Connection parameters and policy",
+		 cmd_iv_conn, 1, 0);
+#endif
@@ -0,0 +1,40 @@
+#ifndef BLE_CONN_POLICY_H
+#define BLE_CONN_POLICY_H
+
+#include <stdbool.h>
+
+/**
+ * Connection-parameter policy.
+ *
+ * While any demand below is on, the active parameters are requested
+ * (short interval, no latency). Once all demand has been off for
+ * CONFIG_IV_CONN_IDLE_DELAY_MS, the idle ones are (long interval,
+ * peripheral latency). A new link keeps the central's parameters for
+ * the same delay unless a demand comes first. Each request and
+ * each set of parameters the central settles on is logged; `iv conn`
+ * shows the current ones.
+ */
+enum conn_demand {
+	CONN_DEMAND_LEVEL,     /* Sound Level notifications subscribed */
+	CONN_DEMAND_SPECTRUM,  /* Spectrum notifications subscribed */
+	CONN_DEMAND_SYNC,      /* GATT history sync running */
+	CONN_DEMAND_ROLLUP,    /* Rollup sync running */
+	CONN_DEMAND_L2CAP,     /* L2CAP sync running */
+	CONN_DEMAND_COUNT,
+};
+
+#if defined(CONFIG_IV_CONN_POLICY)
+
+/**
+ * Turn a demand for a fast link on or off. Safe from any thread; the
+ * request is made from the system workqueue.
+ */
+void conn_policy_demand(enum conn_demand d, bool on);
+
+#else
+
+static inline void conn_policy_demand(enum conn_demand d, bool on) {}
+
+#endif /* CONFIG_IV_CONN_POLICY */
+
+#endif /* BLE_CONN_POLICY_H */
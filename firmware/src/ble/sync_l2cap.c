@@ -0,0 +1,215 @@
+#include "sync_l2cap.h"
+#include "ble_tx.h"
+#include "conn_policy.h"
+#include "../app/history.h"
+#include "../app/sync_stream.h"
+
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/l2cap.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/buf.h>
+#include <zephyr/sys/byteorder.h>
+
+LOG_MODULE_REGISTER(sync_l2cap, LOG_LEVEL_INF);
+
+#define REQ_SIZE 5  /* [op, seq_le32] */
+#define OP_SYNC  0x05
+#define OP_ACK   0x06
+
+static void sdu_destroy(struct net_buf *buf);
+
+/*
+ * Each SDU is one frame. When every buffer is queued in the stack the
+ * work stops; the stack frees a buffer once its SDU has been sent on
+ * the peer's credits, which resumes the work.
+ *
+ * The work runs on ble_tx_wq and owns the stream; a request from the BT
+ * RX thread, which can preempt it, is posted under req_lock.
+ */
+NET_BUF_POOL_DEFINE(sdu_pool, CONFIG_IV_SYNC_L2CAP_TX_SDUS,
+		    BT_L2CAP_SDU_BUF_SIZE(CONFIG_IV_SYNC_L2CAP_SDU_SIZE),
+		    CONFIG_BT_CONN_TX_USER_DATA_SIZE, sdu_destroy);
+
+/* One channel: CONFIG_BT_MAX_CONN is 1 */
+static struct bt_l2cap_le_chan chan;
+static bool chan_open;
+
+static struct k_work stream_work;
+static struct sync_stream stream;
+static bool streaming;
+
+static struct k_spinlock req_lock;
+static bool req_sync;
+static uint32_t req_seq;
+
+static int64_t t0;
+static uint32_t sent_records;
+static uint32_t sent_bytes;
+
+static void sdu_destroy(struct net_buf *buf)
+{
+	net_buf_destroy(buf);
+	k_work_submit_to_queue(&ble_tx_wq, &stream_work);
+}
+
+static void stream_work_handler(struct k_work *work)
+{
+	k_spinlock_key_t key = k_spin_lock(&req_lock);
+	bool start = req_sync;
+	uint32_t from_seq = req_seq;
+
+	req_sync = false;
+	k_spin_unlock(&req_lock, key);
+
+	if (start) {
+		sync_stream_open(&stream);
+		if (!sync_stream_seek(&stream, from_seq)) {
+			LOG_INF("Sync from %u not held, from oldest %u",
+				from_seq, sync_stream_seq(&stream));
+		}
+		streaming = true;
+		conn_policy_demand(CONN_DEMAND_L2CAP, true);
+		t0 = k_uptime_get();
+		sent_records = 0;
+		sent_bytes = 0;
+	}
+
+	if (!streaming || !chan_open) {
+		streaming = false;
+		conn_policy_demand(CONN_DEMAND_L2CAP, false);
+		return;
+	}
+
+	uint32_t size = MIN(chan.tx.mtu, CONFIG_IV_SYNC_L2CAP_SDU_SIZE);
+
+	for (;;) {
+		struct net_buf *buf = net_buf_alloc(&sdu_pool, K_NO_WAIT);
+
+		if (!buf) {
+			/* All queued — sdu_destroy() resumes */
+			return;
+		}
+		net_buf_reserve(buf, BT_L2CAP_SDU_CHAN_SEND_RESERVE);
+
+		uint16_t len;
+		uint32_t count = sync_stream_frame(&stream, net_buf_tail(buf),
+						   size, &len);
+
+		net_buf_add(buf, len);
+
+		int err = bt_l2cap_chan_send(&chan.chan, buf);
+
+		if (err < 0) {
+			net_buf_unref(buf);
+			LOG_WRN("Sync aborted: %d", err);
+			streaming = false;
+			conn_policy_demand(CONN_DEMAND_L2CAP, false);
+			return;
+		}
+
+		sync_stream_commit(&stream);
+		sent_records += count;
+		sent_bytes += len;
+		if (count == 0) {
+			uint32_t ms = (uint32_t)(k_uptime_get() - t0);
+
+			LOG_INF("Sync done: %u records, %u ms, %u B/s",
+				sent_records, ms, ms ? (uint32_t)((uint64_t)
+				sent_bytes * 1000U / ms) : 0);
+			streaming = false;
+			conn_policy_demand(CONN_DEMAND_L2CAP, false);
+			return;
+		}
+	}
+}
+
+static int chan_recv(struct bt_l2cap_chan *c, struct net_buf *buf)
+{
+	if (buf->len != REQ_SIZE) {
+		LOG_WRN("Bad request length %u", buf->len);
+		return 0;
+	}
+
+	uint8_t op = buf->data[0];
+	uint32_t seq = sys_get_le32(&buf->data[1]);
+
+	if (op == OP_SYNC) {
+		k_spinlock_key_t key = k_spin_lock(&req_lock);
+
+		req_sync = true;
+		req_seq = seq;
+		k_spin_unlock(&req_lock, key);
+		k_work_submit_to_queue(&ble_tx_wq, &stream_work);
+		LOG_INF("Sync started (SDU %u)",
+			MIN(chan.tx.mtu, CONFIG_IV_SYNC_L2CAP_SDU_SIZE));
+	} else if (op == OP_ACK) {
+		/* Acknowledged samples are the only ones dropped */
+		if (history_ack(seq)) {
+			LOG_WRN("Ack %u past the newest sample", seq);
+		}
+	} else {
+		LOG_WRN("Unknown request 0x%02x", op);
+	}
+	return 0;
+}
+
+static void chan_connected(struct bt_l2cap_chan *c)
+{
+	LOG_INF("Channel open: tx MTU %u, MPS %u", chan.tx.mtu, chan.tx.mps);
+}
+
+static void chan_disconnected(struct bt_l2cap_chan *c)
+{
+	k_spinlock_key_t key = k_spin_lock(&req_lock);
+
+	/* The work sees the channel gone and stops */
+	req_sync = false;
+	chan_open = false;
+	k_spin_unlock(&req_lock, key);
+	LOG_INF("Channel closed");
+}
+
+static const struct bt_l2cap_chan_ops chan_ops = {
+	.connected = chan_connected,
+	.disconnected = chan_disconnected,
+	.recv = chan_recv,
+};
+
+static int server_accept(struct bt_conn *conn, struct bt_l2cap_server *server,
+			 struct bt_l2cap_chan **out)
+{
+	if (chan_open) {
+		return -ENOMEM;
+	}
+
+	chan = (struct bt_l2cap_le_chan){
+		.chan.ops = &chan_ops,
+	};
+	chan_open = true;
+	*out = &chan.chan;
+	return 0;
+}
+
+static struct bt_l2cap_server server = {
+	.psm = CONFIG_IV_SYNC_L2CAP_PSM,
+	.sec_level = BT_SECURITY_L1,
+	.accept = server_accept,
+};
+
+int sync_l2cap_init(void)
+{
+	k_work_init(&stream_work, stream_work_handler);
+
+	int err = bt_l2cap_server_register(&server);
+
+	if (err) {
+		LOG_ERR("L2CAP server register failed: %d", err);
+		return err;
+	}
+
+	LOG_INF("L2CAP sync on PSM 0x%04x", server.psm);
+	return 0;
+}
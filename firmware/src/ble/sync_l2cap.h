@@ -0,0 +1,33 @@
+#ifndef BLE_SYNC_L2CAP_H
+#define BLE_SYNC_L2CAP_H
+
+/**
+ * Bulk history sync over an LE credit-based L2CAP channel.
+ *
+ * The app connects a channel to CONFIG_IV_SYNC_L2CAP_PSM and sends
+ * 5-byte requests [op, seq_le32]:
+ *   - 0x05: stream from seq (the oldest unsynced sample if not held)
+ *   - 0x06: acknowledge every sample before seq
+ *
+ * The device answers a 0x05 with sync_stream frames, one per SDU, up to
+ * CONFIG_IV_SYNC_L2CAP_SDU_SIZE and the channel MTU, ending with the
+ * empty end frame. The peer's credits pace the stream. Frames and
+ * sequence numbers are the same as for the framed GATT sync.
+ */
+
+#if defined(CONFIG_IV_SYNC_L2CAP)
+
+/**
+ * Register the L2CAP server. Must be called after bt_enable().
+ *
+ * @return 0 on success, negative errno on failure.
+ */
+int sync_l2cap_init(void);
+
+#else
+
+static inline int sync_l2cap_init(void) { return 0; }
+
+#endif /* CONFIG_IV_SYNC_L2CAP */
+
+#endif /* BLE_SYNC_L2CAP_H */
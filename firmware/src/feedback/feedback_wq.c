@@ -0,0 +1,16 @@
+#include "feedback_wq.h"
+
+#define FEEDBACK_STACK_SIZE 1024
+#define FEEDBACK_PRIORITY   2  /* Above the capture and monitor threads */
+
+/* Pattern steps are a GPIO or PWM write each; they never block */
+K_THREAD_STACK_DEFINE(feedback_stack, FEEDBACK_STACK_SIZE);
+struct k_work_q feedback_wq;
+
+void feedback_wq_init(void)
+{
+	k_work_queue_start(&feedback_wq, feedback_stack,
+			   K_THREAD_STACK_SIZEOF(feedback_stack),
+			   FEEDBACK_PRIORITY, NULL);
+	k_thread_name_set(&feedback_wq.thread, "feedback");
+}
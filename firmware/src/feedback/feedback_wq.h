@@ -0,0 +1,19 @@
+#ifndef FEEDBACK_FEEDBACK_WQ_H
+#define FEEDBACK_FEEDBACK_WQ_H
+
+#include <zephyr/kernel.h>
+
+/**
+ * Workqueue for the LED and vibration pattern steps. It runs above the
+ * capture and monitor threads and holds nothing else, so a step starts
+ * on time whatever the system workqueue and the BLE syncs are doing.
+ */
+extern struct k_work_q feedback_wq;
+
+/**
+ * Start the feedback workqueue. Must be called before the first LED
+ * pattern or vibration is played.
+ */
+void feedback_wq_init(void);
+
+#endif /* FEEDBACK_FEEDBACK_WQ_H */
@@ -1,4 +1,6 @@
 #include "led.h"
+#include "feedback_wq.h"
+#include "../app/profiler.h"
 
 #include <zephyr/kernel.h>
 #include <zephyr/drivers/gpio.h>
@@ -30,21 +32,28 @@ static void leds_all_off(void)
 	gpio_pin_set_dt(&led_blue, 0);
 }
 
+static void pattern_schedule(k_timeout_t delay)
+{
+	k_work_reschedule_for_queue(&feedback_wq, &pattern_work, delay);
+}
+
 static void pattern_handler(struct k_work *work)
 {
 	enum led_pattern pat = active_pattern;
 	int step = pattern_step;
 
+	PROF_START(t);
+
 	switch (pat) {
 	case LED_PATTERN_OFF:
 		leds_all_off();
-		return;
+		break;
 
 	case LED_PATTERN_PULSE_WARM:
 		/* Simple on/off pulsing of red LED at ~2 Hz */
 		gpio_pin_set_dt(&led_red, step % 2);
 		pattern_step = step + 1;
-		k_work_reschedule(&pattern_work, K_MSEC(250));
+		pattern_schedule(K_MSEC(250));
 		break;
 
 	case LED_PATTERN_BREATHE_GREEN:
@@ -52,11 +61,11 @@ static void pattern_handler(struct k_work *work)
 		if (step % 2 == 0) {
 			gpio_pin_set_dt(&led_green, 1);
 			pattern_step = step + 1;
-			k_work_reschedule(&pattern_work, K_MSEC(700));
+			pattern_schedule(K_MSEC(700));
 		} else {
 			gpio_pin_set_dt(&led_green, 0);
 			pattern_step = step + 1;
-			k_work_reschedule(&pattern_work, K_MSEC(300));
+			pattern_schedule(K_MSEC(300));
 		}
 		break;
 
@@ -65,16 +74,18 @@ static void pattern_handler(struct k_work *work)
 		if (step < 6) {
 			gpio_pin_set_dt(&led_blue, step % 2);
 			pattern_step = step + 1;
-			k_work_reschedule(&pattern_work, K_MSEC(100));
+			pattern_schedule(K_MSEC(100));
 		} else {
 			gpio_pin_set_dt(&led_blue, 0);
 			/* Return to idle breathe after BLE flash */
 			active_pattern = LED_PATTERN_BREATHE_GREEN;
 			pattern_step = 0;
-			k_work_reschedule(&pattern_work, K_MSEC(200));
+			pattern_schedule(K_MSEC(200));
 		}
 		break;
 	}
+
+	PROF_END(PROF_STAGE_PATTERN, t);
 }
 
 /* --- public API --- */
@@ -113,5 +124,5 @@ void led_set_pattern(enum led_pattern pattern)
 	pattern_step = 0;
 
 	/* Submit immediately */
-	k_work_reschedule(&pattern_work, K_NO_WAIT);
+	pattern_schedule(K_NO_WAIT);
 }
@@ -20,7 +20,7 @@ int led_init(void);
 
 /**
  * Set the active LED pattern. Cancels any running pattern and starts the
- * new one asynchronously via a system work queue item.
+ * new one asynchronously on the feedback workqueue.
  *
  * @param pattern  The pattern to display.
  */
@@ -1,8 +1,14 @@
 #include "vibration.h"
+#include "feedback_wq.h"
+#include "../app/profiler.h"
 
+#include <stdlib.h>
 #include <zephyr/kernel.h>
 #include <zephyr/drivers/pwm.h>
 #include <zephyr/logging/log.h>
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+#endif
 
 LOG_MODULE_REGISTER(vibration, LOG_LEVEL_INF);
 
@@ -10,8 +16,30 @@ static const struct pwm_dt_spec vib_pwm =
 	PWM_DT_SPEC_GET(DT_NODELABEL(vib0));
 
 static struct k_work_delayable vib_work;
-static volatile enum vib_pattern active_vib;
-static volatile int vib_step;
+
+/* The step the pending work will run and the tick it is due at. Steps
+ * are scheduled from the feedback queue and from vibration_play()'s
+ * caller, so the state is only touched under vib_lock.
+ */
+struct vib_state {
+	enum vib_pattern pat;
+	uint32_t run;  /* Bumped by every play and stop */
+	int step;
+	int64_t due;
+};
+
+static struct k_spinlock vib_lock;
+static struct vib_state vib;
+
+/* Step timing: how late each step ran against the tick it was due at */
+struct vib_jitter {
+	uint32_t steps;
+	uint32_t late;     /* Steps more than one tick late */
+	uint32_t max_us;
+	uint64_t sum_us;
+};
+
+static struct vib_jitter vib_jitter;
 
 /* PWM period: 20 ms (50 Hz — good for coin motors) */
 #define VIB_PERIOD_NS  PWM_MSEC(20)
@@ -23,22 +51,52 @@ static void vib_set_intensity(uint8_t pct)
 	pwm_set_dt(&vib_pwm, VIB_PERIOD_NS, pulse);
 }
 
+/* Run step in ms, unless the pattern was played again or stopped since */
+static void vib_schedule(uint32_t run, int step, uint32_t ms)
+{
+	k_spinlock_key_t key = k_spin_lock(&vib_lock);
+
+	if (vib.run == run) {
+		vib.step = step;
+		vib.due = k_uptime_ticks() + k_ms_to_ticks_ceil64(ms);
+		k_work_reschedule_for_queue(&feedback_wq, &vib_work,
+					    K_MSEC(ms));
+	}
+	k_spin_unlock(&vib_lock, key);
+}
+
 static void vib_handler(struct k_work *work)
 {
-	enum vib_pattern pat = active_vib;
-	int step = vib_step;
+	k_spinlock_key_t key = k_spin_lock(&vib_lock);
+	struct vib_state cur = vib;
+
+	k_spin_unlock(&vib_lock, key);
+
+	enum vib_pattern pat = cur.pat;
+	int step = cur.step;
+	int64_t late = k_uptime_ticks() - cur.due;
+
+	PROF_START(t);
+
+	if (late >= 0) {
+		uint32_t us = (uint32_t)k_ticks_to_us_floor64(late);
+
+		vib_jitter.steps++;
+		vib_jitter.late += late > 1;
+		vib_jitter.max_us = MAX(vib_jitter.max_us, us);
+		vib_jitter.sum_us += us;
+	}
 
 	switch (pat) {
 	case VIB_PATTERN_OFF:
 		vib_set_intensity(0);
-		return;
+		break;
 
 	case VIB_PATTERN_GENTLE_TAP:
 		/* 60% for 80ms then off */
 		if (step == 0) {
 			vib_set_intensity(60);
-			vib_step = 1;
-			k_work_reschedule(&vib_work, K_MSEC(80));
+			vib_schedule(cur.run, 1, 80);
 		} else {
 			vib_set_intensity(0);
 		}
@@ -49,18 +107,15 @@ static void vib_handler(struct k_work *work)
 		switch (step) {
 		case 0:
 			vib_set_intensity(60);
-			vib_step = 1;
-			k_work_reschedule(&vib_work, K_MSEC(60));
+			vib_schedule(cur.run, 1, 60);
 			break;
 		case 1:
 			vib_set_intensity(0);
-			vib_step = 2;
-			k_work_reschedule(&vib_work, K_MSEC(80));
+			vib_schedule(cur.run, 2, 80);
 			break;
 		case 2:
 			vib_set_intensity(60);
-			vib_step = 3;
-			k_work_reschedule(&vib_work, K_MSEC(60));
+			vib_schedule(cur.run, 3, 60);
 			break;
 		default:
 			vib_set_intensity(0);
@@ -72,17 +127,17 @@ static void vib_handler(struct k_work *work)
 		/* Ramp up 0→50% over 5 steps, then back down */
 		if (step <= 4) {
 			vib_set_intensity((step + 1) * 10);
-			vib_step = step + 1;
-			k_work_reschedule(&vib_work, K_MSEC(60));
+			vib_schedule(cur.run, step + 1, 60);
 		} else if (step <= 8) {
 			vib_set_intensity((9 - step) * 10);
-			vib_step = step + 1;
-			k_work_reschedule(&vib_work, K_MSEC(60));
+			vib_schedule(cur.run, step + 1, 60);
 		} else {
 			vib_set_intensity(0);
 		}
 		break;
 	}
+
+	PROF_END(PROF_STAGE_VIB, t);
 }
 
 int vibration_init(void)
@@ -103,18 +158,62 @@ int vibration_init(void)
 
 void vibration_play(enum vib_pattern pattern)
 {
+	k_spinlock_key_t key;
+	uint32_t run;
+
 	k_work_cancel_delayable(&vib_work);
 	vib_set_intensity(0);
 
-	active_vib = pattern;
-	vib_step = 0;
+	key = k_spin_lock(&vib_lock);
+	vib.pat = pattern;
+	run = ++vib.run;
+	k_spin_unlock(&vib_lock, key);
 
-	k_work_reschedule(&vib_work, K_NO_WAIT);
+	vib_schedule(run, 0, 0);
 }
 
 void vibration_stop(void)
 {
+	k_spinlock_key_t key;
+
 	k_work_cancel_delayable(&vib_work);
-	active_vib = VIB_PATTERN_OFF;
+
+	key = k_spin_lock(&vib_lock);
+	vib.pat = VIB_PATTERN_OFF;
+	vib.run++;
+	k_spin_unlock(&vib_lock, key);
+
 	vib_set_intensity(0);
 }
+
+#if defined(CONFIG_SHELL)
+/* Plays soft pulses back to back so their 60 ms steps can be timed while
+ * something else runs, e.g. a full BLE sync
+ */
+static int cmd_iv_vib_jitter(const struct shell *sh, size_t argc,
+			     char **argv)
+{
+	uint32_t secs = argc == 2 ? strtoul(argv[1], NULL, 10) : 10;
+	int64_t end = k_uptime_get() + secs * 1000LL;
+
+	vib_jitter = (struct vib_jitter){ 0 };
+	while (k_uptime_get() < end) {
+		vibration_play(VIB_PATTERN_SOFT_PULSE);
+		/* The pulse's last step is 540 ms in */
+		k_msleep(600);
+	}
+	vibration_stop();
+
+	struct vib_jitter j = vib_jitter;
+
+	shell_print(sh, "steps     %u, %u late by more than a tick", j.steps,
+		    j.late);
+	shell_print(sh, "lateness  avg %u us, max %u us",
+		    j.steps ? (uint32_t)(j.sum_us / j.steps) : 0, j.max_us);
+	return 0;
+}
+
+SHELL_SUBCMD_ADD((iv), vib, NULL,
+		 "Time vibration steps: vib [seconds]", cmd_iv_vib_jitter,
+		 1, 1);
+#endif
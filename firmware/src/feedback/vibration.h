@@ -19,7 +19,8 @@ enum vib_pattern {
 int vibration_init(void);
 
 /**
- * Play a vibration pattern. Cancels any in-progress pattern.
+ * Play a vibration pattern. Cancels any in-progress pattern. The steps
+ * run on the feedback workqueue.
  *
  * @param pattern  The pattern to play.
  */
@@ -1,16 +1,30 @@
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+#endif
 
 #include "app/config.h"
+#include "app/history.h"
 #include "app/monitor.h"
+#include "app/profiler.h"
 #include "audio/pdm_capture.h"
 #include "ble/ble_manager.h"
+#include "ble/ble_tx.h"
 #include "ble/config_service.h"
+#include "ble/sync_l2cap.h"
+#include "feedback/feedback_wq.h"
 #include "feedback/led.h"
 #include "feedback/vibration.h"
 
 LOG_MODULE_REGISTER(main, LOG_LEVEL_INF);
 
+#if defined(CONFIG_SHELL)
+/* Root for "iv ..." diagnostics commands; modules add subcommands */
+SHELL_SUBCMD_SET_CREATE(iv_cmds, (iv));
+SHELL_CMD_REGISTER(iv, &iv_cmds, "InsideVoice diagnostics", NULL);
+#endif
+
 int main(void)
 {
 	int err;
@@ -24,6 +38,15 @@ int main(void)
 		return err;
 	}
 
+	/* Recover the flash history (needs the synced mark from settings) */
+	err = history_init();
+	if (err) {
+		LOG_WRN("Flash history unavailable, RAM only: %d", err);
+	}
+
+	/* Cycle counter first so every stage is timed from boot */
+	profiler_init();
+
 	/* Initialize audio subsystem */
 	err = pdm_capture_init();
 	if (err) {
@@ -31,7 +54,9 @@ int main(void)
 		return err;
 	}
 
-	/* Initialize feedback */
+	/* Initialize feedback, on its own high-priority workqueue */
+	feedback_wq_init();
+
 	err = led_init();
 	if (err) {
 		LOG_ERR("LED init failed: %d", err);
@@ -44,6 +69,11 @@ int main(void)
 		return err;
 	}
 
+	/* Syncs run on a low-priority queue, below feedback and audio;
+	 * start it before a central can connect and request one
+	 */
+	ble_tx_init();
+
 	/* Initialize BLE */
 	err = ble_manager_init();
 	if (err) {
@@ -57,6 +87,12 @@ int main(void)
 		return err;
 	}
 
+	/* Bulk sync is optional; the GATT sync covers for it */
+	err = sync_l2cap_init();
+	if (err) {
+		LOG_WRN("L2CAP sync unavailable: %d", err);
+	}
+
 	/* Start idle LED pattern */
 	led_set_pattern(LED_PATTERN_BREATHE_GREEN);
 
@@ -0,0 +1,301 @@
+/*
+ * File-fed DMIC emulator for native_sim.
+ *
+ * Implements the DMIC driver API on top of a k_timer: every block period
+ * a work item takes a block from the caller's slab, fills it from the
+ * file given with --dmic-file (silence once it ends) and queues it for
+ * dmic_read(), so pdm_capture and everything after it run unchanged.
+ *
+ * The emulator also marks loudness onsets for sim_report: the first
+ * 10 ms window at or above the configured threshold, re-armed after a
+ * second below it. Onsets use the unweighted level.
+ */
+
+#define DT_DRV_COMPAT iv_dmic_file
+
+#include "dmic_file_bottom.h"
+#include "sim_report.h"
+#include "../app/config.h"
+#include "../audio/pdm_capture.h"
+#include "../audio/sound_level.h"
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/audio/dmic.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/logging/log_ctrl.h>
+
+#include <cmdline.h>
+#include <posix_native_task.h>
+#include <posix_board_if.h>
+
+LOG_MODULE_REGISTER(dmic_file, LOG_LEVEL_INF);
+
+#define DMIC_FILE_QUEUE_LEN 8
+
+#define ONSET_WINDOW_MS     10
+#define ONSET_REARM_MS      1000
+
+/* Let release and idle feedback play out before the final report */
+#define END_REPORT_DELAY_MS 2000
+
+struct dmic_file_data {
+	struct k_mem_slab *slab;
+	size_t   block_size;
+	uint32_t rate;
+	uint32_t file_rate;
+	bool     eof;
+	uint32_t overruns;
+
+	struct k_timer timer;
+	struct k_work fill_work;
+	int64_t  block_end_us;   /* Timer expiry that requested the fill */
+	struct k_msgq queue;
+	void *queue_buf[DMIC_FILE_QUEUE_LEN];
+	struct k_work_delayable end_work;
+
+	/* Onset detection */
+	bool     armed;
+	uint32_t quiet_ms;
+};
+
+static struct dmic_file_data dmic_data;
+
+/* Command line: --dmic-file=<path> [--dmic-loop] [--dmic-exit] */
+static char *file_path;
+static bool loop_file;
+static bool exit_at_end;
+
+static void dmic_file_options(void)
+{
+	static struct args_struct_t options[] = {
+		{
+			.option = "dmic-file",
+			.name = "path",
+			.type = 's',
+			.dest = (void *)&file_path,
+			.descript = "Audio for the emulated DMIC: 16-bit WAV "
+				    "or raw s16le mono at the capture rate",
+		},
+		{
+			.is_switch = true,
+			.option = "dmic-loop",
+			.type = 'b',
+			.dest = (void *)&loop_file,
+			.descript = "Replay the audio file in a loop",
+		},
+		{
+			.is_switch = true,
+			.option = "dmic-exit",
+			.type = 'b',
+			.dest = (void *)&exit_at_end,
+			.descript = "Print the latency report and exit when "
+				    "the audio file ends, with status 1 if "
+				    "the latency check fails",
+		},
+		ARG_TABLE_ENDMARKER,
+	};
+
+	native_add_command_line_opts(options);
+}
+
+NATIVE_TASK(dmic_file_options, PRE_BOOT_1, 10);
+
+static void end_work_handler(struct k_work *work)
+{
+	struct dmic_file_data *d = &dmic_data;
+
+	LOG_INF("End of audio, %u overruns", d->overruns);
+	sim_report_print();
+
+	int err = sim_report_check();
+
+	if (exit_at_end) {
+		LOG_PANIC();
+		posix_exit(err ? 1 : 0);
+	}
+}
+
+static void detect_onsets(struct dmic_file_data *d, const int16_t *samples,
+			  size_t count)
+{
+	size_t win = d->rate * ONSET_WINDOW_MS / 1000;
+	uint8_t threshold = app_config_get().threshold_db;
+	int64_t start_us = d->block_end_us -
+			   (int64_t)count * 1000000 / d->rate;
+
+	for (size_t pos = 0; pos + win <= count; pos += win) {
+		uint8_t db = sound_level_rms_to_db(
+			sound_level_rms(&samples[pos], win));
+
+		if (db < threshold) {
+			d->quiet_ms += ONSET_WINDOW_MS;
+			if (d->quiet_ms >= ONSET_REARM_MS) {
+				d->armed = true;
+			}
+			continue;
+		}
+
+		d->quiet_ms = 0;
+		if (d->armed) {
+			d->armed = false;
+			sim_report_onset(start_us + (int64_t)pos * 1000000 /
+					 d->rate, db);
+		}
+	}
+}
+
+static void fill_work_handler(struct k_work *work)
+{
+	struct dmic_file_data *d = &dmic_data;
+	size_t count = d->block_size / sizeof(int16_t);
+	void *buf;
+
+	if (k_mem_slab_alloc(d->slab, &buf, K_NO_WAIT)) {
+		d->overruns++;
+		return;
+	}
+
+	size_t got = d->eof ? 0 :
+		     dmic_file_bottom_read(buf, count, loop_file);
+
+	if (got < count) {
+		memset((int16_t *)buf + got, 0, (count - got) * sizeof(int16_t));
+		if (!d->eof && file_path) {
+			k_work_schedule(&d->end_work, K_MSEC(END_REPORT_DELAY_MS));
+		}
+		d->eof = true;
+	}
+
+	detect_onsets(d, buf, count);
+
+	if (k_msgq_put(&d->queue, &buf, K_NO_WAIT)) {
+		k_mem_slab_free(d->slab, buf);
+		d->overruns++;
+	}
+}
+
+/* The timer marks the end of a block period; filling needs a thread */
+static void block_timer_fn(struct k_timer *timer)
+{
+	struct dmic_file_data *d = &dmic_data;
+
+	d->block_end_us = (int64_t)k_ticks_to_us_floor64(k_uptime_ticks());
+	k_work_submit(&d->fill_work);
+}
+
+static int dmic_file_configure(const struct device *dev,
+			       struct dmic_cfg *cfg)
+{
+	struct dmic_file_data *d = dev->data;
+	struct pcm_stream_cfg *stream = &cfg->streams[0];
+
+	if (cfg->channel.req_num_streams != 1 ||
+	    cfg->channel.req_num_chan != 1 || stream->pcm_width != 16 ||
+	    !stream->mem_slab || stream->block_size == 0) {
+		return -EINVAL;
+	}
+
+	k_timer_stop(&d->timer);
+	d->slab = stream->mem_slab;
+	d->block_size = stream->block_size;
+	d->rate = stream->pcm_rate;
+
+	if (file_path && d->file_rate != d->rate) {
+		LOG_WRN("%s is %u Hz, capture runs at %u Hz", file_path,
+			d->file_rate, d->rate);
+	}
+
+	cfg->channel.act_num_streams = 1;
+	cfg->channel.act_num_chan = 1;
+	cfg->channel.act_chan_map_lo = cfg->channel.req_chan_map_lo;
+	return 0;
+}
+
+static int dmic_file_trigger(const struct device *dev,
+			     enum dmic_trigger cmd)
+{
+	struct dmic_file_data *d = dev->data;
+	k_timeout_t period = K_USEC((uint64_t)d->block_size / sizeof(int16_t) *
+				    1000000 / MAX(d->rate, 1U));
+	void *buf;
+
+	switch (cmd) {
+	case DMIC_TRIGGER_START:
+	case DMIC_TRIGGER_RELEASE:
+		if (!d->slab) {
+			return -EIO;
+		}
+		k_timer_start(&d->timer, period, period);
+		return 0;
+	case DMIC_TRIGGER_STOP:
+	case DMIC_TRIGGER_PAUSE:
+		k_timer_stop(&d->timer);
+		return 0;
+	case DMIC_TRIGGER_RESET:
+		k_timer_stop(&d->timer);
+		while (k_msgq_get(&d->queue, &buf, K_NO_WAIT) == 0) {
+			k_mem_slab_free(d->slab, buf);
+		}
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+static int dmic_file_read(const struct device *dev, uint8_t stream,
+			  void **buffer, size_t *size, int32_t timeout)
+{
+	struct dmic_file_data *d = dev->data;
+	int err;
+
+	ARG_UNUSED(stream);
+
+	err = k_msgq_get(&d->queue, buffer,
+			 timeout == SYS_FOREVER_MS ? K_FOREVER : K_MSEC(timeout));
+	if (err) {
+		return err;
+	}
+
+	*size = d->block_size;
+	return 0;
+}
+
+static int dmic_file_init(const struct device *dev)
+{
+	struct dmic_file_data *d = dev->data;
+
+	k_timer_init(&d->timer, block_timer_fn, NULL);
+	k_work_init(&d->fill_work, fill_work_handler);
+	k_msgq_init(&d->queue, (char *)d->queue_buf, sizeof(void *),
+		    DMIC_FILE_QUEUE_LEN);
+	k_work_init_delayable(&d->end_work, end_work_handler);
+	d->armed = true;
+
+	if (!file_path) {
+		LOG_WRN("No --dmic-file given, feeding silence");
+		d->eof = true;
+		return 0;
+	}
+
+	if (dmic_file_bottom_open(file_path, PDM_SAMPLE_RATE,
+				  &d->file_rate)) {
+		LOG_ERR("Cannot open %s", file_path);
+		return -ENOENT;
+	}
+
+	LOG_INF("Emulated DMIC reading %s (%u Hz)%s", file_path, d->file_rate,
+		loop_file ? ", looped" : "");
+	return 0;
+}
+
+static const struct _dmic_ops dmic_file_ops = {
+	.configure = dmic_file_configure,
+	.trigger = dmic_file_trigger,
+	.read = dmic_file_read,
+};
+
+DEVICE_DT_INST_DEFINE(0, dmic_file_init, NULL, &dmic_data, NULL,
+		      POST_KERNEL, CONFIG_AUDIO_DMIC_INIT_PRIORITY,
+		      &dmic_file_ops);
@@ -0,0 +1,112 @@
+/*
+ * Host side of the file-fed DMIC emulator (see dmic_file.c).
+ */
+#include "dmic_file_bottom.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static FILE *pcm_file;
+static long data_start;
+static unsigned int channels = 1;
+
+static uint32_t get_le32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t get_le16(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+/* Leave pcm_file at the first sample of the "data" chunk */
+static int wav_parse(uint32_t *rate)
+{
+	uint8_t hdr[8];
+	uint8_t fmt[16];
+	int have_fmt = 0;
+
+	while (fread(hdr, 1, sizeof(hdr), pcm_file) == sizeof(hdr)) {
+		uint32_t size = get_le32(hdr + 4);
+
+		if (memcmp(hdr, "fmt ", 4) == 0 && size >= sizeof(fmt)) {
+			if (fread(fmt, 1, sizeof(fmt), pcm_file) != sizeof(fmt) ||
+			    get_le16(fmt + 14) != 16) {
+				return -1;
+			}
+			channels = get_le16(fmt + 2);
+			*rate = get_le32(fmt + 4);
+			have_fmt = 1;
+			size -= sizeof(fmt);
+		} else if (memcmp(hdr, "data", 4) == 0) {
+			return have_fmt && channels > 0 ? 0 : -1;
+		}
+		if (fseek(pcm_file, size + (size & 1), SEEK_CUR) != 0) {
+			return -1;
+		}
+	}
+	return -1;
+}
+
+int dmic_file_bottom_open(const char *path, uint32_t raw_rate,
+			  uint32_t *rate)
+{
+	uint8_t riff[12];
+
+	pcm_file = fopen(path, "rb");
+	if (!pcm_file) {
+		return -1;
+	}
+
+	if (fread(riff, 1, sizeof(riff), pcm_file) == sizeof(riff) &&
+	    memcmp(riff, "RIFF", 4) == 0 && memcmp(riff + 8, "WAVE", 4) == 0) {
+		if (wav_parse(rate)) {
+			fclose(pcm_file);
+			pcm_file = NULL;
+			return -1;
+		}
+	} else {
+		fseek(pcm_file, 0, SEEK_SET);
+		channels = 1;
+		*rate = raw_rate;
+	}
+
+	data_start = ftell(pcm_file);
+	return 0;
+}
+
+size_t dmic_file_bottom_read(int16_t *buf, size_t count, int loop)
+{
+	uint8_t frame[16];
+	size_t frame_size = 2U * channels;
+	size_t n = 0;
+	size_t at_rewind = (size_t)-1;
+
+	if (!pcm_file || frame_size > sizeof(frame)) {
+		return 0;
+	}
+
+	while (n < count) {
+		if (fread(frame, 1, frame_size, pcm_file) != frame_size) {
+			/* Stop at the end, or if a rewind produced nothing */
+			if (!loop || at_rewind == n ||
+			    fseek(pcm_file, data_start, SEEK_SET)) {
+				break;
+			}
+			at_rewind = n;
+			continue;
+		}
+		buf[n++] = (int16_t)get_le16(frame);
+	}
+	return n;
+}
+
+uint64_t dmic_file_bottom_cpu_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
@@ -0,0 +1,36 @@
+#ifndef SIM_DMIC_FILE_BOTTOM_H
+#define SIM_DMIC_FILE_BOTTOM_H
+
+/*
+ * Host side of the file-fed DMIC emulator. Built against the host C
+ * library (not Zephyr), so only plain C types cross this interface.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Open a 16-bit PCM WAV (first channel is used) or raw s16le mono file.
+ *
+ * @param path      File to open.
+ * @param raw_rate  Rate assumed for raw files.
+ * @param rate      Output: sample rate of the file.
+ * @return 0 on success, -1 on failure.
+ */
+int dmic_file_bottom_open(const char *path, uint32_t raw_rate,
+			  uint32_t *rate);
+
+/**
+ * Read mono samples.
+ *
+ * @param buf    Output samples.
+ * @param count  Samples wanted.
+ * @param loop   Rewind to the first sample at end of file.
+ * @return Samples read; fewer than count at end of file.
+ */
+size_t dmic_file_bottom_read(int16_t *buf, size_t count, int loop);
+
+/** Host CPU time consumed by the process, in microseconds. */
+uint64_t dmic_file_bottom_cpu_us(void);
+
+#endif /* SIM_DMIC_FILE_BOTTOM_H */
@@ -0,0 +1,118 @@
+/*
+ * Output-only GPIO controller for native_sim that reports every pin
+ * change to sim_report. Pins 0-2 drive the red, green and blue LEDs.
+ */
+
+#define DT_DRV_COMPAT iv_gpio_recorder
+
+#include "sim_report.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/gpio/gpio_utils.h>
+
+struct gpio_recorder_config {
+	struct gpio_driver_config common;
+};
+
+struct gpio_recorder_data {
+	struct gpio_driver_data common;
+	gpio_port_value_t state;
+};
+
+static void record(const struct device *port, gpio_port_value_t next)
+{
+	struct gpio_recorder_data *data = port->data;
+	gpio_port_value_t changed = data->state ^ next;
+
+	data->state = next;
+	for (int pin = SIM_OUT_LED_RED; pin <= SIM_OUT_LED_BLUE; pin++) {
+		if (changed & BIT(pin)) {
+			sim_report_output(pin, next & BIT(pin));
+		}
+	}
+}
+
+static int gpio_recorder_pin_configure(const struct device *port,
+				       gpio_pin_t pin, gpio_flags_t flags)
+{
+	struct gpio_recorder_data *data = port->data;
+
+	if (flags & GPIO_INPUT) {
+		return -ENOTSUP;
+	}
+	if (flags & GPIO_OUTPUT_INIT_HIGH) {
+		record(port, data->state | BIT(pin));
+	} else if (flags & GPIO_OUTPUT_INIT_LOW) {
+		record(port, data->state & ~BIT(pin));
+	}
+	return 0;
+}
+
+static int gpio_recorder_port_get_raw(const struct device *port,
+				      gpio_port_value_t *value)
+{
+	struct gpio_recorder_data *data = port->data;
+
+	*value = data->state;
+	return 0;
+}
+
+static int gpio_recorder_port_set_masked_raw(const struct device *port,
+					     gpio_port_pins_t mask,
+					     gpio_port_value_t value)
+{
+	struct gpio_recorder_data *data = port->data;
+
+	record(port, (data->state & ~mask) | (value & mask));
+	return 0;
+}
+
+static int gpio_recorder_port_set_bits_raw(const struct device *port,
+					   gpio_port_pins_t pins)
+{
+	struct gpio_recorder_data *data = port->data;
+
+	record(port, data->state | pins);
+	return 0;
+}
+
+static int gpio_recorder_port_clear_bits_raw(const struct device *port,
+					     gpio_port_pins_t pins)
+{
+	struct gpio_recorder_data *data = port->data;
+
+	record(port, data->state & ~pins);
+	return 0;
+}
+
+static int gpio_recorder_port_toggle_bits(const struct device *port,
+					  gpio_port_pins_t pins)
+{
+	struct gpio_recorder_data *data = port->data;
+
+	record(port, data->state ^ pins);
+	return 0;
+}
+
+static const struct gpio_driver_api gpio_recorder_api = {
+	.pin_configure = gpio_recorder_pin_configure,
+	.port_get_raw = gpio_recorder_port_get_raw,
+	.port_set_masked_raw = gpio_recorder_port_set_masked_raw,
+	.port_set_bits_raw = gpio_recorder_port_set_bits_raw,
+	.port_clear_bits_raw = gpio_recorder_port_clear_bits_raw,
+	.port_toggle_bits = gpio_recorder_port_toggle_bits,
+};
+
+static const struct gpio_recorder_config gpio_recorder_cfg = {
+	.common = {
+		.port_pin_mask = GPIO_PORT_PIN_MASK_FROM_DT_INST(0),
+	},
+};
+
+static struct gpio_recorder_data gpio_recorder_data;
+
+DEVICE_DT_INST_DEFINE(0, NULL, NULL, &gpio_recorder_data,
+		      &gpio_recorder_cfg, PRE_KERNEL_1,
+		      CONFIG_GPIO_INIT_PRIORITY, &gpio_recorder_api);
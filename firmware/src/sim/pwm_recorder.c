@@ -0,0 +1,52 @@
+/*
+ * PWM controller for native_sim that reports duty changes to
+ * sim_report. Channel 0 drives the vibration motor.
+ */
+
+#define DT_DRV_COMPAT iv_pwm_recorder
+
+#include "sim_report.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/pwm.h>
+
+/* Nominal counter clock, so PWM_MSEC() periods map to whole cycles */
+#define PWM_RECORDER_CLOCK_HZ 1000000
+
+static bool motor_on;
+
+static int pwm_recorder_set_cycles(const struct device *dev,
+				   uint32_t channel, uint32_t period_cycles,
+				   uint32_t pulse_cycles, pwm_flags_t flags)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(period_cycles);
+	ARG_UNUSED(flags);
+
+	bool on = pulse_cycles > 0;
+
+	if (channel == 0 && on != motor_on) {
+		motor_on = on;
+		sim_report_output(SIM_OUT_VIB, on);
+	}
+	return 0;
+}
+
+static int pwm_recorder_get_cycles_per_sec(const struct device *dev,
+					   uint32_t channel, uint64_t *cycles)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(channel);
+
+	*cycles = PWM_RECORDER_CLOCK_HZ;
+	return 0;
+}
+
+static const struct pwm_driver_api pwm_recorder_api = {
+	.set_cycles = pwm_recorder_set_cycles,
+	.get_cycles_per_sec = pwm_recorder_get_cycles_per_sec,
+};
+
+DEVICE_DT_INST_DEFINE(0, NULL, NULL, NULL, NULL, PRE_KERNEL_1,
+		      CONFIG_PWM_INIT_PRIORITY, &pwm_recorder_api);
@@ -0,0 +1,171 @@
+#include "sim_report.h"
+#include "dmic_file_bottom.h"
+
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+#endif
+
+LOG_MODULE_REGISTER(sim_report, LOG_LEVEL_INF);
+
+/* Recent output edges, kept for "iv sim" */
+#define SIM_EVENT_LOG 32
+
+struct sim_event {
+	int64_t t_us;
+	uint8_t out;
+	bool    on;
+};
+
+/* Latency of one feedback channel relative to onsets */
+struct sim_latency {
+	uint32_t count;
+	int64_t  min_us;
+	int64_t  max_us;
+	int64_t  sum_us;
+	bool     pending;  /* Waiting for an edge after the last onset */
+};
+
+static const char *const output_names[SIM_OUT_COUNT] = {
+	[SIM_OUT_LED_RED] = "led red",
+	[SIM_OUT_LED_GREEN] = "led green",
+	[SIM_OUT_LED_BLUE] = "led blue",
+	[SIM_OUT_VIB] = "vibration",
+};
+
+static struct sim_event events[SIM_EVENT_LOG];
+static uint32_t event_count;
+
+static uint32_t onsets;
+static int64_t last_onset_us;
+static struct sim_latency led_lat;
+static struct sim_latency vib_lat;
+
+static int64_t now_us(void)
+{
+	return (int64_t)k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+void sim_report_onset(int64_t t_us, uint8_t db)
+{
+	onsets++;
+	last_onset_us = t_us;
+	led_lat.pending = true;
+	vib_lat.pending = true;
+	LOG_INF("Onset %u at %lld ms (%u dB)", onsets, t_us / 1000, db);
+}
+
+static void latency_add(struct sim_latency *lat, int64_t t_us,
+			const char *name)
+{
+	int64_t d = t_us - last_onset_us;
+
+	lat->pending = false;
+	lat->min_us = lat->count ? MIN(lat->min_us, d) : d;
+	lat->max_us = lat->count ? MAX(lat->max_us, d) : d;
+	lat->sum_us += d;
+	lat->count++;
+	LOG_INF("Onset %u -> %s: %lld ms", onsets, name, d / 1000);
+}
+
+void sim_report_output(enum sim_output out, bool on)
+{
+	int64_t t = now_us();
+	struct sim_event *ev = &events[event_count++ % SIM_EVENT_LOG];
+
+	ev->t_us = t;
+	ev->out = out;
+	ev->on = on;
+
+	if (!on) {
+		return;
+	}
+	if (out == SIM_OUT_LED_RED && led_lat.pending) {
+		latency_add(&led_lat, t, "led");
+	} else if (out == SIM_OUT_VIB && vib_lat.pending) {
+		latency_add(&vib_lat, t, "vibration");
+	}
+}
+
+static void latency_print(const char *name, const struct sim_latency *lat)
+{
+	if (lat->count == 0) {
+		LOG_INF("%-9s no feedback after %u onsets", name, onsets);
+		return;
+	}
+	LOG_INF("%-9s %u/%u onsets, latency min %lld avg %lld max %lld ms",
+		name, lat->count, onsets, lat->min_us / 1000,
+		lat->sum_us / lat->count / 1000, lat->max_us / 1000);
+}
+
+void sim_report_print(void)
+{
+	int64_t sim_ms = k_uptime_get();
+	uint64_t cpu_us = dmic_file_bottom_cpu_us();
+
+	latency_print("led", &led_lat);
+	latency_print("vibration", &vib_lat);
+	LOG_INF("Simulated %lld ms using %llu ms host CPU (%llu us per "
+		"simulated s)", sim_ms, cpu_us / 1000,
+		sim_ms ? cpu_us * 1000 / sim_ms : 0);
+}
+
+static int latency_check(const char *name, const struct sim_latency *lat)
+{
+	int64_t budget_us = CONFIG_IV_SIM_LATENCY_BUDGET_MS * 1000LL;
+
+	if (lat->count > 0 && lat->max_us > budget_us) {
+		LOG_ERR("%s latency %lld ms over the %u ms budget", name,
+			lat->max_us / 1000, CONFIG_IV_SIM_LATENCY_BUDGET_MS);
+		return -ETIMEDOUT;
+	}
+	return 0;
+}
+
+int sim_report_check(void)
+{
+	int err = 0;
+
+	/* The motor may be disabled by the pattern, the LED may not */
+	if (led_lat.count == 0) {
+		LOG_ERR("No LED feedback after %u onsets", onsets);
+		err = -ENODATA;
+	}
+	if (latency_check("led", &led_lat) ||
+	    latency_check("vibration", &vib_lat)) {
+		err = -ETIMEDOUT;
+	}
+
+	if (err) {
+		LOG_ERR("Latency check failed");
+	} else {
+		LOG_INF("Latency check passed: max %lld ms, budget %u ms",
+			MAX(led_lat.max_us, vib_lat.max_us) / 1000,
+			CONFIG_IV_SIM_LATENCY_BUDGET_MS);
+	}
+	return err;
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_iv_sim(const struct shell *sh, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	uint32_t n = MIN(event_count, SIM_EVENT_LOG);
+
+	for (uint32_t i = event_count - n; i != event_count; i++) {
+		const struct sim_event *ev = &events[i % SIM_EVENT_LOG];
+
+		shell_print(sh, "%10lld us  %-9s %s", ev->t_us,
+			    output_names[ev->out], ev->on ? "on" : "off");
+	}
+	sim_report_print();
+	return 0;
+}
+
+SHELL_SUBCMD_ADD((iv), sim, NULL, "Recorded outputs and onset latencies",
+		 cmd_iv_sim, 1, 0);
+#endif
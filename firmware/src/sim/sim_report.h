@@ -0,0 +1,51 @@
+#ifndef SIM_SIM_REPORT_H
+#define SIM_SIM_REPORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * End-to-end latency bookkeeping for native_sim runs.
+ *
+ * The emulated DMIC marks loudness onsets in the audio it feeds; the
+ * recorder GPIO and PWM drivers mark every output edge. The first red
+ * LED and vibration edge after an onset gives that onset's feedback
+ * latency. All times are simulated microseconds.
+ */
+
+enum sim_output {
+	SIM_OUT_LED_RED,
+	SIM_OUT_LED_GREEN,
+	SIM_OUT_LED_BLUE,
+	SIM_OUT_VIB,
+	SIM_OUT_COUNT,
+};
+
+/**
+ * Mark a loudness onset in the emulated audio.
+ *
+ * @param t_us  Simulated time of the onset sample.
+ * @param db    Level of the window that crossed the threshold.
+ */
+void sim_report_onset(int64_t t_us, uint8_t db);
+
+/**
+ * Record an output edge from a recorder driver.
+ *
+ * @param out  Output that changed.
+ * @param on   New state (LED lit, motor pulse width non-zero).
+ */
+void sim_report_output(enum sim_output out, bool on);
+
+/** Log onsets, feedback latencies and host CPU use per simulated second. */
+void sim_report_print(void);
+
+/**
+ * Hold the feedback latencies to CONFIG_IV_SIM_LATENCY_BUDGET_MS.
+ *
+ * @return 0 if every feedback edge came within the budget, -ETIMEDOUT if
+ *         one was later, -ENODATA if no onset got LED feedback.
+ */
+int sim_report_check(void);
+
+#endif /* SIM_SIM_REPORT_H */
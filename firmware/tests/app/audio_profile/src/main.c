@@ -0,0 +1,126 @@
+/*
+ * CPU time per second of audio, and RAM, for each capture profile.
+ *
+ * Ten seconds of noise go through the per-block work of the monitor
+ * thread (octave bands, A-weighting, VAD, level detector) in 100 ms
+ * blocks, at the full profile's 16 kHz and the level-only profile's
+ * 12.5 kHz. The time is printed as cycles per second of audio at the
+ * 64 MHz core clock and as a share of the core, next to the profile's
+ * default slab and the analysis state. The level-only profile must cost
+ * less than the full one, except on QEMU and native_sim, whose timing
+ * does not model the core.
+ */
+#include <zephyr/kernel.h>
+#include <zephyr/timing/timing.h>
+#include <zephyr/ztest.h>
+
+#include "app/analysis.h"
+#include "audio/band_analyzer.h"
+#include "audio/weighting.h"
+
+#define CPU_MHZ     64
+#define SECONDS     10
+#define RUNS        3
+#define BLOCK_MS    100
+#define NUM_BLOCKS  4      /* Default CONFIG_IV_PDM_NUM_BLOCKS */
+#define MAX_BLOCK   (16000 * BLOCK_MS / 1000)
+#define THRESHOLD   70
+
+struct profile {
+	const char *name;
+	uint32_t rate;
+};
+
+static const struct profile profiles[] = {
+	{ "full", 16000 },
+	{ "level-only", 12500 },
+};
+
+static int16_t block[MAX_BLOCK];
+static struct analysis analysis;
+
+/* Slab bytes of the default geometry, as PDM_BLOCK_BYTES() sizes it */
+static uint32_t slab_bytes(uint32_t rate)
+{
+	return ROUND_UP(rate * BLOCK_MS / 1000 * sizeof(int16_t), 4) *
+	       NUM_BLOCKS;
+}
+
+/* CPU cycles at CPU_MHZ per second of audio, best of RUNS */
+static uint32_t cycles_per_second(uint32_t rate)
+{
+	const struct analysis_cfg cfg = {
+		.sample_rate = rate,
+		.subframe_ms = 100,
+		.window_ms = 100,
+		.attack_ms = 300,
+		.release_ms = 300,
+		.vad = true,
+		.vad_margin_db = 6,
+		.vad_hangover_ms = 300,
+		.notify_interval_ms = 100,
+		.cache_interval_ms = 1000,
+	};
+	size_t n = rate * BLOCK_MS / 1000;
+	uint64_t best = UINT64_MAX;
+
+	for (int r = 0; r < RUNS; r++) {
+		uint32_t seed = 1;
+		uint64_t total = 0;
+
+		zassert_ok(analysis_init(&analysis, &cfg));
+		zassert_ok(band_analyzer_init(rate));
+
+		for (int b = 0; b < SECONDS * 1000 / BLOCK_MS; b++) {
+			struct analysis_result res;
+
+			for (size_t i = 0; i < n; i++) {
+				seed = seed * 1103515245U + 12345U;
+				block[i] = (int16_t)(seed >> 16) / 4;
+			}
+
+			timing_t t0 = timing_counter_get();
+
+			band_analyzer_process(block, n);
+			analysis_process(&analysis, block, n, 0, THRESHOLD,
+					 WEIGHTING_A, &res);
+
+			timing_t t1 = timing_counter_get();
+
+			total += timing_cycles_get(&t0, &t1);
+		}
+		best = MIN(best, total);
+	}
+	return (uint32_t)(timing_cycles_to_ns(best) * CPU_MHZ / 1000 /
+			  SECONDS);
+}
+
+ZTEST(audio_profile, test_cost_per_profile)
+{
+	uint32_t cyc[ARRAY_SIZE(profiles)];
+
+	timing_init();
+	timing_start();
+
+	for (size_t p = 0; p < ARRAY_SIZE(profiles); p++) {
+		cyc[p] = cycles_per_second(profiles[p].rate);
+
+		TC_PRINT("%-10s %5u Hz: %8u cycles per s of audio at %u MHz "
+			 "(%u.%02u%% CPU), slab %5u B, analysis %u B\n",
+			 profiles[p].name, profiles[p].rate, cyc[p], CPU_MHZ,
+			 cyc[p] / (CPU_MHZ * 10000),
+			 cyc[p] % (CPU_MHZ * 10000) / (CPU_MHZ * 100),
+			 slab_bytes(profiles[p].rate),
+			 (unsigned int)sizeof(struct analysis));
+	}
+
+	timing_stop();
+
+	zassert_true(slab_bytes(12500) < slab_bytes(16000));
+#if !defined(CONFIG_QEMU_TARGET) && !defined(CONFIG_ARCH_POSIX)
+	zassert_true(cyc[1] < cyc[0], "level-only %u cycles/s, full %u",
+		     cyc[1], cyc[0]);
+#endif
+}
+
+ZTEST_SUITE(audio_profile, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,192 @@
+/*
+ * The lock-free sample cache against the mutex cache it replaced.
+ *
+ * Push, get and a sync's worth of reads run on both caches, best of
+ * RUNS batches timed with the timing counter. The lock-free cache must
+ * cost less for push and sync. A single get is printed only: against an
+ * uncontended pthread lock on the host the two are within noise, and
+ * iv_bench checks its instruction count instead. The mutex cache is tools/bench/mutex_cache.c,
+ * the iv_bench baseline, locking a k_mutex as data_cache did. QEMU and
+ * native_sim do not model the core's timing, so there the costs are only
+ * printed.
+ */
+#include <zephyr/kernel.h>
+#include <zephyr/timing/timing.h>
+#include <zephyr/ztest.h>
+
+#include "app/data_cache.h"
+#include "mutex_cache.h"
+
+#define RUNS      9
+#define CALLS     2048
+#define CPU_MHZ   64
+#define BATCH     16
+
+static volatile uint32_t sink;
+static uint32_t idx;
+static uint32_t held;
+static uint32_t mx_held;
+
+/* On target, pushes come faster than the 1 s cadence, so each opens a
+ * segment and the caches hold one sample per segment (the lock-free one
+ * keeps a slot spare, so one fewer). The host build's clock keeps them
+ * on cadence (tools/tests/cadence_clock.c), one cache after the other.
+ */
+static void fill(void)
+{
+	data_cache_init();
+	for (uint32_t i = 0; i < CACHE_MAX_SAMPLES; i++) {
+		data_cache_push((uint8_t)i);
+	}
+	mutex_cache_init();
+	for (uint32_t i = 0; i < CACHE_MAX_SAMPLES; i++) {
+		mutex_cache_push((uint8_t)i);
+	}
+	held = data_cache_count();
+	for (mx_held = 0; mutex_cache_get(mx_held, &(struct iv_sample){});
+	     mx_held++) {
+	}
+	idx = 0;
+}
+
+static void lf_push(void)
+{
+	data_cache_push((uint8_t)sink++);
+}
+
+static void mx_push(void)
+{
+	mutex_cache_push((uint8_t)sink++);
+}
+
+static void lf_get(void)
+{
+	struct iv_sample s;
+
+	data_cache_get(idx, &s);
+	idx = (idx + 1) % held;
+	sink += s.db;
+}
+
+static void mx_get(void)
+{
+	struct iv_sample s;
+
+	mutex_cache_get(idx, &s);
+	idx = (idx + 1) % held;
+	sink += s.db;
+}
+
+/* Every held sample: snapshot reads, as sync does now */
+static void lf_sync(void)
+{
+	struct iv_sample buf[BATCH];
+	struct iv_cursor cur;
+
+	data_cache_snapshot(&cur);
+	for (uint32_t i = 0; i < held; i += BATCH) {
+		int n = data_cache_read(&cur, i, buf, BATCH);
+
+		sink += n > 0 ? buf[n - 1].db : 0;
+	}
+	data_cache_release(&cur);
+}
+
+/* The same samples one locked get at a time, as sync did before */
+static void mx_sync(void)
+{
+	struct iv_sample s;
+
+	for (uint32_t i = 0; i < held; i++) {
+		mutex_cache_get(i, &s);
+		sink += s.db;
+	}
+}
+
+/* Timing counter cycles for the best of RUNS batches of calls */
+static uint64_t measure(void (*run)(void), uint32_t calls)
+{
+	uint64_t best = UINT64_MAX;
+
+	for (int r = 0; r < RUNS; r++) {
+		fill();
+
+		timing_t t0 = timing_counter_get();
+
+		for (uint32_t i = 0; i < calls; i++) {
+			run();
+		}
+
+		timing_t t1 = timing_counter_get();
+
+		best = MIN(best, timing_cycles_get(&t0, &t1));
+	}
+	return best;
+}
+
+/* Tenths of a cycle per call at CPU_MHZ */
+static uint32_t per_call(uint64_t cyc, uint32_t calls)
+{
+	return (uint32_t)(timing_cycles_to_ns(cyc) * CPU_MHZ / 100 / calls);
+}
+
+ZTEST(cache_baseline, test_lock_free_beats_mutex)
+{
+	static const struct {
+		const char *name;
+		void (*lock_free)(void);
+		void (*mutex)(void);
+		uint32_t calls;
+		bool must_win;
+	} cases[] = {
+		{ "push", lf_push, mx_push, CALLS, true },
+		{ "get", lf_get, mx_get, CALLS, false },
+		{ "sync", lf_sync, mx_sync, 8, true },
+	};
+
+	timing_init();
+	timing_start();
+
+	for (size_t i = 0; i < ARRAY_SIZE(cases); i++) {
+		uint64_t lf = measure(cases[i].lock_free, cases[i].calls);
+		uint64_t mx = measure(cases[i].mutex, cases[i].calls);
+
+		uint32_t lf10 = per_call(lf, cases[i].calls);
+		uint32_t mx10 = per_call(mx, cases[i].calls);
+
+		TC_PRINT("%-4s: lock-free %5u.%u, mutex %5u.%u cycles per call "
+			 "at %u MHz\n", cases[i].name, lf10 / 10, lf10 % 10,
+			 mx10 / 10, mx10 % 10, CPU_MHZ);
+		if (!cases[i].must_win) {
+			continue;
+		}
+		/* Whole batches in counter cycles: per-call rounding would
+		 * hide the difference on a fast host
+		 */
+#if !defined(CONFIG_QEMU_TARGET) && !defined(CONFIG_ARCH_POSIX)
+		zassert_true(lf < mx, "%s: lock-free %u cycles, mutex %u",
+			     cases[i].name, (uint32_t)lf, (uint32_t)mx);
+#endif
+	}
+
+	timing_stop();
+}
+
+ZTEST(cache_baseline, test_same_samples)
+{
+	fill();
+
+	zassert_true(held > 0 && held <= mx_held);
+
+	/* Newest first, since the mutex cache may hold older ones too */
+	for (uint32_t k = 1; k <= held; k++) {
+		struct iv_sample a;
+		struct iv_sample b;
+
+		zassert_true(data_cache_get(held - k, &a));
+		zassert_true(mutex_cache_get(mx_held - k, &b));
+		zassert_equal(a.db, b.db, "sample %u from the newest", k);
+	}
+}
+
+ZTEST_SUITE(cache_baseline, NULL, NULL, NULL, NULL, NULL);
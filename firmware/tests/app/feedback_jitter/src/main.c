@@ -0,0 +1,155 @@
+/*
+ * Vibration step timing while a sync streams.
+ *
+ * A chain of 60 ms steps runs on feedback_wq, each measuring how late it
+ * ran against the tick it was due at, as vib_handler() does for `iv vib`.
+ * Meanwhile a sync streams the whole cache in frames on ble_tx_wq, back
+ * to back: SYNC_CREDITS frames per work item as the GATT sync sends,
+ * then the next item at once rather than when the link returns credits,
+ * and the next sync a tick after one ends. No step may be more than a
+ * tick, or LATE_MAX_US, late.
+ *
+ * The same steps are then timed with the sync on feedback_wq, as when
+ * both shared the system workqueue; that lateness is only printed.
+ */
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/ztest.h>
+
+#include "app/data_cache.h"
+#include "app/sync_stream.h"
+#include "ble/ble_tx.h"
+#include "feedback/feedback_wq.h"
+
+#define STEPS        50    /* 3 s of soft pulse steps */
+#define STEP_MS      60
+#define SYNC_CREDITS 6     /* Frames queued per work item, as the GATT sync */
+#define FRAME_SIZE   244   /* Sync frame at a 247-byte ATT MTU */
+#define LATE_MAX_US  1000
+
+struct step_stats {
+	uint32_t steps;
+	uint32_t max_us;
+	uint64_t sum_us;
+	uint32_t frames;  /* Sync frames built meanwhile */
+	uint32_t syncs;
+};
+
+static struct k_work_delayable step_work;
+static int64_t step_due;
+static struct step_stats stats;
+static K_SEM_DEFINE(steps_done, 0, 1);
+
+static struct k_work_q *sync_q;
+static struct k_work_delayable sync_work;
+static struct sync_stream stream;
+static bool stream_open;
+static atomic_t sync_on;
+
+static void step_schedule(void)
+{
+	step_due = k_uptime_ticks() + k_ms_to_ticks_ceil64(STEP_MS);
+	k_work_reschedule_for_queue(&feedback_wq, &step_work, K_MSEC(STEP_MS));
+}
+
+static void step_handler(struct k_work *work)
+{
+	int64_t late = MAX(k_uptime_ticks() - step_due, 0);
+	uint32_t us = (uint32_t)k_ticks_to_us_floor64(late);
+
+	stats.max_us = MAX(stats.max_us, us);
+	stats.sum_us += us;
+	if (++stats.steps < STEPS) {
+		step_schedule();
+	} else {
+		k_sem_give(&steps_done);
+	}
+}
+
+static void sync_handler(struct k_work *work)
+{
+	static uint8_t frame[FRAME_SIZE];
+
+	if (!stream_open) {
+		sync_stream_open(&stream);
+		stream_open = true;
+	}
+
+	for (int i = 0; i < SYNC_CREDITS && stream_open; i++) {
+		uint16_t len;
+
+		if (sync_stream_frame(&stream, frame, sizeof(frame), &len) == 0) {
+			stream_open = false;
+			stats.syncs++;
+		}
+		sync_stream_commit(&stream);
+		stats.frames++;
+	}
+
+	/* A tick between syncs, so native_sim's clock can move */
+	if (atomic_get(&sync_on)) {
+		k_work_reschedule_for_queue(sync_q, &sync_work,
+					    stream_open ? K_NO_WAIT : K_TICKS(1));
+	}
+}
+
+/* Time STEPS steps on feedback_wq with a sync streaming on q */
+static struct step_stats run(struct k_work_q *q)
+{
+	struct k_work_sync sync;
+
+	stats = (struct step_stats){ 0 };
+	stream_open = false;
+	sync_q = q;
+	atomic_set(&sync_on, 1);
+	k_work_reschedule_for_queue(q, &sync_work, K_NO_WAIT);
+	step_schedule();
+
+	zassert_equal(k_sem_take(&steps_done,
+				 K_MSEC(STEPS * STEP_MS * 2)), 0,
+		      "steps stalled behind the sync");
+
+	atomic_clear(&sync_on);
+	k_work_cancel_delayable_sync(&sync_work, &sync);
+	zassert_true(stats.syncs > 0, "no sync finished during the steps");
+	return stats;
+}
+
+static void print_stats(const char *name, const struct step_stats *s)
+{
+	TC_PRINT("%-12s %u steps, late by %u us on average, %u us at most; "
+		 "%u frames, %u syncs\n", name, s->steps,
+		 (uint32_t)(s->sum_us / s->steps), s->max_us, s->frames,
+		 s->syncs);
+}
+
+static void *setup(void)
+{
+	feedback_wq_init();
+	ble_tx_init();
+	k_work_init_delayable(&step_work, step_handler);
+	k_work_init_delayable(&sync_work, sync_handler);
+
+	/* A full cache to sync */
+	data_cache_init();
+	for (uint32_t i = 0; i < CACHE_MAX_SAMPLES; i++) {
+		data_cache_push((uint8_t)(40 + i % 50));
+	}
+	return NULL;
+}
+
+ZTEST(feedback_jitter, test_steps_on_time_during_sync)
+{
+	struct step_stats tx = run(&ble_tx_wq);
+	uint32_t bound = MAX(LATE_MAX_US, k_ticks_to_us_ceil32(1));
+
+	print_stats("ble_tx_wq", &tx);
+	zassert_true(tx.max_us <= bound, "a step was %u us late, bound %u us",
+		     tx.max_us, bound);
+
+	struct step_stats shared = run(&feedback_wq);
+
+	print_stats("shared queue", &shared);
+}
+
+ZTEST_SUITE(feedback_jitter, NULL, setup, NULL, NULL, NULL);
@@ -0,0 +1,189 @@
+/*
+ * Level detector timing on synthetic steps.
+ *
+ * Silence steps to an 89 dB square wave and back, with the step placed
+ * anywhere in a block and blocks of several lengths. The trigger must
+ * come attack time after the step, and the release release time plus
+ * one window after it, each within one sub-frame. With 10 ms sub-frames
+ * a 30 ms attack must give feedback well inside one 100 ms block.
+ */
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+#include "app/level_detector.h"
+
+#define RATE       16000
+#define THRESHOLD  70
+#define LOUD       30000  /* Square wave amplitude, 89 dB */
+#define MAX_BLOCK  (RATE / 10)
+
+static int16_t block[MAX_BLOCK];
+
+struct step_result {
+	int32_t trigger_ms;  /* After the onset, -1 if none */
+	int32_t release_ms;  /* After the offset, -1 if none */
+};
+
+/* Loud from onset for loud samples, silent around it */
+static int16_t step_sample(uint32_t n, uint32_t onset, uint32_t loud)
+{
+	if (n < onset || n >= onset + loud) {
+		return 0;
+	}
+	return n % 2 ? LOUD : -LOUD;
+}
+
+static struct step_result run_step(const struct level_det_cfg *cfg,
+				   uint32_t block_ms, uint32_t onset,
+				   uint32_t loud, uint32_t total)
+{
+	struct level_detector det;
+	struct step_result r = { -1, -1 };
+	uint32_t block_len = RATE * block_ms / 1000;
+
+	zassert_ok(level_detector_init(&det, cfg));
+	zassert_true(block_len > 0 && block_len <= MAX_BLOCK);
+
+	for (uint32_t pos = 0; pos < total; pos += block_len) {
+		struct level_det_result res;
+
+		for (uint32_t i = 0; i < block_len; i++) {
+			block[i] = step_sample(pos + i, onset, loud);
+		}
+		level_detector_process(&det, block, block_len, THRESHOLD, true,
+				       &res);
+
+		int32_t at = (int32_t)(pos + res.event_offset);
+
+		if (res.event == LEVEL_DET_EVENT_TRIGGER && r.trigger_ms < 0) {
+			r.trigger_ms = (at - (int32_t)onset) * 1000 / RATE;
+		} else if (res.event == LEVEL_DET_EVENT_RELEASE &&
+			   r.release_ms < 0) {
+			r.release_ms = (at - (int32_t)(onset + loud)) * 1000 /
+				       RATE;
+		}
+	}
+	return r;
+}
+
+/* Attack and release rounded up to whole sub-frames, at least one */
+static int32_t whole_frames_ms(uint32_t ms, uint32_t subframe_ms)
+{
+	return MAX(DIV_ROUND_UP(ms, subframe_ms), 1U) * subframe_ms;
+}
+
+ZTEST(level_detector, test_step_latency)
+{
+	static const struct {
+		uint16_t subframe_ms;
+		uint16_t window_ms;
+		uint16_t attack_ms;
+		uint16_t release_ms;
+	} cfgs[] = {
+		{ 100, 100, 300, 300 },  /* One decision per default block */
+		{ 20, 100, 300, 300 },
+		{ 10, 10, 30, 200 },     /* Streaming */
+		{ 10, 160, 0, 50 },
+		{ 25, 1600, 100, 100 },  /* Window clamped to 16 sub-frames */
+	};
+	static const uint16_t blocks_ms[] = { 100, 20, 37 };
+	static const uint16_t onsets_ms[] = { 1000, 1003, 1055, 1099 };
+
+	for (size_t c = 0; c < ARRAY_SIZE(cfgs); c++) {
+		const struct level_det_cfg cfg = {
+			.sample_rate = RATE,
+			.subframe_ms = cfgs[c].subframe_ms,
+			.window_ms = cfgs[c].window_ms,
+			.attack_ms = cfgs[c].attack_ms,
+			.release_ms = cfgs[c].release_ms,
+		};
+		int32_t s = cfg.subframe_ms;
+		int32_t w = CLAMP(cfg.window_ms / s, 1,
+				  LEVEL_DET_MAX_WINDOW_FRAMES) * s;
+		int32_t a = whole_frames_ms(cfg.attack_ms, s);
+		int32_t r = whole_frames_ms(cfg.release_ms, s);
+
+		for (size_t b = 0; b < ARRAY_SIZE(blocks_ms); b++) {
+			for (size_t o = 0; o < ARRAY_SIZE(onsets_ms); o++) {
+				uint32_t onset = RATE / 1000 * onsets_ms[o];
+				struct step_result res =
+					run_step(&cfg, blocks_ms[b], onset,
+						 RATE * 2, RATE * 5);
+
+				TC_PRINT("sub %3d win %4d blk %3u onset +%2u: "
+					 "trigger %3d ms, release %4d ms\n",
+					 s, w, blocks_ms[b],
+					 onsets_ms[o] - 1000, res.trigger_ms,
+					 res.release_ms);
+
+				/* The first loud sub-frame may be partial */
+				zassert_between_inclusive(res.trigger_ms,
+							  a - s, a + s,
+							  "trigger %d ms",
+							  res.trigger_ms);
+
+				/* Loud sub-frames leave the window first */
+				zassert_between_inclusive(res.release_ms,
+							  r + w - 2 * s, r + w,
+							  "release %d ms",
+							  res.release_ms);
+			}
+		}
+	}
+}
+
+ZTEST(level_detector, test_streaming_beats_block)
+{
+	const struct level_det_cfg stream = {
+		.sample_rate = RATE,
+		.subframe_ms = 10,
+		.window_ms = 10,
+		.attack_ms = 30,
+		.release_ms = 300,
+	};
+	struct step_result res = run_step(&stream, 100, RATE + RATE / 50,
+					  RATE, RATE * 3);
+
+	/* Feedback inside the block the step started in */
+	zassert_between_inclusive(res.trigger_ms, 20, 40, "trigger %d ms",
+				  res.trigger_ms);
+}
+
+ZTEST(level_detector, test_short_burst_ignored)
+{
+	const struct level_det_cfg cfg = {
+		.sample_rate = RATE,
+		.subframe_ms = 10,
+		.window_ms = 10,
+		.attack_ms = 300,
+		.release_ms = 300,
+	};
+	struct step_result res = run_step(&cfg, 100, RATE, RATE / 5,
+					  RATE * 3);
+
+	zassert_equal(res.trigger_ms, -1, "200 ms burst triggered");
+}
+
+ZTEST(level_detector, test_window_clamped)
+{
+	struct level_detector det;
+	struct level_det_cfg cfg = {
+		.sample_rate = RATE,
+		.subframe_ms = 10,
+		.window_ms = 1600,
+		.attack_ms = 300,
+		.release_ms = 300,
+	};
+
+	zassert_ok(level_detector_init(&det, &cfg));
+	zassert_equal(det.window_frames, LEVEL_DET_MAX_WINDOW_FRAMES);
+
+	cfg.window_ms = 5;
+	zassert_ok(level_detector_init(&det, &cfg));
+	zassert_equal(det.window_frames, 1);
+
+	cfg.subframe_ms = 0;
+	zassert_equal(level_detector_init(&det, &cfg), -EINVAL);
+}
+
+ZTEST_SUITE(level_detector, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,189 @@
+/*
+ * Syncs cut off by a dropped link, each resumed where the app stopped.
+ *
+ * Stretches of logging alternate with framed syncs through sync_stream,
+ * most of them cut off at a random frame: the IN_FLIGHT frames queued
+ * behind the last one the app received never arrive. The app
+ * acknowledges with history_ack() every ACK_EVERY records and at the end
+ * frame, and the next sync seeks to where it stopped. Every sample must
+ * arrive once and in order, exactly the unacknowledged ones stay held,
+ * and a late ack must not move the mark back.
+ *
+ * The flash_log scenario runs the same syncs on the flash log: flushes
+ * move samples out of RAM while a sync streams them from its tail, and
+ * acks are applied to the log on the history workqueue.
+ */
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/ztest.h>
+#if defined(CONFIG_IV_FLASH_LOG)
+#include <zephyr/storage/flash_map.h>
+#endif
+
+#include "app/history.h"
+#include "app/sync_stream.h"
+
+#define SESSIONS   60
+#define LOG_MAX    300  /* Samples logged between syncs, at most */
+#define CUT_MAX    12   /* Frames sent before the link drops, at most */
+#define IN_FLIGHT  6    /* Frames lost with the link, as SYNC_TX_CREDITS */
+#define ACK_EVERY  100  /* Records the app takes between acks */
+#define GAP_EVERY  50   /* One sample in this many follows a gap */
+#define FRAME_SIZE 244  /* Sync frame at a 247-byte ATT MTU */
+
+/* The app's side: where it resumes from and what it has acknowledged */
+struct app {
+	uint32_t next_seq;
+	uint32_t acked;
+	uint32_t since_ack;
+	uint32_t last_uptime;
+	uint32_t records;
+};
+
+static uint32_t seed = 1;
+static uint32_t pushed;
+
+static uint32_t rnd(void)
+{
+	seed = seed * 1103515245U + 12345U;
+	return seed >> 16;
+}
+
+/* The level logged as sample seq */
+static uint8_t level(uint32_t seq)
+{
+	return (uint8_t)(30 + seq % 71);
+}
+
+/* One sample per cache interval, now and then after a gap */
+static void log_samples(uint32_t n)
+{
+	for (uint32_t i = 0; i < n; i++) {
+		uint32_t intervals = rnd() % GAP_EVERY == 0 ? 5 : 1;
+
+		k_sleep(K_MSEC(intervals * CACHE_INTERVAL_MS));
+		history_push(level(pushed++));
+	}
+}
+
+static void receive(struct app *app, const uint8_t *f, uint16_t len)
+{
+	uint32_t count = f[2];
+	uint32_t first = sys_get_le32(&f[3]);
+
+	/* Nothing is lost in this test, so frames must follow on exactly */
+	zassert_equal(f[0], SYNC_FRAME_VERSION);
+	zassert_equal(first, app->next_seq, "frame at %u, expected %u", first,
+		      app->next_seq);
+	zassert_equal(len, SYNC_FRAME_HDR_SIZE +
+		      count * IV_SAMPLE_RECORD_SIZE);
+
+	for (uint32_t i = 0; i < count; i++) {
+		const uint8_t *r = &f[SYNC_FRAME_HDR_SIZE +
+				      i * IV_SAMPLE_RECORD_SIZE];
+		uint32_t uptime = sys_get_le32(r);
+
+		zassert_true(app->records + i == 0 ||
+			     (int32_t)(uptime - app->last_uptime) > 0,
+			     "sample %u out of order", first + i);
+		zassert_equal(r[4], level(first + i), "sample %u", first + i);
+		app->last_uptime = uptime;
+	}
+	app->next_seq = first + count;
+	app->records += count;
+	app->since_ack += count;
+
+	if ((f[1] & SYNC_FRAME_END) || app->since_ack >= ACK_EVERY) {
+		zassert_equal(history_ack(app->next_seq), 0);
+		app->acked = app->next_seq;
+		app->since_ack = 0;
+	}
+}
+
+/* Empty history; the flash log's workqueue starts once per boot, so
+ * this runs in the one test
+ */
+static void history_start(void)
+{
+	data_cache_init();
+#if defined(CONFIG_IV_FLASH_LOG)
+	const struct flash_area *fa;
+
+	zassert_equal(flash_area_open(FIXED_PARTITION_ID(history_partition),
+				      &fa), 0);
+	zassert_equal(flash_area_erase(fa, 0, fa->fa_size), 0);
+	zassert_equal(history_init(), 0);
+#endif
+}
+
+ZTEST(sync_resume, test_resume_after_disconnect)
+{
+	static struct sync_stream st;
+	static uint8_t flight[IN_FLIGHT][FRAME_SIZE];
+	uint16_t flight_len[IN_FLIGHT];
+	struct app app = { 0 };
+	uint32_t frames = 0;
+	uint32_t lost = 0;
+
+	history_start();
+
+	for (uint32_t s = 0; s <= SESSIONS; s++) {
+		/* The last sync runs to the end frame */
+		uint32_t cut = s < SESSIONS ? rnd() % CUT_MAX : UINT32_MAX;
+		uint32_t sent = 0;
+		uint32_t done = 0;
+		bool end = false;
+
+		log_samples(rnd() % LOG_MAX);
+		sync_stream_open(&st);
+		zassert_true(sync_stream_seek(&st, app.next_seq),
+			     "cannot resume at %u", app.next_seq);
+
+		/* A frame reaches the app once IN_FLIGHT more are queued
+		 * behind it, or when the stream ends
+		 */
+		while (!end && sent < cut) {
+			uint8_t *f = flight[sent % IN_FLIGHT];
+
+			if (sent - done == IN_FLIGHT) {
+				receive(&app, f, flight_len[done % IN_FLIGHT]);
+				done++;
+			}
+			end = sync_stream_frame(&st, f, FRAME_SIZE,
+						&flight_len[sent % IN_FLIGHT]) == 0;
+			sync_stream_commit(&st);
+			sent++;
+
+			/* Samples logged mid-sync wait for the next one */
+			log_samples(rnd() % 3);
+		}
+		frames += sent;
+
+		if (end) {
+			for (; done < sent; done++) {
+				receive(&app, flight[done % IN_FLIGHT],
+					flight_len[done % IN_FLIGHT]);
+			}
+		} else {
+			/* Link lost: whatever was in flight never arrives */
+			lost += sent - done;
+		}
+
+		/* Exactly the unacknowledged samples are still held */
+		zassert_equal(history_count(), pushed - app.acked,
+			      "session %u: %u held, %u unacknowledged", s,
+			      history_count(), pushed - app.acked);
+	}
+
+	TC_PRINT("%u records in %u frames over %u syncs, %u frames lost\n",
+		 app.records, frames, SESSIONS + 1, lost);
+	zassert_equal(app.records, app.next_seq, "samples skipped or repeated");
+	zassert_true(lost > 0, "no sync was cut off");
+
+	/* A late ack is a no-op; one past the newest sample is refused */
+	zassert_equal(history_ack(app.acked / 2), 0);
+	zassert_equal(history_count(), pushed - app.acked);
+	zassert_equal(history_ack(pushed + 1), -ERANGE);
+}
+
+ZTEST_SUITE(sync_resume, NULL, NULL, NULL, NULL, NULL);
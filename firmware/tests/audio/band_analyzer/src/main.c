@@ -0,0 +1,112 @@
+/*
+ * Octave-band levels of a pure tone, fed in blocks of every length.
+ *
+ * A tone at fs/16 (1 kHz at 16 kHz, 781 Hz at 12.5 kHz) must read at its
+ * RMS level in the 1 kHz band and well below it everywhere else, whether
+ * the blocks are longer than the FFT window or a fraction of it. Short
+ * blocks must add up to one window per CONFIG_IV_BAND_FFT_SIZE samples.
+ */
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+#include "audio/band_analyzer.h"
+#include "audio/sound_level.h"
+
+#define AMPLITUDE  10000
+#define TONE_BAND  4      /* 1 kHz octave */
+#define MAX_BLOCK  1600
+#define FFT_SIZE   CONFIG_IV_BAND_FFT_SIZE
+
+/* 1/16 of a cycle per sample, Q15 */
+static const int16_t sine16[16] = {
+	0, 12540, 23170, 30274, 32767, 30274, 23170, 12540,
+	0, -12540, -23170, -30274, -32767, -30274, -23170, -12540,
+};
+
+static int16_t block[MAX_BLOCK];
+
+static uint32_t feed_tone(size_t block_len, size_t total)
+{
+	uint32_t pos = 0;
+
+	while (pos < total) {
+		size_t n = MIN(block_len, total - pos);
+
+		for (size_t i = 0; i < n; i++) {
+			block[i] = (int16_t)((AMPLITUDE *
+					      sine16[(pos + i) % 16]) >> 15);
+		}
+		band_analyzer_process(block, n);
+		pos += n;
+	}
+	return pos;
+}
+
+static void check_tone(uint32_t rate)
+{
+	static const size_t blocks[] = { MAX_BLOCK, FFT_SIZE, 160, 100,
+					 37, 1 };
+	/* RMS of the sine is amplitude / sqrt(2) */
+	uint8_t expect = sound_level_rms_to_db(AMPLITUDE * 181 / 256);
+
+	for (size_t b = 0; b < ARRAY_SIZE(blocks); b++) {
+		uint8_t levels[BAND_COUNT];
+		size_t len = blocks[b];
+		size_t total = len >= FFT_SIZE ? len * 8 :
+			       FFT_SIZE * 8;
+		uint32_t windows;
+
+		zassert_ok(band_analyzer_init(rate));
+		feed_tone(len, total);
+		windows = band_analyzer_read(levels);
+
+		TC_PRINT("%5u Hz, %4u-sample blocks: %2u windows, "
+			 "%u %u %u %u [%u] %u %u %u dB\n", rate,
+			 (unsigned int)len, windows, levels[0], levels[1],
+			 levels[2], levels[3], levels[4], levels[5], levels[6],
+			 levels[7]);
+
+		/* One window per block, or per window's worth of samples */
+		zassert_equal(windows, 8, "%u-sample blocks: %u windows",
+			      (unsigned int)len, windows);
+		zassert_within(levels[TONE_BAND], expect, 1,
+			       "%u-sample blocks: %u dB, expected %u",
+			       (unsigned int)len, levels[TONE_BAND], expect);
+		for (size_t i = 0; i < BAND_COUNT; i++) {
+			if (i != TONE_BAND) {
+				zassert_true(levels[i] + 20 <= expect,
+					     "band %u at %u dB",
+					     (unsigned int)i, levels[i]);
+			}
+		}
+	}
+}
+
+ZTEST(band_analyzer, test_tone_16k)
+{
+	check_tone(16000);
+}
+
+ZTEST(band_analyzer, test_tone_12k5)
+{
+	check_tone(12500);
+}
+
+ZTEST(band_analyzer, test_read_resets)
+{
+	uint8_t levels[BAND_COUNT];
+
+	zassert_ok(band_analyzer_init(16000));
+
+	/* A partial window is carried over, not averaged */
+	feed_tone(100, FFT_SIZE - 1);
+	zassert_equal(band_analyzer_read(levels), 0);
+	zassert_equal(levels[TONE_BAND], 0);
+	feed_tone(1, 1);
+	zassert_equal(band_analyzer_read(levels), 1);
+	zassert_equal(band_analyzer_read(levels), 0);
+
+	zassert_equal(band_analyzer_init(44100), -ENOTSUP);
+}
+
+ZTEST_SUITE(band_analyzer, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,165 @@
+/*
+ * Sum-of-squares kernels against the scalar reference.
+ *
+ * Every kernel the target builds (scalar, SMLALD, CMSIS-DSP
+ * arm_power_q15) runs on the same buffers: full-scale noise, the
+ * extremes, every short length and a halfword-aligned start. The cost
+ * of a 100 ms block is printed per kernel in timing counter cycles (the
+ * system timer on the nRF52840 ticks at 32 kHz, far too coarse); on
+ * hardware with the DSP extension, SMLALD must beat the scalar loop.
+ */
+#include <zephyr/kernel.h>
+#include <zephyr/timing/timing.h>
+#include <zephyr/ztest.h>
+
+#include "audio/sound_level.h"
+
+#define BLOCK   1600  /* 100 ms at 16 kHz */
+#define RUNS    9
+
+struct kernel {
+	const char *name;
+	uint64_t (*sum_sq)(const int16_t *samples, size_t count);
+};
+
+static const struct kernel kernels[] = {
+	{ "configured", sound_level_sum_sq },
+#if defined(__ARM_FEATURE_DSP)
+	{ "smlald", sound_level_sum_sq_dsp },
+#endif
+#if defined(CONFIG_CMSIS_DSP_STATISTICS)
+	{ "cmsis", sound_level_sum_sq_cmsis },
+#endif
+};
+
+/* One spare sample so a block can start halfword-aligned */
+static int16_t buf[BLOCK + 1] __aligned(4);
+
+static void fill_noise(uint32_t seed)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(buf); i++) {
+		seed = seed * 1103515245U + 12345U;
+		buf[i] = (int16_t)(seed >> 16);
+	}
+}
+
+static void fill_const(int16_t v)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(buf); i++) {
+		buf[i] = v;
+	}
+}
+
+static void check_all(const char *what)
+{
+	static const size_t lens[] = { BLOCK, BLOCK - 1, 255, 64, 33 };
+
+	for (size_t k = 0; k < ARRAY_SIZE(kernels); k++) {
+		for (size_t off = 0; off < 2; off++) {
+			for (size_t n = 0; n <= 17; n++) {
+				zassert_equal(kernels[k].sum_sq(&buf[off], n),
+					      sound_level_sum_sq_ref(&buf[off], n),
+					      "%s: %s, offset %u, %u samples",
+					      kernels[k].name, what,
+					      (unsigned int)off, (unsigned int)n);
+			}
+			for (size_t i = 0; i < ARRAY_SIZE(lens); i++) {
+				size_t n = lens[i];
+
+				zassert_equal(kernels[k].sum_sq(&buf[off], n),
+					      sound_level_sum_sq_ref(&buf[off], n),
+					      "%s: %s, offset %u, %u samples",
+					      kernels[k].name, what,
+					      (unsigned int)off, (unsigned int)n);
+			}
+		}
+	}
+}
+
+ZTEST(sound_level, test_kernels_match_reference)
+{
+	for (uint32_t seed = 1; seed <= 8; seed++) {
+		fill_noise(seed);
+		check_all("noise");
+	}
+
+	fill_const(INT16_MIN);
+	check_all("-32768");
+	fill_const(INT16_MAX);
+	check_all("32767");
+	fill_const(0);
+	check_all("silence");
+
+	for (size_t i = 0; i < ARRAY_SIZE(buf); i++) {
+		buf[i] = i % 2 ? INT16_MIN : INT16_MAX;
+	}
+	check_all("alternating");
+}
+
+ZTEST(sound_level, test_reference_values)
+{
+	fill_const(INT16_MIN);
+	zassert_equal(sound_level_sum_sq_ref(buf, BLOCK),
+		      (uint64_t)BLOCK << 30);
+
+	fill_const(-1000);
+	zassert_equal(sound_level_rms(buf, BLOCK), 1000);
+
+	for (size_t i = 0; i < ARRAY_SIZE(buf); i++) {
+		buf[i] = i % 2 ? -8000 : 8000;
+	}
+	zassert_equal(sound_level_rms(buf, BLOCK), 8000);
+	zassert_equal(sound_level_rms(buf, 0), 0);
+}
+
+static uint64_t block_cycles(const struct kernel *k)
+{
+	uint64_t best = UINT64_MAX;
+
+	for (int r = 0; r < RUNS; r++) {
+		timing_t t0 = timing_counter_get();
+		volatile uint64_t sum = k->sum_sq(buf, BLOCK);
+		timing_t t1 = timing_counter_get();
+
+		ARG_UNUSED(sum);
+		best = MIN(best, timing_cycles_get(&t0, &t1));
+	}
+	return best;
+}
+
+static void print_cycles(const char *name, uint64_t cyc)
+{
+	TC_PRINT("%-10s %8u cycles, %7u ns per %u-sample block\n", name,
+		 (uint32_t)cyc, (uint32_t)timing_cycles_to_ns(cyc), BLOCK);
+}
+
+ZTEST(sound_level, test_cycles_per_block)
+{
+	static const struct kernel ref = { "scalar", sound_level_sum_sq_ref };
+	uint64_t ref_cyc;
+
+	timing_init();
+	timing_start();
+	TC_PRINT("timing counter at %u MHz\n", timing_freq_get_mhz());
+
+	fill_noise(7);
+	ref_cyc = block_cycles(&ref);
+	print_cycles(ref.name, ref_cyc);
+
+	for (size_t k = 0; k < ARRAY_SIZE(kernels); k++) {
+		print_cycles(kernels[k].name, block_cycles(&kernels[k]));
+	}
+
+	/* Emulators do not model the pipeline, so only hardware is held
+	 * to the speed-up
+	 */
+#if defined(__ARM_FEATURE_DSP) && !defined(CONFIG_QEMU_TARGET)
+	uint64_t dsp_cyc = block_cycles(&kernels[1]);
+
+	zassert_true(dsp_cyc < ref_cyc, "SMLALD %u cycles, scalar %u",
+		     (uint32_t)dsp_cyc, (uint32_t)ref_cyc);
+#endif
+	timing_stop();
+}
+
+ZTEST_SUITE(sound_level, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,129 @@
+/*
+ * A- and C-weighting cost per 100 ms block, against the block period.
+ *
+ * Each curve filters a full block of noise at every rate it has
+ * coefficients for, best of RUNS, timed with the timing counter. At
+ * 64 MHz (the nRF52840 core clock) a block lasts 6.4 M cycles, and the
+ * cascade must take no more than a tenth of that. QEMU does not model
+ * the core's timing, so there the cost is only printed. A 1 kHz tone
+ * must also pass at its level, as both curves are 0 dB there.
+ */
+#include <zephyr/kernel.h>
+#include <zephyr/timing/timing.h>
+#include <zephyr/ztest.h>
+
+#include "audio/sound_level.h"
+#include "audio/weighting.h"
+
+#define RUNS          9
+#define MAX_BLOCK     1600     /* 100 ms at 16 kHz */
+#define CPU_MHZ       64
+#define BUDGET_CYC    (CPU_MHZ * 100000 / 10)  /* A tenth of 100 ms */
+#define AMPLITUDE     10000
+
+/* 1/16 of a cycle per sample, Q15 */
+static const int16_t sine16[16] = {
+	0, 12540, 23170, 30274, 32767, 30274, 23170, 12540,
+	0, -12540, -23170, -30274, -32767, -30274, -23170, -12540,
+};
+
+static int16_t block[MAX_BLOCK];
+
+static void fill_noise(uint32_t seed, size_t n)
+{
+	for (size_t i = 0; i < n; i++) {
+		seed = seed * 1103515245U + 12345U;
+		block[i] = (int16_t)(seed >> 16);
+	}
+}
+
+/* CPU cycles at CPU_MHZ for the best of RUNS blocks */
+static uint32_t block_cycles(enum weighting_curve curve, uint32_t rate)
+{
+	struct weighting_filter f;
+	size_t n = rate / 10;
+	uint64_t best = UINT64_MAX;
+
+	zassert_ok(weighting_init(&f, curve, rate));
+	for (int r = 0; r < RUNS; r++) {
+		fill_noise(r + 1, n);
+
+		timing_t t0 = timing_counter_get();
+
+		weighting_process(&f, block, n);
+
+		timing_t t1 = timing_counter_get();
+
+		best = MIN(best, timing_cycles_get(&t0, &t1));
+	}
+	return (uint32_t)(timing_cycles_to_ns(best) * CPU_MHZ / 1000);
+}
+
+ZTEST(weighting, test_block_budget)
+{
+	static const struct {
+		enum weighting_curve curve;
+		const char *name;
+	} curves[] = {
+		{ WEIGHTING_A, "A" },
+		{ WEIGHTING_C, "C" },
+	};
+	static const uint32_t rates[] = { 16000, 12500 };
+
+	timing_init();
+	timing_start();
+
+	for (size_t c = 0; c < ARRAY_SIZE(curves); c++) {
+		for (size_t r = 0; r < ARRAY_SIZE(rates); r++) {
+			uint32_t cyc = block_cycles(curves[c].curve, rates[r]);
+
+			TC_PRINT("%s %5u Hz: %7u cycles at %u MHz per block, "
+				 "%u.%02u%% of the block\n", curves[c].name,
+				 rates[r], cyc, CPU_MHZ,
+				 cyc / (CPU_MHZ * 1000),
+				 cyc % (CPU_MHZ * 1000) / (CPU_MHZ * 10));
+#if !defined(CONFIG_QEMU_TARGET)
+			zassert_true(cyc <= BUDGET_CYC,
+				     "%s at %u Hz: %u cycles, budget %u",
+				     curves[c].name, rates[r], cyc,
+				     BUDGET_CYC);
+#endif
+		}
+	}
+
+	timing_stop();
+}
+
+ZTEST(weighting, test_1khz_unity)
+{
+	static const enum weighting_curve curves[] = { WEIGHTING_A,
+						       WEIGHTING_C };
+	uint8_t expect;
+
+	for (size_t i = 0; i < MAX_BLOCK; i++) {
+		block[i] = (int16_t)((AMPLITUDE * sine16[i % 16]) >> 15);
+	}
+	expect = sound_level_rms_to_db(sound_level_rms(block, MAX_BLOCK));
+
+	for (size_t c = 0; c < ARRAY_SIZE(curves); c++) {
+		struct weighting_filter f;
+		uint8_t db = 0;
+
+		zassert_ok(weighting_init(&f, curves[c], 16000));
+
+		/* Past the 20 Hz poles' settling */
+		for (int b = 0; b < 5; b++) {
+			for (size_t i = 0; i < MAX_BLOCK; i++) {
+				block[i] = (int16_t)((AMPLITUDE *
+						      sine16[i % 16]) >> 15);
+			}
+			weighting_process(&f, block, MAX_BLOCK);
+			db = sound_level_rms_to_db(sound_level_rms(block,
+								   MAX_BLOCK));
+		}
+		zassert_within(db, expect, 1, "curve %d: %u dB, expected %u",
+			       curves[c], db, expect);
+	}
+}
+
+ZTEST_SUITE(weighting, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,175 @@
+/*
+ * Cycle budgets for the hot paths, with a machine-readable report.
+ *
+ * Each case calls its function CALLS times between two reads of the
+ * timing counter, best of RUNS, and converts the cost per call to
+ * cycles at 64 MHz (the nRF52840 core clock). The budgets below were
+ * recorded for the XIAO with margin; a case over its budget fails. QEMU
+ * does not model the core's timing, so there the cost is only reported.
+ *
+ * Every case prints one line for scripts to collect from the twister
+ * log (handler.log) or the CTest output:
+ *
+ *   IV_BENCH {"case":"data_cache_push","cycles":41,"budget":300}
+ *
+ * tools/bench (iv_bench) still counts host instructions for the same
+ * paths; this suite is the one that runs on the targets.
+ */
+#include <zephyr/kernel.h>
+#include <zephyr/timing/timing.h>
+#include <zephyr/ztest.h>
+
+#include "app/config.h"
+#include "app/data_cache.h"
+#include "audio/sound_level.h"
+
+#define RUNS      5
+#define CPU_MHZ   64
+#define BLOCK     1600     /* 100 ms at 16 kHz */
+
+struct bench_case {
+	const char *name;
+	void (*setup)(void);
+	void (*run)(void);
+	uint32_t calls;
+	uint32_t budget;   /* Cycles per call at CPU_MHZ */
+};
+
+static int16_t pcm[BLOCK];
+static volatile uint32_t sink;
+static uint32_t idx;
+static uint32_t held;
+static uint16_t rms_in;
+
+static void setup_pcm(void)
+{
+	uint32_t seed = 12345;
+
+	for (int i = 0; i < BLOCK; i++) {
+		seed = seed * 1103515245U + 12345U;
+		pcm[i] = (int16_t)(seed >> 16) / 4;
+	}
+}
+
+static void run_rms(void)
+{
+	sink += sound_level_rms(pcm, BLOCK);
+}
+
+static void setup_rms_to_db(void)
+{
+	rms_in = 0;
+}
+
+static void run_rms_to_db(void)
+{
+	sink += sound_level_rms_to_db(rms_in);
+	rms_in += 97;
+}
+
+/* Pushes here come faster than the 1 s cadence, so each one opens a
+ * segment: the push budget covers that slower path too, and the cache
+ * holds only as many samples as it has segments
+ */
+static void setup_cache(void)
+{
+	data_cache_init();
+	for (uint32_t i = 0; i < CACHE_MAX_SAMPLES; i++) {
+		data_cache_push((uint8_t)i);
+	}
+	held = data_cache_count();
+	idx = 0;
+}
+
+static void run_cache_push(void)
+{
+	data_cache_push((uint8_t)sink++);
+}
+
+static void run_cache_get(void)
+{
+	struct iv_sample s;
+
+	data_cache_get(idx, &s);
+	idx = (idx + 1) % held;
+	sink += s.db;
+}
+
+/* The 5-byte record a sync frame carries per sample */
+static void run_cache_pack(void)
+{
+	struct iv_sample s = { .uptime_ms = 0x12345678U + sink, .db = 70 };
+	uint8_t rec[IV_SAMPLE_RECORD_SIZE];
+
+	data_cache_pack(&s, rec);
+	sink += rec[0] + rec[4];
+}
+
+static void run_config_get(void)
+{
+	sink += app_config_get().threshold_db;
+}
+
+static const struct bench_case cases[] = {
+	{ "sound_level_rms", setup_pcm, run_rms, 4, 16000 },
+	{ "sound_level_rms_to_db", setup_rms_to_db, run_rms_to_db, 256, 400 },
+	{ "data_cache_push", setup_cache, run_cache_push, 256, 300 },
+	{ "data_cache_get", setup_cache, run_cache_get, 256, 400 },
+	{ "data_cache_pack", NULL, run_cache_pack, 256, 150 },
+	{ "app_config_get", NULL, run_config_get, 256, 600 },
+};
+
+/* Cycles per call at CPU_MHZ, best of RUNS batches */
+static uint32_t measure(const struct bench_case *c)
+{
+	uint64_t best = UINT64_MAX;
+
+	for (int r = 0; r < RUNS; r++) {
+		if (c->setup) {
+			c->setup();
+		}
+
+		timing_t t0 = timing_counter_get();
+
+		for (uint32_t i = 0; i < c->calls; i++) {
+			c->run();
+		}
+
+		timing_t t1 = timing_counter_get();
+
+		best = MIN(best, timing_cycles_get(&t0, &t1));
+	}
+	return (uint32_t)(timing_cycles_to_ns(best) * CPU_MHZ / 1000 /
+			  c->calls);
+}
+
+ZTEST(benchmarks, test_budgets)
+{
+	uint32_t over = 0;
+
+	timing_init();
+	timing_start();
+
+	for (size_t i = 0; i < ARRAY_SIZE(cases); i++) {
+		uint32_t cyc = measure(&cases[i]);
+
+		TC_PRINT("IV_BENCH {\"case\":\"%s\",\"cycles\":%u,"
+			 "\"budget\":%u}\n", cases[i].name, cyc,
+			 cases[i].budget);
+		if (cyc > cases[i].budget) {
+			TC_PRINT("%s: %u cycles, budget %u\n", cases[i].name,
+				 cyc, cases[i].budget);
+			over++;
+		}
+	}
+
+	timing_stop();
+
+#if !defined(CONFIG_QEMU_TARGET)
+	zassert_equal(over, 0, "%u cases over budget", over);
+#else
+	ARG_UNUSED(over);
+#endif
+}
+
+ZTEST_SUITE(benchmarks, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,1129 @@
+/*
+ * Host micro-benchmarks for the InsideVoice hot paths.
+ *
+ * Times each function over repeated batches and counts the user-space
+ * instructions it retires, then compares the count per call against
+ * budgets.txt. Instruction counts are stable across machines for a given
+ * compiler. They come from the hardware counter when the kernel exposes
+ * one, and otherwise from single-stepping the calls under ptrace in a
+ * forked child. Without either, the run fails unless -t asks for the
+ * nanosecond budgets instead. Exits non-zero when any case is over
+ * budget, so regressions fail the build that causes them. Cycle costs on
+ * the device come from the CONFIG_IV_PROFILER stage profile.
+ *
+ * The lock-free cache is also timed against the mutex cache it replaced
+ * (mutex_cache.c), and each pair is printed side by side; a lock-free
+ * case that is not cheaper than its baseline fails the run.
+ *
+ * A final check pushes from a second thread while the main thread reads
+ * cache snapshots, and fails if a reader ever sees a sample that does
+ * not match its timestamp. Another runs framed syncs that lose the link
+ * part way, and fails unless every sample arrives exactly once and only
+ * acknowledged samples are dropped. Last, an 8000-sample history is
+ * built into GATT notifications and L2CAP SDUs and played through a
+ * link-layer airtime model, to compare the sync paths.
+ *
+ * Usage: iv_bench [-b budgets.txt] [-t [-s <scale>]] [-j report.json] [-r]
+ */
+
+#include "app/analysis.h"
+#include "app/config.h"
+#include "app/data_cache.h"
+#include "app/level_stats.h"
+#include "app/rollup.h"
+#include "app/sync_stream.h"
+#include "audio/sound_level.h"
+#include "audio/vad.h"
+#include "audio/weighting.h"
+#include "mutex_cache.h"
+
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <zephyr/kernel.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <signal.h>
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#endif
+
+#ifndef IV_BENCH_BUDGETS
+#define IV_BENCH_BUDGETS "budgets.txt"
+#endif
+
+#define BENCH_RATE       16000
+#define BENCH_BLOCK      1600  /* 100 ms, the default PDM block */
+#define BENCH_BATCHES    21
+#define BENCH_BATCH_NS   2000000
+#define BENCH_SYNC       256   /* Samples per sync case call */
+#define BENCH_SYNC_BATCH 16    /* As the BLE sync work reads them */
+#define BENCH_THRESHOLD  70
+#define BENCH_FRAME_SIZE 244   /* Sync frame at a 247-byte ATT MTU */
+
+/* Headroom written by --record over the measured medians */
+#define RECORD_NS_PCT    150
+#define RECORD_INSN_PCT  110
+#define RECORD_NS_SLACK  5     /* Timer noise on the shortest cases */
+
+/* Cases under this many instructions are stepped over several calls */
+#define STEP_SHORT_INSN  1000
+#define STEP_SHORT_CALLS 64
+
+struct bench_case {
+	const char *name;
+	void (*setup)(void);
+	void (*run)(void);
+
+	/* For a baseline, the case it is compared against, which must cost
+	 * less; recorded with no budget
+	 */
+	const char *baseline_of;
+
+	/* Measured medians per call */
+	double ns;
+	double insn;
+
+	/* Budgets per call, 0 when unset */
+	double budget_ns;
+	double budget_insn;
+	bool   pass;
+};
+
+/* --- Simulated uptime (see ../shim/zephyr/kernel.h) --- */
+
+static int64_t clock_ms;
+
+/* One cache interval per call keeps data_cache_push on its cadence */
+int64_t k_uptime_get(void)
+{
+	clock_ms += CACHE_INTERVAL_MS;
+	return clock_ms;
+}
+
+/* --- Cases --- */
+
+static int16_t pcm[BENCH_BLOCK];
+static int16_t work[BENCH_BLOCK];
+static volatile uint32_t sink;
+
+static struct weighting_filter wfilt;
+static struct vad_state vad;
+static struct analysis an;
+static uint32_t cache_idx;
+static uint16_t rms_in;
+
+/* Deterministic voice-like input: two harmonics plus LCG noise */
+static void fill_pcm(void)
+{
+	uint32_t lcg = 12345;
+
+	for (int i = 0; i < BENCH_BLOCK; i++) {
+		int32_t tri = (i % 80) < 40 ? (i % 40) * 400 - 8000 :
+					      8000 - (i % 40) * 400;
+		int32_t sq = (i % 23) < 11 ? 1500 : -1500;
+
+		lcg = lcg * 1103515245U + 12345U;
+		pcm[i] = (int16_t)(tri + sq + (int32_t)((lcg >> 16) & 0x7FF) -
+				   0x400);
+	}
+}
+
+static void setup_none(void)
+{
+}
+
+static void run_rms(void)
+{
+	sink += sound_level_rms(pcm, BENCH_BLOCK);
+}
+
+static void setup_rms_to_db(void)
+{
+	rms_in = 0;
+}
+
+static void run_rms_to_db(void)
+{
+	sink += sound_level_rms_to_db(rms_in);
+	rms_in += 97;
+}
+
+static void setup_cache(void)
+{
+	data_cache_init();
+	for (uint32_t i = 0; i < CACHE_MAX_SAMPLES; i++) {
+		data_cache_push((uint8_t)i);
+	}
+	cache_idx = 0;
+}
+
+static void run_cache_push(void)
+{
+	data_cache_push((uint8_t)sink++);
+}
+
+static void run_cache_get(void)
+{
+	struct iv_sample s;
+
+	data_cache_get(cache_idx, &s);
+	cache_idx = (cache_idx + 1) % (CACHE_MAX_SAMPLES - 1);
+	sink += s.db;
+}
+
+/* A sync's worth of samples one at a time, as before data_cache_read */
+static void run_sync_get(void)
+{
+	struct iv_sample s;
+
+	for (uint32_t i = 0; i < BENCH_SYNC; i++) {
+		data_cache_get(cache_idx + i, &s);
+		sink += s.db;
+	}
+	cache_idx = (cache_idx + BENCH_SYNC) % (CACHE_MAX_SAMPLES - BENCH_SYNC);
+}
+
+static void run_sync_read(void)
+{
+	struct iv_sample buf[BENCH_SYNC_BATCH];
+	struct iv_cursor cur;
+
+	data_cache_snapshot(&cur);
+	for (uint32_t i = 0; i < BENCH_SYNC; i += BENCH_SYNC_BATCH) {
+		int n = data_cache_read(&cur, cache_idx + i, buf,
+					BENCH_SYNC_BATCH);
+
+		sink += n > 0 ? buf[n - 1].db : 0;
+	}
+	cache_idx = (cache_idx + BENCH_SYNC) % (CACHE_MAX_SAMPLES - BENCH_SYNC);
+}
+
+/* The same samples as sync frames, as the framed BLE sync builds them */
+static void run_sync_stream(void)
+{
+	static struct sync_stream st;
+	uint8_t frame[BENCH_FRAME_SIZE];
+	uint16_t len;
+
+	sync_stream_open(&st);
+	sync_stream_seek(&st, st.cur.start + cache_idx);
+	for (uint32_t i = 0; i < BENCH_SYNC;) {
+		i += sync_stream_frame(&st, frame, MIN(sizeof(frame),
+			SYNC_FRAME_HDR_SIZE + (BENCH_SYNC - i) *
+			IV_SAMPLE_RECORD_SIZE), &len);
+		sync_stream_commit(&st);
+		sink += frame[len - 1];
+	}
+	cache_idx = (cache_idx + BENCH_SYNC) % (CACHE_MAX_SAMPLES - BENCH_SYNC);
+}
+
+static void setup_rollup(void)
+{
+	rollup_init();
+}
+
+/* The monitor thread's call after each cache sample */
+static void run_rollup_push(void)
+{
+	uint8_t db = (uint8_t)(40 + sink++ % 45);
+
+	rollup_push(k_uptime_get(), db, db >= BENCH_THRESHOLD);
+}
+
+/* The same three on the mutex cache the lock-free one replaced */
+static void setup_mutex_cache(void)
+{
+	mutex_cache_init();
+	for (uint32_t i = 0; i < CACHE_MAX_SAMPLES; i++) {
+		mutex_cache_push((uint8_t)i);
+	}
+	cache_idx = 0;
+}
+
+static void run_mutex_push(void)
+{
+	mutex_cache_push((uint8_t)sink++);
+}
+
+static void run_mutex_get(void)
+{
+	struct iv_sample s;
+
+	mutex_cache_get(cache_idx, &s);
+	cache_idx = (cache_idx + 1) % (CACHE_MAX_SAMPLES - 1);
+	sink += s.db;
+}
+
+static void run_mutex_sync_get(void)
+{
+	struct iv_sample s;
+
+	for (uint32_t i = 0; i < BENCH_SYNC; i++) {
+		mutex_cache_get(cache_idx + i, &s);
+		sink += s.db;
+	}
+	cache_idx = (cache_idx + BENCH_SYNC) % (CACHE_MAX_SAMPLES - BENCH_SYNC);
+}
+
+static void setup_level_stats(void)
+{
+	level_stats_reset();
+	for (uint32_t i = 0; i < 36000; i++) {
+		level_stats_update((uint8_t)(40 + i % 45), 100,
+				   LEVEL_DET_EVENT_NONE);
+	}
+}
+
+static void run_level_stats_update(void)
+{
+	level_stats_update((uint8_t)(40 + sink++ % 45), 100,
+			   LEVEL_DET_EVENT_NONE);
+}
+
+static void run_level_stats_get(void)
+{
+	struct level_stats st;
+
+	level_stats_get(&st);
+	sink += st.leq_ddb;
+}
+
+static void run_cache_pack(void)
+{
+	struct iv_sample s = { .uptime_ms = 0x12345678U + sink, .db = 70 };
+	uint8_t rec[IV_SAMPLE_RECORD_SIZE];
+
+	data_cache_pack(&s, rec);
+	sink += rec[0] + rec[4];
+}
+
+static void run_config_get(void)
+{
+	sink += app_config_get().threshold_db;
+}
+
+static void setup_weighting(void)
+{
+	weighting_init(&wfilt, WEIGHTING_A, BENCH_RATE);
+}
+
+static void run_weighting(void)
+{
+	memcpy(work, pcm, sizeof(work));
+	weighting_process(&wfilt, work, BENCH_BLOCK);
+	sink += work[BENCH_BLOCK - 1];
+}
+
+static void setup_vad(void)
+{
+	struct vad_cfg cfg = {
+		.sample_rate = BENCH_RATE,
+		.margin_db = 6,
+		.hangover_ms = 300,
+	};
+
+	vad_init(&vad, &cfg);
+}
+
+static void run_vad(void)
+{
+	struct vad_result res;
+
+	vad_process(&vad, pcm, BENCH_BLOCK, &res);
+	sink += res.db;
+}
+
+static void setup_analysis(void)
+{
+	struct analysis_cfg cfg = {
+		.sample_rate = BENCH_RATE,
+		.subframe_ms = 100,
+		.window_ms = 100,
+		.attack_ms = 300,
+		.release_ms = 300,
+		.vad = true,
+		.vad_margin_db = 6,
+		.vad_hangover_ms = 300,
+		.notify_interval_ms = 100,
+		.cache_interval_ms = 1000,
+	};
+
+	analysis_init(&an, &cfg);
+}
+
+static void run_analysis(void)
+{
+	struct analysis_result res;
+
+	memcpy(work, pcm, sizeof(work));
+	analysis_process(&an, work, BENCH_BLOCK, 0, BENCH_THRESHOLD,
+			 WEIGHTING_A, &res);
+	sink += res.level.block_db;
+}
+
+#define BENCH_CASE(_name, _setup, _run) \
+	{ .name = _name, .setup = _setup, .run = _run }
+#define BENCH_BASELINE(_name, _of, _setup, _run) \
+	{ .name = _name, .baseline_of = _of, .setup = _setup, .run = _run }
+
+static struct bench_case cases[] = {
+	BENCH_CASE("sound_level_rms",       setup_none,      run_rms),
+	BENCH_CASE("sound_level_rms_to_db", setup_rms_to_db, run_rms_to_db),
+	BENCH_CASE("data_cache_push",       setup_cache,     run_cache_push),
+	BENCH_CASE("data_cache_get",        setup_cache,     run_cache_get),
+	BENCH_CASE("sync_get_x256",         setup_cache,     run_sync_get),
+	BENCH_CASE("sync_read_x256",        setup_cache,     run_sync_read),
+	BENCH_CASE("sync_stream_x256",      setup_cache,     run_sync_stream),
+	BENCH_BASELINE("mutex_cache_push", "data_cache_push",
+		       setup_mutex_cache, run_mutex_push),
+	BENCH_BASELINE("mutex_cache_get", "data_cache_get",
+		       setup_mutex_cache, run_mutex_get),
+	BENCH_BASELINE("mutex_sync_get_x256", "sync_get_x256",
+		       setup_mutex_cache, run_mutex_sync_get),
+	BENCH_CASE("rollup_push",           setup_rollup,    run_rollup_push),
+	BENCH_CASE("data_cache_pack",       setup_none,      run_cache_pack),
+	BENCH_CASE("level_stats_update",    setup_level_stats, run_level_stats_update),
+	BENCH_CASE("level_stats_get",       setup_level_stats, run_level_stats_get),
+	BENCH_CASE("app_config_get",        setup_none,      run_config_get),
+	BENCH_CASE("weighting_process",     setup_weighting, run_weighting),
+	BENCH_CASE("vad_process",           setup_vad,       run_vad),
+	BENCH_CASE("analysis_process",      setup_analysis,  run_analysis),
+};
+
+/* --- Measurement --- */
+
+enum insn_counter {
+	INSN_NONE,
+	INSN_PERF,  /* Hardware counter */
+	INSN_STEP,  /* ptrace single-step from the parent process */
+};
+
+static const char *const counter_names[] = {
+	[INSN_NONE] = "none",
+	[INSN_PERF] = "perf",
+	[INSN_STEP] = "ptrace",
+};
+
+static enum insn_counter counter;
+static int insn_fd = -1;
+
+static void insn_open(void)
+{
+#if defined(__linux__)
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	insn_fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+	if (insn_fd >= 0) {
+		counter = INSN_PERF;
+	}
+#endif
+}
+
+/*
+ * Single-step counting. The benchmark runs in a child traced by the
+ * original process. The child raises SIGUSR1 before the calls to count
+ * and SIGUSR2 after them. The parent single-steps everything in between
+ * and stores the number of steps in the child's step_count. That is one
+ * step per user-space instruction, with a system call as one step. The
+ * markers' own steps are measured around no calls and subtracted.
+ */
+
+/* Exit status of a child that could not be traced */
+#define STEP_UNTRACEABLE 125
+
+static volatile uint64_t step_count;
+static uint64_t step_base;
+
+#if defined(__linux__)
+/* Runs in the parent until the child exits; returns its exit status */
+static int step_trace(pid_t pid)
+{
+	bool stepping = false;
+	uint64_t steps = 0;
+	int st;
+
+	for (;;) {
+		if (waitpid(pid, &st, 0) < 0) {
+			return 2;
+		}
+		if (WIFEXITED(st)) {
+			return WEXITSTATUS(st);
+		}
+		if (WIFSIGNALED(st)) {
+			return 2;
+		}
+
+		int sig = WSTOPSIG(st);
+		long req = stepping ? PTRACE_SINGLESTEP : PTRACE_CONT;
+
+		if (stepping && sig == SIGTRAP) {
+			steps++;
+			sig = 0;
+		} else if (sig == SIGUSR1) {
+			stepping = true;
+			steps = 0;
+			req = PTRACE_SINGLESTEP;
+			sig = 0;
+		} else if (sig == SIGUSR2 && stepping) {
+			stepping = false;
+			ptrace(PTRACE_POKEDATA, pid, (void *)&step_count,
+			       (void *)(uintptr_t)steps);
+			req = PTRACE_CONT;
+			sig = 0;
+		} else if (sig == SIGSTOP) {
+			sig = 0;
+		}
+
+		if (ptrace(req, pid, NULL, (void *)(uintptr_t)sig) < 0) {
+			return 2;
+		}
+	}
+}
+#endif
+
+/*
+ * Fork the benchmark into a traced child. Returns in the child, or in
+ * the original process if tracing is unavailable; otherwise the original
+ * process exits with the child's status.
+ */
+static void step_open(void)
+{
+#if defined(__linux__)
+	fflush(NULL);
+
+	pid_t pid = fork();
+
+	if (pid < 0) {
+		return;
+	}
+	if (pid == 0) {
+		if (ptrace(PTRACE_TRACEME, 0, NULL, NULL) < 0) {
+			_exit(STEP_UNTRACEABLE);
+		}
+		raise(SIGSTOP);
+		counter = INSN_STEP;
+		return;
+	}
+
+	int status = step_trace(pid);
+
+	if (status != STEP_UNTRACEABLE) {
+		exit(status);
+	}
+#endif
+}
+
+static uint64_t step_calls(const struct bench_case *c, uint32_t calls)
+{
+#if defined(__linux__)
+	raise(SIGUSR1);
+	for (uint32_t i = 0; i < calls; i++) {
+		c->run();
+	}
+	raise(SIGUSR2);
+#endif
+	return step_count;
+}
+
+static void step_calibrate(void)
+{
+	step_base = step_calls(&cases[0], 0);
+}
+
+/*
+ * Counted from the case's initial state, so the count does not depend
+ * on how many calls timing made. Short cases depend on their inputs and
+ * are averaged over a run of calls.
+ */
+static double step_measure(const struct bench_case *c)
+{
+	uint32_t calls = 1;
+	uint64_t steps;
+
+	sink = 0;
+	c->setup();
+	steps = step_calls(c, calls);
+	if (steps < step_base + STEP_SHORT_INSN) {
+		calls = STEP_SHORT_CALLS;
+		sink = 0;
+		c->setup();
+		steps = step_calls(c, calls);
+	}
+	return steps > step_base ? (double)(steps - step_base) / calls : 0;
+}
+
+static uint64_t insn_read(void)
+{
+	uint64_t v = 0;
+
+	if (insn_fd >= 0 && read(insn_fd, &v, sizeof(v)) != sizeof(v)) {
+		v = 0;
+	}
+	return v;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void measure(struct bench_case *c)
+{
+	double ns[BENCH_BATCHES];
+	double insn[BENCH_BATCHES];
+	uint32_t iters = 1;
+
+	c->setup();
+
+	/* Grow the batch until it is long enough to time reliably */
+	for (;;) {
+		uint64_t t0 = now_ns();
+
+		for (uint32_t i = 0; i < iters; i++) {
+			c->run();
+		}
+		if (now_ns() - t0 >= BENCH_BATCH_NS / 4 || iters >= (1U << 24)) {
+			break;
+		}
+		iters *= 2;
+	}
+
+	for (int b = 0; b < BENCH_BATCHES; b++) {
+		uint64_t i0 = insn_read();
+		uint64_t t0 = now_ns();
+
+		for (uint32_t i = 0; i < iters; i++) {
+			c->run();
+		}
+
+		uint64_t t1 = now_ns();
+		uint64_t i1 = insn_read();
+
+		ns[b] = (double)(t1 - t0) / iters;
+		insn[b] = (double)(i1 - i0) / iters;
+	}
+
+	qsort(ns, BENCH_BATCHES, sizeof(ns[0]), cmp_double);
+	qsort(insn, BENCH_BATCHES, sizeof(insn[0]), cmp_double);
+	c->ns = ns[BENCH_BATCHES / 2];
+	c->insn = counter == INSN_PERF ? insn[BENCH_BATCHES / 2] :
+		  counter == INSN_STEP ? step_measure(c) : 0;
+}
+
+/* --- Concurrent cache readers --- */
+
+#define RACE_PUSHES    (64U * CACHE_MAX_SAMPLES)
+#define RACE_GAP_EVERY 97  /* Start a new segment this often */
+
+static bool race_done;
+
+/* The dB byte a sample must carry for its timestamp */
+static uint8_t race_db(uint32_t uptime_ms)
+{
+	return (uint8_t)(uptime_ms / CACHE_INTERVAL_MS * 131U);
+}
+
+static void *race_producer(void *arg)
+{
+	for (uint32_t i = 0; i < RACE_PUSHES; i++) {
+		if (i % RACE_GAP_EVERY == 0) {
+			clock_ms += 5 * CACHE_INTERVAL_MS;
+		}
+		data_cache_push(race_db((uint32_t)(clock_ms + CACHE_INTERVAL_MS)));
+	}
+	__atomic_store_n(&race_done, true, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+static int cache_race_check(void)
+{
+	struct iv_sample buf[BENCH_SYNC_BATCH];
+	uint64_t checked = 0;
+	uint64_t lost = 0;
+	uint64_t bad = 0;
+	uint32_t rounds = 0;
+	pthread_t producer;
+
+	data_cache_init();
+	if (pthread_create(&producer, NULL, race_producer, NULL)) {
+		return -EAGAIN;
+	}
+
+	while (!__atomic_load_n(&race_done, __ATOMIC_ACQUIRE)) {
+		struct iv_cursor cur;
+		uint32_t prev = 0;
+
+		/* Every other snapshot is read a sample at a time, slower
+		 * than the producer, so it gets lapped
+		 */
+		uint32_t batch = rounds % 2 ? 1 : ARRAY_SIZE(buf);
+
+		data_cache_snapshot(&cur);
+		for (uint32_t i = 0;;) {
+			int n = data_cache_read(&cur, i, buf, batch);
+
+			if (n <= 0) {
+				/* Lapped by the producer: take a new snapshot */
+				lost += n < 0;
+				break;
+			}
+			for (int j = 0; j < n; j++) {
+				bool ordered = i + j == 0 ||
+					       (int32_t)(buf[j].uptime_ms - prev) > 0;
+
+				bad += !ordered ||
+				       buf[j].db != race_db(buf[j].uptime_ms);
+				prev = buf[j].uptime_ms;
+			}
+			checked += n;
+			i += n;
+		}
+
+		/* Exercise release against the producer too */
+		if (++rounds % 16 == 0) {
+			data_cache_release(&cur);
+		}
+	}
+	pthread_join(producer, NULL);
+
+	fprintf(stderr, "cache_race: %llu samples read in %u snapshots, "
+		"%llu lapped, %llu bad\n", (unsigned long long)checked, rounds,
+		(unsigned long long)lost, (unsigned long long)bad);
+	return bad ? -EIO : 0;
+}
+
+/* --- Sync airtime model --- */
+
+/*
+ * A sync's notifications or SDUs as link-layer PDUs on a 2M PHY with
+ * 251-byte packets: each PDU is answered by an empty one from the phone,
+ * a connection event is 7.5 ms every 30 ms, and the sender refills its
+ * queue (SYNC_TX_CREDITS notifications, or the L2CAP SDU buffers) once
+ * per event.
+ */
+#define AIR_SAMPLES      8000
+#define AIR_MAX_PDUS     (AIR_SAMPLES + 64)
+#define AIR_PDU_OVERHEAD 11   /* Preamble, access address, header, CRC */
+#define AIR_US_PER_BYTE  4    /* 2M PHY */
+#define AIR_IFS_US       150
+#define AIR_EVENT_US     7500
+#define AIR_INTERVAL_MS  30
+#define AIR_ATT_HDR      7    /* L2CAP basic header + ATT notification */
+#define AIR_COC_SDU      1233 /* CONFIG_IV_SYNC_L2CAP_SDU_SIZE */
+#define AIR_COC_MPS      247
+#define AIR_L2CAP_HDR    4
+
+struct airtime {
+	const char *name;
+	uint32_t in_flight;  /* Notifications or SDUs queued at once */
+	uint32_t records;
+	uint32_t units;
+	uint32_t pdus;
+	uint16_t pdu_len[AIR_MAX_PDUS];
+	bool     pdu_last[AIR_MAX_PDUS];  /* Ends its notification or SDU */
+};
+
+static void air_add(struct airtime *a, uint16_t len, bool last)
+{
+	if (a->pdus < AIR_MAX_PDUS) {
+		a->pdu_len[a->pdus] = len;
+		a->pdu_last[a->pdus] = last;
+		a->pdus++;
+	}
+}
+
+static void air_build(struct airtime *a, uint32_t frame_size, bool coc)
+{
+	static struct sync_stream st;
+	static uint8_t frame[AIR_COC_SDU];
+	uint32_t count;
+
+	sync_stream_open(&st);
+	do {
+		uint16_t len = IV_SAMPLE_RECORD_SIZE;
+
+		count = frame_size ?
+			sync_stream_frame(&st, frame, frame_size, &len) :
+			sync_stream_record(&st, frame);
+		sync_stream_commit(&st);
+		a->records += count;
+		a->units++;
+
+		if (!coc) {
+			air_add(a, AIR_ATT_HDR + len, true);
+			continue;
+		}
+
+		/* SDU length field, then K-frames of at most MPS */
+		for (uint32_t off = 0, sdu = len + 2U; off < sdu;) {
+			uint32_t chunk = MIN(sdu - off, AIR_COC_MPS);
+
+			off += chunk;
+			air_add(a, AIR_L2CAP_HDR + chunk, off == sdu);
+		}
+	} while (count > 0);
+}
+
+static void air_report(const struct airtime *a)
+{
+	uint64_t radio_us = 0;
+	uint32_t events = 0;
+
+	for (uint32_t p = 0; p < a->pdus; events++) {
+		uint32_t t = 0;
+		uint32_t done = 0;
+
+		while (p < a->pdus && done < a->in_flight) {
+			uint32_t x = (2 * AIR_PDU_OVERHEAD + a->pdu_len[p]) *
+				     AIR_US_PER_BYTE + 2 * AIR_IFS_US;
+
+			if (t + x > AIR_EVENT_US) {
+				break;
+			}
+			t += x;
+			done += a->pdu_last[p];
+			p++;
+		}
+		radio_us += t;
+	}
+
+	uint32_t wall_ms = events * AIR_INTERVAL_MS;
+
+	fprintf(stderr, "sync_airtime: %-12s %5u units %5u PDUs  radio %6.1f ms"
+		"  %7.2f s  %6.1f KB/s\n", a->name, a->units, a->pdus,
+		radio_us / 1000.0, wall_ms / 1000.0,
+		wall_ms ? a->records * (double)IV_SAMPLE_RECORD_SIZE / wall_ms :
+		0.0);
+}
+
+static void sync_airtime_report(void)
+{
+	static struct airtime runs[] = {
+		{ .name = "gatt_records", .in_flight = 6 },
+		{ .name = "gatt_framed",  .in_flight = 6 },
+		{ .name = "l2cap",        .in_flight = 3 },
+	};
+
+	data_cache_init();
+	for (uint32_t i = 0; i < AIR_SAMPLES; i++) {
+		data_cache_push((uint8_t)i);
+	}
+
+	air_build(&runs[0], 0, false);
+	air_build(&runs[1], BENCH_FRAME_SIZE, false);
+	air_build(&runs[2], AIR_COC_SDU, true);
+	for (size_t i = 0; i < ARRAY_SIZE(runs); i++) {
+		air_report(&runs[i]);
+	}
+}
+
+/* --- Budgets --- */
+
+static struct bench_case *find_case(const char *name)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(cases); i++) {
+		if (strcmp(cases[i].name, name) == 0) {
+			return &cases[i];
+		}
+	}
+	return NULL;
+}
+
+/* Lines: <case> <ns> <instructions>; '#' starts a comment, 0 = unset */
+static int budgets_load(const char *path)
+{
+	char line[256];
+	FILE *f = fopen(path, "r");
+	int lineno = 0;
+
+	if (!f) {
+		return -errno;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		char name[64];
+		double bns, binsn;
+		char *hash = strchr(line, '#');
+
+		lineno++;
+		if (hash) {
+			*hash = '\0';
+		}
+		if (strspn(line, " \t\r\n") == strlen(line)) {
+			continue;
+		}
+		if (sscanf(line, "%63s %lf %lf", name, &bns, &binsn) != 3) {
+			fprintf(stderr, "%s:%d: expected <case> <ns> <insn>\n",
+				path, lineno);
+			fclose(f);
+			return -EINVAL;
+		}
+
+		struct bench_case *c = find_case(name);
+
+		if (!c) {
+			fprintf(stderr, "%s:%d: unknown case %s\n", path,
+				lineno, name);
+			continue;
+		}
+		c->budget_ns = bns;
+		c->budget_insn = binsn;
+	}
+
+	fclose(f);
+	return 0;
+}
+
+/* Only the budgets of the active mode are re-recorded */
+static int budgets_record(const char *path, bool time_mode)
+{
+	FILE *f = fopen(path, "w");
+
+	if (!f) {
+		return -errno;
+	}
+
+	fprintf(f, "# iv_bench budgets per call: <case> <ns> <instructions>\n"
+		   "# Written by iv_bench -r -t (ns, %d%% of the measured cost) "
+		   "and\n# iv_bench -r (instructions, %d%%); 0 = unchecked.\n"
+		   "# mutex_* rows are baselines: the case each replaced must "
+		   "cost less.\n",
+		RECORD_NS_PCT, RECORD_INSN_PCT);
+	for (size_t i = 0; i < ARRAY_SIZE(cases); i++) {
+		const struct bench_case *c = &cases[i];
+		double bns = time_mode ?
+			     c->ns * RECORD_NS_PCT / 100 + RECORD_NS_SLACK :
+			     c->budget_ns;
+		double binsn = time_mode ? c->budget_insn :
+			       c->insn * RECORD_INSN_PCT / 100;
+
+		if (c->baseline_of) {
+			bns = 0;
+			binsn = 0;
+		}
+
+		fprintf(f, "%-22s %10.0f %10.0f\n", c->name, bns, binsn);
+	}
+
+	fclose(f);
+	return 0;
+}
+
+/* Each baseline beside the case it is the old version of */
+static void baseline_report(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(cases); i++) {
+		const struct bench_case *b = &cases[i];
+		const struct bench_case *c = b->baseline_of ?
+					     find_case(b->baseline_of) : NULL;
+
+		if (!c) {
+			continue;
+		}
+		fprintf(stderr, "baseline: %-18s %8.1f ns %8.0f insn, "
+			"%-20s %8.1f ns %8.0f insn (%.2fx)\n", c->name, c->ns,
+			c->insn, b->name, b->ns, b->insn,
+			b->ns > 0 ? c->ns / b->ns : 0);
+	}
+}
+
+/* Instructions, or nanoseconds in time mode; an unset budget passes. A
+ * baseline passes when the case that replaced it costs less.
+ */
+static void check(struct bench_case *c, bool time_mode, double scale)
+{
+	const struct bench_case *of = c->baseline_of ?
+				      find_case(c->baseline_of) : NULL;
+
+	if (of) {
+		c->pass = time_mode ? of->ns < c->ns : of->insn < c->insn;
+	} else if (time_mode) {
+		c->pass = c->budget_ns <= 0 || c->ns <= c->budget_ns * scale;
+	} else {
+		c->pass = c->budget_insn <= 0 || c->insn <= c->budget_insn;
+	}
+}
+
+static int report_json(const char *path, bool time_mode, double scale)
+{
+	FILE *f = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+
+	if (!f) {
+		return -errno;
+	}
+
+	fprintf(f, "{\n  \"tool\": \"iv_bench\",\n  \"checked\": \"%s\",\n"
+		   "  \"counter\": \"%s\",\n  \"ns_scale\": %.2f,\n"
+		   "  \"cases\": [\n",
+		time_mode ? "ns" : "instructions", counter_names[counter],
+		scale);
+	for (size_t i = 0; i < ARRAY_SIZE(cases); i++) {
+		const struct bench_case *c = &cases[i];
+
+		fprintf(f, "    {\"name\": \"%s\", \"ns\": %.1f, "
+			   "\"instructions\": %.0f, \"budget_ns\": %.0f, "
+			   "\"budget_instructions\": %.0f, \"pass\": %s",
+			c->name, c->ns, c->insn, c->budget_ns * scale,
+			c->budget_insn, c->pass ? "true" : "false");
+		if (c->baseline_of) {
+			fprintf(f, ", \"baseline_of\": \"%s\"",
+				c->baseline_of);
+		}
+		fprintf(f, "}%s\n", i + 1 < ARRAY_SIZE(cases) ? "," : "");
+	}
+	fprintf(f, "  ]\n}\n");
+
+	if (f != stdout) {
+		fclose(f);
+	}
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  -b <file>  budgets (default %s)\n"
+		"  -t         check time budgets instead of instructions "
+		"(no counter needed)\n"
+		"  -s <x>     with -t, scale time budgets by x for slower "
+		"hosts (default 1)\n"
+		"  -j <file>  write a JSON report ('-' for stdout)\n"
+		"  -r         record new budgets for the checked mode from "
+		"this run instead of\n"
+		"             checking\n",
+		prog, IV_BENCH_BUDGETS);
+}
+
+int main(int argc, char **argv)
+{
+	const char *budgets = IV_BENCH_BUDGETS;
+	const char *json = NULL;
+	double scale = 1.0;
+	bool time_mode = false;
+	bool record = false;
+	int failed = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "b:ts:j:rh")) != -1) {
+		switch (opt) {
+		case 'b':
+			budgets = optarg;
+			break;
+		case 't':
+			time_mode = true;
+			break;
+		case 's':
+			scale = atof(optarg);
+			break;
+		case 'j':
+			json = optarg;
+			break;
+		case 'r':
+			record = true;
+			break;
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	int err = budgets_load(budgets);
+
+	if (err && !(record && err == -ENOENT)) {
+		fprintf(stderr, "%s: %s\n", budgets, strerror(-err));
+		return 2;
+	}
+
+	if (!time_mode) {
+		insn_open();
+		if (counter == INSN_NONE) {
+			step_open();
+		}
+		if (counter == INSN_NONE) {
+			fprintf(stderr, "No instruction counter: perf events "
+				"and ptrace are both unavailable.\nUse -t to "
+				"check time budgets instead.\n");
+			return 2;
+		}
+		if (counter == INSN_STEP) {
+			step_calibrate();
+		}
+		fprintf(stderr, "Counting instructions with %s\n",
+			counter_names[counter]);
+	}
+
+	fill_pcm();
+
+	fprintf(stderr, "%-22s %10s %10s %10s %10s\n", "case", "ns",
+		"budget", "insn", "budget");
+	for (size_t i = 0; i < ARRAY_SIZE(cases); i++) {
+		struct bench_case *c = &cases[i];
+
+		measure(c);
+		check(c, time_mode, scale);
+		failed += !c->pass;
+		fprintf(stderr, "%-22s %10.1f %10.0f %10.0f %10.0f%s\n",
+			c->name, c->ns, c->budget_ns * scale, c->insn,
+			c->budget_insn, c->pass || record ? "" : "  OVER");
+	}
+
+	baseline_report();
+
+	int race = cache_race_check();
+
+	sync_airtime_report();
+
+	if (record) {
+		err = budgets_record(budgets, time_mode);
+		if (err) {
+			fprintf(stderr, "%s: %s\n", budgets, strerror(-err));
+			return 2;
+		}
+		fprintf(stderr, "Budgets written to %s\n", budgets);
+		failed = 0;
+	}
+
+	if (json) {
+		err = report_json(json, time_mode, scale);
+		if (err) {
+			fprintf(stderr, "%s: %s\n", json, strerror(-err));
+			return 2;
+		}
+	}
+
+	if (race) {
+		fprintf(stderr, "cache_race: %s\n", strerror(-race));
+		return 1;
+	}
+	if (failed) {
+		fprintf(stderr, "%d case(s) over budget\n", failed);
+		return 1;
+	}
+	return 0;
+}
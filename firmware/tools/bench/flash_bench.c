@@ -0,0 +1,766 @@
+/*
+ * Flash log benchmark on a simulated 2 MB QSPI partition.
+ *
+ * Appends days of 1 Hz history the way the history module does (full
+ * pages, a forced flush every -f seconds, a power-off gap each night),
+ * wrapping the partition, then reports write amplification and per-sector
+ * erase spread. It then recovers the full partition from cold and reports
+ * the reads it took, and finally tears page writes and corrupts a payload
+ * to check that recovery and reads skip them. It then runs syncs between stretches of logging
+ * and reports how late 60 ms vibration steps would be if the sync work
+ * shared their workqueue. Last, it cuts syncs off mid-stream, with acks
+ * arriving out of order, to check that each resumes at the synced mark. Device times are modelled from typical P25Q16H
+ * timings; the host time of the recovery code is shown alongside.
+ *
+ * Usage: iv_flash_bench [-d days] [-f flush_s] [-j report.json]
+ */
+
+#include "app/flash_log.h"
+#include "app/sync_stream.h"
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+
+#define PART_SIZE        (2 * 1024 * 1024)
+#define PART_SECTORS     (PART_SIZE / FLASH_LOG_SECTOR_SIZE)
+
+/* P25Q16H typical timings; reads at 32 MHz quad SPI */
+#define MODEL_PROGRAM_US 600
+#define MODEL_ERASE_US   40000
+#define MODEL_READ_CMD_US 5
+#define MODEL_READ_MBPS  16
+
+#define DAY_S            86400
+#define NIGHT_OFF_S      (8 * 3600)
+
+/* Framed GATT sync at a 247-byte ATT MTU: six notifications in flight,
+ * refilled once per 30 ms connection event
+ */
+#define JIT_SYNCS         200
+#define JIT_STEP_US       60000
+#define JIT_FRAME_SAMPLES ((244 - SYNC_FRAME_HDR_SIZE) / IV_SAMPLE_RECORD_SIZE)
+#define JIT_PER_EVENT     6
+#define JIT_EVENT_US      30000
+
+/* Syncs cut short by a dropped link, acked every ACK_EVERY frames */
+#define ACK_SESSIONS      400
+#define ACK_EVERY         8
+
+/* --- Simulated NOR flash --- */
+
+static uint8_t flash[PART_SIZE];
+static uint32_t sector_erases[PART_SECTORS];
+
+static struct {
+	uint64_t reads;
+	uint64_t read_bytes;
+	uint64_t writes;
+	uint64_t programmed;
+	uint64_t erases;
+	size_t   tear_at;   /* Program only this many bytes of the next write */
+} sim;
+
+static const struct flash_area part = {
+	.fa_id = 0,
+	.fa_off = 0,
+	.fa_size = PART_SIZE,
+};
+
+int flash_area_read(const struct flash_area *fa, off_t off, void *dst,
+		    size_t len)
+{
+	if (off < 0 || (size_t)off + len > fa->fa_size) {
+		return -EINVAL;
+	}
+	memcpy(dst, &flash[off], len);
+	sim.reads++;
+	sim.read_bytes += len;
+	return 0;
+}
+
+int flash_area_write(const struct flash_area *fa, off_t off, const void *src,
+		     size_t len)
+{
+	const uint8_t *p = src;
+
+	if (off < 0 || (size_t)off + len > fa->fa_size) {
+		return -EINVAL;
+	}
+	if (sim.tear_at) {
+		len = MIN(len, sim.tear_at);
+		sim.tear_at = 0;
+	}
+	/* NOR programming only clears bits */
+	for (size_t i = 0; i < len; i++) {
+		flash[off + i] &= p[i];
+	}
+	sim.writes++;
+	sim.programmed += len;
+	return 0;
+}
+
+int flash_area_erase(const struct flash_area *fa, off_t off, size_t len)
+{
+	if (off < 0 || (size_t)off + len > fa->fa_size ||
+	    off % FLASH_LOG_SECTOR_SIZE || len % FLASH_LOG_SECTOR_SIZE) {
+		return -EINVAL;
+	}
+	memset(&flash[off], 0xFF, len);
+	for (size_t s = 0; s < len / FLASH_LOG_SECTOR_SIZE; s++) {
+		sector_erases[off / FLASH_LOG_SECTOR_SIZE + s]++;
+	}
+	sim.erases += len / FLASH_LOG_SECTOR_SIZE;
+	return 0;
+}
+
+/* Unused by the flash log, required by the kernel shim */
+int64_t k_uptime_get(void)
+{
+	return 0;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static double model_read_ms(uint64_t reads, uint64_t bytes)
+{
+	return (reads * MODEL_READ_CMD_US +
+		(double)bytes / MODEL_READ_MBPS) / 1000.0;
+}
+
+/* Modelled device time of every flash operation so far */
+static uint64_t model_busy_us(void)
+{
+	return sim.reads * MODEL_READ_CMD_US +
+	       sim.read_bytes / MODEL_READ_MBPS +
+	       sim.writes * MODEL_PROGRAM_US + sim.erases * MODEL_ERASE_US;
+}
+
+/* Deterministic level for sample seq, to verify reads */
+static uint8_t level_of(uint32_t seq)
+{
+	return (uint8_t)(40 + (seq * 7U) % 60);
+}
+
+/* --- Workload: the history module's batching --- */
+
+struct writer {
+	uint8_t  buf[FLASH_LOG_CHUNK_SAMPLES];
+	uint32_t n;
+	int64_t  base_ms;
+	uint32_t seq;
+};
+
+static int writer_flush(struct writer *w)
+{
+	int err = 0;
+
+	if (w->n > 0) {
+		err = flash_log_append(w->base_ms, w->buf, w->n);
+		w->base_ms += (int64_t)w->n * CACHE_INTERVAL_MS;
+		w->n = 0;
+	}
+	return err;
+}
+
+static int writer_push(struct writer *w, int64_t t_ms)
+{
+	if (w->n == 0) {
+		w->base_ms = t_ms;
+	}
+	w->buf[w->n++] = level_of(w->seq++);
+	return w->n == FLASH_LOG_CHUNK_SAMPLES ? writer_flush(w) : 0;
+}
+
+/* Seconds of history for the day, a forced flush every flush_s and
+ * before the night's gap
+ */
+static int write_day(struct writer *w, uint32_t day, uint32_t flush_s)
+{
+	int64_t day_ms = (int64_t)day * DAY_S * 1000;
+	int err = 0;
+
+	for (uint32_t s = 0; s < DAY_S - NIGHT_OFF_S && !err; s++) {
+		err = writer_push(w, day_ms + (int64_t)s * 1000);
+		if (!err && (s + 1) % flush_s == 0) {
+			err = writer_flush(w);
+		}
+	}
+	return err ? err : writer_flush(w);
+}
+
+/* --- Feedback timing during syncs --- */
+
+struct jitter {
+	uint32_t erasing;       /* Syncs whose start erased a sector */
+	uint32_t start_max_us;  /* Longest sync start (snapshot) */
+	uint32_t frame_max_us;  /* Longest frame handler */
+	uint64_t steps;
+	uint64_t late;          /* Steps due while a sync handler ran */
+	uint32_t late_max_us;
+};
+
+/* Vibration steps due at phase + k * JIT_STEP_US against one busy
+ * stretch [from, to) of the shared workqueue
+ */
+struct steps {
+	uint64_t due_us;
+};
+
+static void steps_run(struct steps *s, struct jitter *j, uint64_t from,
+		      uint64_t to)
+{
+	for (; s->due_us < to; s->due_us += JIT_STEP_US) {
+		j->steps++;
+		if (s->due_us >= from) {
+			j->late++;
+			j->late_max_us = MAX(j->late_max_us,
+					     (uint32_t)(to - s->due_us));
+		}
+	}
+}
+
+/*
+ * Log 1-3 hours, then sync everything unsynced: a snapshot of the flash
+ * log, the samples still in RAM copied rather than flushed (see
+ * history_snapshot()), then one frame per notification, read
+ * SYNC_STREAM_BATCH samples at a time from flash. The RAM tail costs no
+ * flash time and is not modelled. The app's ack covers the tail too; the
+ * history module applies that part once a flush logs it, here at the
+ * next sync. On a
+ * workqueue shared with the vibration patterns a step that falls due
+ * while a handler runs waits for it. The feedback workqueue, which runs
+ * above ble_tx, is not modelled. Only flash time is modelled, not the BLE
+ * stack's CPU time, so the lateness is a lower bound.
+ */
+static int sync_jitter(struct writer *w, int64_t *t_ms, uint32_t flush_s,
+		       struct jitter *j)
+{
+	static struct iv_sample buf[SYNC_STREAM_BATCH];
+	uint32_t acked = 0;
+
+	for (uint32_t n = 0; n < JIT_SYNCS; n++) {
+		uint32_t secs = 3600 + (uint32_t)rand() % 7200;
+		int err = 0;
+
+		for (uint32_t s = 0; s < secs && !err; s++, *t_ms += 1000) {
+			err = writer_push(w, *t_ms);
+			if (!err && (s + 1) % flush_s == 0) {
+				err = writer_flush(w);
+			}
+		}
+
+		if (err) {
+			return err;
+		}
+
+		uint64_t b = model_busy_us();
+		uint64_t erases = sim.erases;
+		struct iv_cursor cur;
+
+		flash_log_advance_synced(acked);
+		flash_log_snapshot(&cur);
+
+		uint32_t start_us = (uint32_t)(model_busy_us() - b);
+		struct steps st = { .due_us = (uint32_t)rand() % JIT_STEP_US };
+		uint64_t t = start_us;
+
+		j->erasing += sim.erases != erases;
+		j->start_max_us = MAX(j->start_max_us, start_us);
+		steps_run(&st, j, 0, t);
+
+		for (uint32_t i = 0, f = 0; i < iv_cursor_count(&cur);
+		     i += JIT_FRAME_SAMPLES, f++) {
+			uint64_t event = start_us +
+				(uint64_t)(f / JIT_PER_EVENT) * JIT_EVENT_US;
+			uint32_t want = MIN(JIT_FRAME_SAMPLES,
+					    iv_cursor_count(&cur) - i);
+
+			b = model_busy_us();
+			for (uint32_t k = 0; k < want; k += SYNC_STREAM_BATCH) {
+				if (flash_log_read(&cur, i + k, buf,
+						   MIN(SYNC_STREAM_BATCH,
+						       want - k)) <= 0) {
+					return -EIO;
+				}
+			}
+
+			uint32_t d = (uint32_t)(model_busy_us() - b);
+			uint64_t from = MAX(t, event);
+
+			j->frame_max_us = MAX(j->frame_max_us, d);
+			steps_run(&st, j, from, from + d);
+			t = from + d;
+		}
+		acked = cur.end + w->n;
+		flash_log_advance_synced(acked);
+	}
+	return 0;
+}
+
+/* --- Acks across dropped links --- */
+
+struct ack_app {
+	uint32_t next_seq;  /* Next sample the app expects */
+	uint32_t received;  /* Samples before this were received */
+	uint32_t acked;     /* Highest ack applied */
+	uint32_t late;      /* Ack held back behind a newer one, or 0 */
+	uint64_t records;
+	uint64_t bad;
+};
+
+/* Acks go out over GATT or L2CAP, so one may overtake another */
+static void ack_send(struct ack_app *app, uint32_t seq)
+{
+	uint32_t mark;
+
+	if (app->late == 0 && rand() % 4 == 0) {
+		app->late = seq;
+		return;
+	}
+	app->acked = MAX(app->acked, seq);
+	mark = flash_log_advance_synced(seq);
+	if (app->late) {
+		mark = flash_log_advance_synced(app->late);
+		app->acked = MAX(app->acked, app->late);
+		app->late = 0;
+	}
+	app->bad += mark != app->acked;
+}
+
+/* Frame [seq, seq + n) as received: in order, with the logged levels */
+static void ack_receive(struct ack_app *app, const struct iv_sample *buf,
+			uint32_t seq, uint32_t n)
+{
+	app->bad += seq != app->next_seq;
+	for (uint32_t i = 0; i < n; i++) {
+		app->bad += buf[i].db != level_of(seq + i);
+	}
+	app->next_seq = seq + n;
+	app->received = MAX(app->received, app->next_seq);
+	app->records += n;
+}
+
+/*
+ * Syncs between short stretches of logging, most of them cut off at a
+ * random frame as when the link drops: the JIT_PER_EVENT frames still in
+ * flight never arrive, and an ack held back behind a newer one may only
+ * arrive during the next sync. Each sync resumes at the synced mark. No
+ * acked sample may be sent again, none may be skipped, and a late ack
+ * must not move the mark back.
+ */
+static int ack_resume(struct writer *w, int64_t *t_ms, uint64_t *frames,
+		      uint64_t *lost, struct ack_app *app)
+{
+	static struct iv_sample buf[JIT_PER_EVENT + 1][JIT_FRAME_SAMPLES];
+	uint32_t seqs[JIT_PER_EVENT + 1];
+	uint32_t lens[JIT_PER_EVENT + 1];
+
+	app->acked = flash_log_synced();
+	app->next_seq = app->acked;
+	app->received = app->acked;
+
+	for (uint32_t s = 0; s <= ACK_SESSIONS; s++) {
+		/* The last sync runs to the end */
+		uint32_t cut = s < ACK_SESSIONS ? (uint32_t)rand() % 40 :
+			       UINT32_MAX;
+		uint32_t secs = (uint32_t)rand() % 600;
+		uint32_t sent = 0;
+		uint32_t done = 0;
+		struct iv_cursor cur;
+		int err = 0;
+
+		for (uint32_t i = 0; i < secs && !err; i++, *t_ms += 1000) {
+			err = writer_push(w, *t_ms);
+		}
+		err = err ? err : writer_flush(w);
+		if (err) {
+			return err;
+		}
+
+		/* Resumes at the newest ack, with nothing in between lost */
+		flash_log_snapshot(&cur);
+		app->bad += cur.start != app->acked ||
+			    cur.start > app->received;
+		app->next_seq = cur.start;
+
+		for (uint32_t i = 0; i < iv_cursor_count(&cur) && sent < cut;
+		     sent++) {
+			uint32_t slot = sent % ARRAY_SIZE(buf);
+			uint32_t n = 0;
+
+			/* The oldest frame in flight reaches the app */
+			if (sent - done == JIT_PER_EVENT) {
+				uint32_t d = done % ARRAY_SIZE(buf);
+
+				ack_receive(app, buf[d], seqs[d], lens[d]);
+				if (++done % ACK_EVERY == 0) {
+					ack_send(app, app->next_seq);
+				}
+			}
+
+			while (n < JIT_FRAME_SAMPLES &&
+			       i + n < iv_cursor_count(&cur)) {
+				int ret = flash_log_read(&cur, i + n,
+							 &buf[slot][n],
+							 JIT_FRAME_SAMPLES - n);
+
+				if (ret <= 0) {
+					return ret ? ret : -EIO;
+				}
+				n += (uint32_t)ret;
+			}
+			seqs[slot] = cur.start + i;
+			lens[slot] = n;
+			i += n;
+
+			/* Samples logged mid-sync wait for the next one */
+			for (uint32_t k = (uint32_t)rand() % 3; k > 0;
+			     k--, *t_ms += 1000) {
+				err = writer_push(w, *t_ms);
+				if (err) {
+					return err;
+				}
+			}
+		}
+		*frames += sent;
+
+		if (sent < cut) {
+			for (; done < sent; done++) {
+				uint32_t d = done % ARRAY_SIZE(buf);
+
+				ack_receive(app, buf[d], seqs[d], lens[d]);
+			}
+			ack_send(app, app->next_seq);
+		} else {
+			/* Link lost: whatever was in flight never arrives */
+			*lost += sent - done;
+		}
+
+		/* Exactly the samples past the newest ack are unsynced */
+		app->bad += flash_log_count() !=
+			    flash_log_end_seq() - app->acked;
+	}
+
+	if (app->late) {
+		app->acked = MAX(app->acked, app->late);
+		app->bad += flash_log_advance_synced(app->late) != app->acked;
+	}
+
+	/* An ack past the newest sample stops at it */
+	app->bad += flash_log_advance_synced(UINT32_MAX) !=
+		    flash_log_end_seq();
+	return 0;
+}
+
+/* Spot-check levels and timestamp order (uptime_ms wraps at 2^32 ms)
+ * across the unsynced range
+ */
+static bool verify_reads(uint32_t *checked)
+{
+	uint32_t count = flash_log_count();
+	struct flash_log_stats st;
+	uint32_t prev_ms = 0;
+
+	flash_log_get_stats(&st);
+	*checked = 0;
+	for (uint32_t idx = 0; idx < count; idx += 997) {
+		struct iv_sample s;
+
+		if (!flash_log_get(idx, &s) ||
+		    s.db != level_of(st.oldest_seq + idx) ||
+		    (*checked > 0 && (int32_t)(s.uptime_ms - prev_ms) <= 0)) {
+			fprintf(stderr, "Read mismatch at %u\n", idx);
+			return false;
+		}
+		prev_ms = s.uptime_ms;
+		(*checked)++;
+	}
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t days = 45;
+	uint32_t flush_s = 600;
+	const char *json = NULL;
+	struct writer w = { 0 };
+	struct flash_log_stats st;
+	uint32_t checked;
+	bool ok = true;
+	int opt;
+	int err;
+
+	while ((opt = getopt(argc, argv, "d:f:j:h")) != -1) {
+		switch (opt) {
+		case 'd':
+			days = (uint32_t)atoi(optarg);
+			break;
+		case 'f':
+			flush_s = MAX((uint32_t)atoi(optarg), 1U);
+			break;
+		case 'j':
+			json = optarg;
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-d days] [-f flush_s] "
+				"[-j report.json]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	/* Factory state: erased */
+	memset(flash, 0xFF, sizeof(flash));
+	err = flash_log_init(&part);
+	if (err) {
+		fprintf(stderr, "init: %d\n", err);
+		return 2;
+	}
+
+	/* 1. Write amplification */
+	for (uint32_t d = 0; d < days && !err; d++) {
+		err = write_day(&w, d, flush_s);
+	}
+	if (err) {
+		fprintf(stderr, "append: %d\n", err);
+		return 2;
+	}
+
+	flash_log_get_stats(&st);
+
+	uint64_t payload = st.payload_bytes;
+	double wa_pages = (double)st.pages_written * FLASH_LOG_PAGE_SIZE /
+			  payload;
+	double wa_prog = (double)sim.programmed / payload;
+	double wa_erase = (double)sim.erases * FLASH_LOG_SECTOR_SIZE / payload;
+	uint32_t emin = UINT32_MAX, emax = 0;
+
+	for (uint32_t s = 0; s < PART_SECTORS; s++) {
+		emin = MIN(emin, sector_erases[s]);
+		emax = MAX(emax, sector_erases[s]);
+	}
+
+	double busy_ms_day = (sim.writes * MODEL_PROGRAM_US +
+			      sim.erases * MODEL_ERASE_US) / 1000.0 / days;
+
+	ok &= verify_reads(&checked);
+
+	printf("workload      %u days, 1 Hz, %u h off nightly, flush every "
+	       "%u s\n", days, NIGHT_OFF_S / 3600, flush_s);
+	printf("capacity      %u samples (%.1f days of 16 h)\n",
+	       PART_SECTORS * FLASH_LOG_PAGES * FLASH_LOG_CHUNK_SAMPLES,
+	       (double)PART_SECTORS * FLASH_LOG_PAGES *
+	       FLASH_LOG_CHUNK_SAMPLES / (DAY_S - NIGHT_OFF_S));
+	printf("written       %llu samples, %llu pages, %llu erases\n",
+	       (unsigned long long)payload,
+	       (unsigned long long)st.pages_written,
+	       (unsigned long long)sim.erases);
+	printf("write amp     %.3f pages, %.3f programmed, %.3f erased\n",
+	       wa_pages, wa_prog, wa_erase);
+	printf("erase spread  %u..%u per sector\n", emin, emax);
+	printf("flash busy    %.1f ms/day (modelled)\n", busy_ms_day);
+	printf("reads         %u spot checks %s\n", checked,
+	       ok ? "ok" : "FAILED");
+
+	/* 2. Cold recovery of the full partition */
+	uint32_t end_before = st.end_seq;
+	uint32_t oldest_before = st.oldest_seq;
+
+	memset(&sim, 0, sizeof(sim));
+
+	uint64_t t0 = now_ns();
+
+	err = flash_log_init(&part);
+
+	uint64_t host_ns = now_ns() - t0;
+
+	flash_log_get_stats(&st);
+	if (err || st.end_seq != end_before || st.oldest_seq != oldest_before) {
+		fprintf(stderr, "Recovery mismatch: err %d end %u/%u oldest "
+			"%u/%u\n", err, st.end_seq, end_before, st.oldest_seq,
+			oldest_before);
+		ok = false;
+	}
+	ok &= verify_reads(&checked);
+
+	double rec_ms = model_read_ms(st.recovery_reads, st.recovery_bytes);
+
+	printf("recovery      %u reads, %u bytes: %.1f ms modelled, "
+	       "%.2f ms host\n", st.recovery_reads, st.recovery_bytes,
+	       rec_ms, host_ns / 1e6);
+
+	/* 3. Torn writes: mid-payload, then mid-header */
+	uint32_t torn_ok = 0;
+	static const size_t tears[] = { FLASH_LOG_HDR_SIZE + 40, 10 };
+
+	for (size_t i = 0; i < ARRAY_SIZE(tears); i++) {
+		uint32_t end = st.end_seq;
+
+		sim.tear_at = tears[i];
+		for (uint32_t s = 0; s < FLASH_LOG_CHUNK_SAMPLES; s++) {
+			writer_push(&w, (int64_t)(days + i) * DAY_S * 1000 +
+				    s * 1000);
+		}
+		if (flash_log_init(&part)) {
+			ok = false;
+			break;
+		}
+		flash_log_get_stats(&st);
+
+		/* Either way the log ends before the torn chunk, counted
+		 * once, and its page is skipped when the same samples are
+		 * written again
+		 */
+		struct iv_sample s;
+		bool readable = flash_log_get(flash_log_count() - 1, &s) &&
+				s.db == level_of(end - 1);
+		bool expect_end = st.end_seq == end &&
+				  st.torn_chunks == 1;
+
+		w.seq = st.end_seq;
+		for (uint32_t s = 0; s < FLASH_LOG_CHUNK_SAMPLES; s++) {
+			writer_push(&w, (int64_t)(days + i) * DAY_S * 1000 +
+				    (FLASH_LOG_CHUNK_SAMPLES + s) * 1000);
+		}
+		flash_log_get_stats(&st);
+
+		uint32_t n = flash_log_count();
+		bool tail_ok = flash_log_get(n - FLASH_LOG_CHUNK_SAMPLES, &s) &&
+			       s.db == level_of(end) &&
+			       flash_log_get(n - 1, &s) &&
+			       s.db == level_of(st.end_seq - 1);
+
+		if (expect_end && readable && tail_ok) {
+			torn_ok++;
+		} else {
+			ok = false;
+		}
+	}
+	printf("torn writes   %u/%zu recovered\n", torn_ok, ARRAY_SIZE(tears));
+
+	/* A payload gone bad mid-log: the first read finds it, the rest of
+	 * its samples fail without flash reads
+	 */
+	uint64_t bad_reads = 0;
+	bool bad_ok = false;
+	struct iv_cursor cur;
+
+	flash_log_snapshot(&cur);
+	for (uint32_t sec = 0; sec < PART_SECTORS && !bad_ok; sec++) {
+		uint8_t *pg = &flash[sec * FLASH_LOG_SECTOR_SIZE +
+				     3 * FLASH_LOG_PAGE_SIZE];
+		uint32_t first = sys_get_le32(&pg[4]);
+		struct iv_sample buf[4];
+
+		/* A chunk magic ("IV") wholly inside the snapshot */
+		if (sys_get_le16(pg) != 0x4956 || first < cur.start ||
+		    first + pg[2] > cur.end) {
+			continue;
+		}
+		pg[FLASH_LOG_HDR_SIZE + 5] ^= 0x01;
+		bad_ok = flash_log_read(&cur, first - cur.start, buf,
+					ARRAY_SIZE(buf)) == -EIO;
+
+		uint64_t reads = sim.reads;
+
+		for (uint32_t k = 1; k < pg[2]; k++) {
+			bad_ok &= flash_log_read(&cur, first - cur.start + k,
+						 buf, ARRAY_SIZE(buf)) == -EIO;
+		}
+		bad_reads = sim.reads - reads;
+		bad_ok &= bad_reads == 0 &&
+			  flash_log_read(&cur, first - cur.start + pg[2], buf,
+					 ARRAY_SIZE(buf)) > 0;
+		pg[FLASH_LOG_HDR_SIZE + 5] ^= 0x01;
+	}
+	ok &= bad_ok;
+	printf("bad payload   %s, %llu flash reads after the first\n",
+	       bad_ok ? "skipped" : "FAILED", (unsigned long long)bad_reads);
+
+	/* 4. Vibration step lateness during syncs */
+	struct jitter jit = { 0 };
+	int64_t t_ms = (int64_t)(days + ARRAY_SIZE(tears)) * DAY_S * 1000;
+
+	/* The app is caught up, torn chunk included, before the first */
+	srand(1);
+	w.seq = st.end_seq;
+	flash_log_advance_synced(st.end_seq);
+	err = sync_jitter(&w, &t_ms, flush_s, &jit);
+	if (err) {
+		fprintf(stderr, "sync: %d\n", err);
+		ok = false;
+	}
+	printf("sync start    %.1f ms max, %u of %u syncs erased a sector; "
+	       "frame %.2f ms max\n", jit.start_max_us / 1000.0, jit.erasing,
+	       JIT_SYNCS, jit.frame_max_us / 1000.0);
+	printf("shared queue  %llu of %llu vibration steps late, worst %.1f ms "
+	       "(modelled)\n", (unsigned long long)jit.late,
+	       (unsigned long long)jit.steps, jit.late_max_us / 1000.0);
+
+	/* 5. Acks across dropped links */
+	struct ack_app app = { 0 };
+	uint64_t ack_frames = 0;
+	uint64_t ack_lost = 0;
+
+	err = ack_resume(&w, &t_ms, &ack_frames, &ack_lost, &app);
+	if (err || app.bad) {
+		fprintf(stderr, "ack resume: %d, %llu bad\n", err,
+			(unsigned long long)app.bad);
+		ok = false;
+	}
+	printf("ack resume    %llu records in %llu frames over %u syncs, "
+	       "%llu frames lost, %llu bad\n",
+	       (unsigned long long)app.records, (unsigned long long)ack_frames,
+	       ACK_SESSIONS + 1, (unsigned long long)ack_lost,
+	       (unsigned long long)app.bad);
+
+	if (json) {
+		FILE *f = strcmp(json, "-") == 0 ? stdout : fopen(json, "w");
+
+		if (!f) {
+			fprintf(stderr, "%s: %s\n", json, strerror(errno));
+			return 2;
+		}
+		fprintf(f, "{\n  \"tool\": \"iv_flash_bench\",\n"
+			   "  \"days\": %u,\n  \"flush_s\": %u,\n"
+			   "  \"payload_bytes\": %llu,\n"
+			   "  \"write_amp_pages\": %.4f,\n"
+			   "  \"write_amp_programmed\": %.4f,\n"
+			   "  \"write_amp_erased\": %.4f,\n"
+			   "  \"erases_min\": %u,\n  \"erases_max\": %u,\n"
+			   "  \"flash_busy_ms_per_day\": %.1f,\n"
+			   "  \"recovery_model_ms\": %.2f,\n"
+			   "  \"recovery_host_ms\": %.3f,\n"
+			   "  \"torn_recovered\": %u,\n"
+			   "  \"bad_payload_skipped\": %s,\n"
+			   "  \"sync_start_max_ms\": %.2f,\n"
+			   "  \"shared_steps\": %llu,\n"
+			   "  \"shared_steps_late\": %llu,\n"
+			   "  \"shared_late_max_ms\": %.2f,\n"
+			   "  \"ack_resume_bad\": %llu,\n"
+			   "  \"pass\": %s\n}\n",
+			days, flush_s, (unsigned long long)payload, wa_pages,
+			wa_prog, wa_erase, emin, emax, busy_ms_day, rec_ms,
+			host_ns / 1e6, torn_ok, bad_ok ? "true" : "false",
+			jit.start_max_us / 1000.0,
+			(unsigned long long)jit.steps,
+			(unsigned long long)jit.late, jit.late_max_us / 1000.0,
+			(unsigned long long)app.bad, ok ? "true" : "false");
+		if (f != stdout) {
+			fclose(f);
+		}
+	}
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+/*
+ * Mutex sample cache, as data_cache.c was before the lock-free ring.
+ *
+ * The lock is a k_mutex, as on target. The host builds compile this file
+ * with IV_SHIM_PTHREAD_MUTEX, so the shim makes it a pthread mutex
+ * rather than the usual no-op, which would make the baseline look free.
+ * Uncontended, that costs about what k_mutex_lock()/k_mutex_unlock()
+ * cost the monitor thread on target. Same ring size as data_cache.
+ */
+#include "mutex_cache.h"
+
+#include <zephyr/kernel.h>
+
+struct cache_segment {
+	int64_t  base_ms;  /* Uptime of the segment's first sample */
+	uint32_t first;    /* Sequence number of the first sample */
+};
+
+/*
+ * Samples are numbered by a free-running sequence: [tail, head) are
+ * cached, sample n lives at db_ring[n % CACHE_MAX_SAMPLES]. Segments are
+ * kept oldest first in their own ring; a segment ends where the next one
+ * (or head) begins.
+ */
+static uint8_t db_ring[CACHE_MAX_SAMPLES];
+static struct cache_segment segs[CACHE_MAX_SEGMENTS];
+static uint32_t seg_first;  /* Ring index of the oldest segment */
+static uint32_t seg_count;
+static uint32_t head;
+static uint32_t tail;
+
+static K_MUTEX_DEFINE(cache_mutex);
+
+static struct cache_segment *seg_at(uint32_t i)
+{
+	return &segs[(seg_first + i) % CACHE_MAX_SEGMENTS];
+}
+
+static uint32_t seg_end(uint32_t i)
+{
+	return i + 1 < seg_count ? seg_at(i + 1)->first : head;
+}
+
+static void drop_oldest_segment(void)
+{
+	tail = seg_end(0);
+	seg_first = (seg_first + 1) % CACHE_MAX_SEGMENTS;
+	seg_count--;
+}
+
+static void drop_oldest_sample(void)
+{
+	struct cache_segment *s = seg_at(0);
+
+	tail++;
+	if (tail == seg_end(0)) {
+		seg_first = (seg_first + 1) % CACHE_MAX_SEGMENTS;
+		seg_count--;
+		return;
+	}
+	s->first++;
+	s->base_ms += CACHE_INTERVAL_MS;
+}
+
+void mutex_cache_init(void)
+{
+	k_mutex_lock(&cache_mutex, K_FOREVER);
+	head = 0;
+	tail = 0;
+	seg_first = 0;
+	seg_count = 0;
+	k_mutex_unlock(&cache_mutex);
+}
+
+void mutex_cache_push(uint8_t db)
+{
+	int64_t now = k_uptime_get();
+
+	k_mutex_lock(&cache_mutex, K_FOREVER);
+
+	if (head - tail == CACHE_MAX_SAMPLES) {
+		/* Overwrite oldest */
+		drop_oldest_sample();
+	}
+
+	bool on_cadence = false;
+
+	if (seg_count > 0) {
+		struct cache_segment *last = seg_at(seg_count - 1);
+		int64_t expected = last->base_ms +
+				   (int64_t)(head - last->first) *
+				   CACHE_INTERVAL_MS;
+		int64_t skew = now - expected;
+
+		on_cadence = skew >= -CACHE_INTERVAL_MS / 2 &&
+			     skew <= CACHE_INTERVAL_MS / 2;
+	}
+
+	if (!on_cadence) {
+		if (seg_count == CACHE_MAX_SEGMENTS) {
+			drop_oldest_segment();
+		}
+		*seg_at(seg_count) = (struct cache_segment){
+			.base_ms = now,
+			.first = head,
+		};
+		seg_count++;
+	}
+
+	db_ring[head % CACHE_MAX_SAMPLES] = db;
+	head++;
+
+	k_mutex_unlock(&cache_mutex);
+}
+
+/* Index of the segment holding cache index idx */
+static uint32_t find_segment(uint32_t idx)
+{
+	uint32_t lo = 0;
+	uint32_t hi = seg_count - 1;
+
+	while (lo < hi) {
+		uint32_t mid = (lo + hi + 1) / 2;
+
+		if (seg_at(mid)->first - tail <= idx) {
+			lo = mid;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	return lo;
+}
+
+bool mutex_cache_get(uint32_t idx, struct iv_sample *out)
+{
+	k_mutex_lock(&cache_mutex, K_FOREVER);
+
+	if (idx >= head - tail) {
+		k_mutex_unlock(&cache_mutex);
+		return false;
+	}
+
+	uint32_t seq = tail + idx;
+	const struct cache_segment *s = seg_at(find_segment(idx));
+
+	out->uptime_ms = (uint32_t)(s->base_ms +
+				    (int64_t)(seq - s->first) *
+				    CACHE_INTERVAL_MS);
+	out->db = db_ring[seq % CACHE_MAX_SAMPLES];
+
+	k_mutex_unlock(&cache_mutex);
+	return true;
+}
@@ -0,0 +1,19 @@
+/*
+ * The sample cache as it was before it became lock-free: one mutex
+ * around every push and read. Kept out of the firmware, as the baseline
+ * the lock-free data_cache is measured against by iv_bench and by the
+ * tests/app/cache_baseline suite.
+ */
+#ifndef IV_BENCH_MUTEX_CACHE_H
+#define IV_BENCH_MUTEX_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "app/data_cache.h"
+
+void mutex_cache_init(void);
+void mutex_cache_push(uint8_t db);
+bool mutex_cache_get(uint32_t idx, struct iv_sample *out);
+
+#endif /* IV_BENCH_MUTEX_CACHE_H */
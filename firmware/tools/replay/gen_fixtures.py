@@ -0,0 +1,158 @@
+#!/usr/bin/env python3
+"""Generate labelled WAV clips for false-trigger replay.
+
+Each clip is 16 kHz mono 16-bit PCM with an Audacity label track beside
+it (<clip>.txt: "<start_s>\t<end_s>\t<label>" per line). Regions
+labelled "speech" are where feedback is wanted; every other label names
+the noise that must not trigger it. The clips cover the sounds the VAD
+is meant to reject (rumble, broadband hiss, knocking) at levels above
+the default 70 dB threshold, plus speech alone and over quiet rumble.
+
+Output is deterministic, so the clips need not be checked in:
+
+    gen_fixtures.py <out_dir>
+    iv_replay -q -v -l <out_dir>/*.wav
+"""
+
+import argparse
+import math
+import os
+import random
+import struct
+import wave
+
+RATE = 16000
+CLIP_S = 30
+
+# Quiet room floor, ~30 dB on the device scale (90 dB = full-scale RMS)
+FLOOR_DB = 30
+
+
+def db_to_rms(db):
+    return 32767.0 * 10 ** ((db - 90) / 20.0)
+
+
+def scale_to(x, db):
+    rms = math.sqrt(sum(v * v for v in x) / len(x)) if x else 0
+    k = db_to_rms(db) / rms if rms else 0
+    return [v * k for v in x]
+
+
+def noise(rng, n, db):
+    return scale_to([rng.gauss(0, 1) for _ in range(n)], db)
+
+
+def rumble(rng, n, db):
+    """HVAC: mains hum harmonics and slowly wandering low-passed noise."""
+    out, lp = [], 0.0
+    for i in range(n):
+        t = i / RATE
+        lp += 0.02 * (rng.gauss(0, 1) - lp)
+        out.append(math.sin(2 * math.pi * 60 * t) +
+                   0.5 * math.sin(2 * math.pi * 120 * t + 1.0) + 4 * lp)
+    return scale_to(out, db)
+
+
+def knocks(rng, n, db, per_s=8):
+    """Hammering: 5 ms decaying noise bursts, per_s a second."""
+    out = [0.0] * n
+    step = RATE // per_s
+    for start in range(0, n, step):
+        start += rng.randrange(step // 4)
+        for i in range(min(RATE // 200, n - start)):
+            out[start + i] += rng.gauss(0, 1) * math.exp(-i / 20.0)
+    # Level of the bursts themselves, not of the gaps between them
+    return [v * db_to_rms(db) * 4 for v in out]
+
+
+def syllable(rng, n):
+    """Voiced syllable: gliding F0 through two formant resonances."""
+    f0a, f0b = rng.uniform(110, 220), rng.uniform(110, 220)
+    f1, f2 = rng.uniform(450, 850), rng.uniform(1000, 2200)
+    out, phase = [], 0.0
+    harmonics = range(1, 24)
+    for i in range(n):
+        f0 = f0a + (f0b - f0a) * i / n
+        phase += 2 * math.pi * f0 / RATE
+        v = 0.0
+        for k in harmonics:
+            fk = k * f0
+            if fk >= RATE / 2:
+                break
+            a = (1 / (1 + ((fk - f1) / 120) ** 2) +
+                 0.6 / (1 + ((fk - f2) / 180) ** 2) + 0.02)
+            v += a * math.sin(k * phase)
+        out.append(v * math.sin(math.pi * i / n) ** 2)
+    return out
+
+
+def phrase(rng, n, db):
+    """Syllables of 150-300 ms separated by 40-120 ms pauses."""
+    out = []
+    while len(out) < n:
+        out += syllable(rng, int(rng.uniform(0.15, 0.30) * RATE))
+        out += [0.0] * int(rng.uniform(0.04, 0.12) * RATE)
+    return scale_to(out[:n], db)
+
+
+def mix(dst, src, at_s):
+    at = int(at_s * RATE)
+    for i, v in enumerate(src[:len(dst) - at]):
+        dst[at + i] += v
+
+
+def write_clip(out_dir, name, samples, labels):
+    path = os.path.join(out_dir, name)
+    with wave.open(path + ".wav", "wb") as w:
+        w.setnchannels(1)
+        w.setsampwidth(2)
+        w.setframerate(RATE)
+        w.writeframes(b"".join(
+            struct.pack("<h", max(-32768, min(32767, int(round(v)))))
+            for v in samples))
+    with open(path + ".txt", "w") as f:
+        for start, end, label in labels:
+            f.write(f"{start:.3f}\t{end:.3f}\t{label}\n")
+
+
+def clip(out_dir, name, seed, events):
+    """events: (start_s, end_s, label, generator(rng, n, db), db)"""
+    rng = random.Random(seed)
+    x = noise(rng, CLIP_S * RATE, FLOOR_DB)
+    for start, end, _, gen, db in events:
+        mix(x, gen(rng, int((end - start) * RATE), db), start)
+    write_clip(out_dir, name, x,
+               [(start, end, label) for start, end, label, _, _ in events])
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("out_dir")
+    args = ap.parse_args()
+    os.makedirs(args.out_dir, exist_ok=True)
+
+    clip(args.out_dir, "speech", 1, [
+        (4.0, 8.5, "speech", phrase, 78),
+        (13.0, 16.0, "speech", phrase, 74),
+        (21.0, 27.0, "speech", phrase, 82),
+    ])
+    clip(args.out_dir, "hvac", 2, [
+        (3.0, 27.0, "hvac", rumble, 78),
+    ])
+    clip(args.out_dir, "hiss", 3, [
+        (5.0, 25.0, "hiss", noise, 76),
+    ])
+    clip(args.out_dir, "knock", 4, [
+        (4.0, 8.0, "knock", knocks, 84),
+        (12.0, 16.0, "knock", knocks, 84),
+        (20.0, 24.0, "knock", knocks, 84),
+    ])
+    clip(args.out_dir, "speech_hvac", 5, [
+        (0.0, 30.0, "hvac", rumble, 66),
+        (6.0, 10.0, "speech", phrase, 78),
+        (18.0, 23.0, "speech", phrase, 80),
+    ])
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,694 @@
+/*
+ * Offline replay of the InsideVoice level pipeline.
+ *
+ * Streams WAV or raw PCM files through the firmware's analysis code
+ * (weighting, VAD, level detector, 1 Hz cache averaging) on the host,
+ * block by block exactly as the monitor thread does, and prints per-block
+ * levels, trigger/release events, cache samples, the session level
+ * statistics and the radio cost of each live level mode as TSV on
+ * stdout. Throughput is reported on stderr.
+ *
+ * With -l, each file is scored against its label track (see
+ * gen_fixtures.py): triggers outside "speech" regions are false, and the
+ * false-trigger rate per hour of audio can be held to a budget with -F,
+ * and the share of speech regions that trigger at all with -D.
+ *
+ * Usage: iv_replay [options] <file.wav|file.pcm|->...
+ */
+
+#include "app/analysis.h"
+#include "app/data_cache.h"
+#include "app/level_feed.h"
+#include "app/level_stats.h"
+#include "audio/weighting.h"
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <zephyr/kernel.h>
+
+/* Defaults mirror the firmware Kconfig defaults */
+#define DEFAULT_THRESHOLD_DB  70
+#define DEFAULT_RATE          16000
+#define DEFAULT_BLOCK_MS      100
+#define DEFAULT_SUBFRAME_MS   100
+#define DEFAULT_WINDOW_MS     100
+#define DEFAULT_ATTACK_MS     300
+#define DEFAULT_RELEASE_MS    300
+#define DEFAULT_VAD_MARGIN_DB 6
+#define DEFAULT_VAD_HANG_MS   300
+#define DEFAULT_NOTIFY_MS     100
+
+/* Live level modes compared per file, on a 30 ms connection interval */
+#define FEED_BATCH        10
+#define FEED_STEP_DB      3
+#define FEED_INTERVAL_MS  30
+
+/* Largest block accepted, in samples (1 s at 48 kHz) */
+#define MAX_BLOCK_SAMPLES 48000
+
+/* Speech regions read from one label track */
+#define MAX_LABELS        256
+
+struct replay_opts {
+	struct analysis_cfg cfg;
+	uint32_t raw_rate;
+	uint32_t block_ms;
+	uint8_t  threshold_db;
+	uint8_t  weighting;
+	bool     quiet;      /* Only events and the summary */
+	bool     silent;     /* Nothing on stdout (repeat passes) */
+	bool     labels;     /* Score triggers against <file>.txt */
+	uint32_t passes;
+};
+
+struct pcm_source {
+	FILE    *f;
+	uint32_t rate;
+	uint16_t channels;
+	uint64_t data_left;  /* Bytes of sample data, UINT64_MAX if unknown */
+};
+
+struct replay_totals {
+	uint64_t samples;
+	uint64_t audio_ms;
+	uint64_t ns;       /* Time spent in the pipeline */
+	uint32_t triggers;
+	uint32_t releases;
+	uint32_t cached;
+	uint32_t speech;        /* Labelled speech regions */
+	uint32_t detected;      /* ... with at least one trigger */
+	uint32_t false_trig;    /* Triggers outside any speech region */
+};
+
+/* --- Simulated uptime (see ../shim/zephyr/kernel.h) --- */
+
+static int64_t clock_ms;
+
+int64_t k_uptime_get(void)
+{
+	return clock_ms;
+}
+
+static void replay_clock_advance_ms(uint32_t ms)
+{
+	clock_ms += ms;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* --- Input --- */
+
+static uint32_t get_le32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t get_le16(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+/* Walk RIFF chunks up to "data"; src is left at the first sample */
+static int wav_open(struct pcm_source *src, const uint8_t *riff)
+{
+	uint8_t hdr[8];
+	uint8_t fmt[16];
+	bool have_fmt = false;
+
+	if (memcmp(riff + 8, "WAVE", 4) != 0) {
+		return -EINVAL;
+	}
+
+	while (fread(hdr, 1, sizeof(hdr), src->f) == sizeof(hdr)) {
+		uint32_t size = get_le32(hdr + 4);
+
+		if (memcmp(hdr, "fmt ", 4) == 0 && size >= sizeof(fmt)) {
+			if (fread(fmt, 1, sizeof(fmt), src->f) != sizeof(fmt)) {
+				return -EIO;
+			}
+			uint16_t tag = get_le16(fmt);
+			uint16_t bits = get_le16(fmt + 14);
+
+			/* PCM or WAVE_FORMAT_EXTENSIBLE, 16-bit only */
+			if ((tag != 1 && tag != 0xFFFE) || bits != 16) {
+				return -ENOTSUP;
+			}
+			src->channels = get_le16(fmt + 2);
+			src->rate = get_le32(fmt + 4);
+			have_fmt = true;
+			size -= sizeof(fmt);
+		} else if (memcmp(hdr, "data", 4) == 0) {
+			if (!have_fmt || src->channels == 0) {
+				return -EINVAL;
+			}
+			/* Streamed WAVs leave the size at 0 or ~0 */
+			src->data_left = (size == 0 || size == UINT32_MAX) ?
+					 UINT64_MAX : size;
+			return 0;
+		}
+
+		/* Skip the rest of the chunk plus its pad byte */
+		for (uint32_t skip = size + (size & 1); skip > 0; skip--) {
+			if (fgetc(src->f) == EOF) {
+				return -EIO;
+			}
+		}
+	}
+
+	return -EINVAL;
+}
+
+static int source_open(struct pcm_source *src, const char *path,
+		       uint32_t raw_rate)
+{
+	uint8_t riff[12];
+	size_t n;
+
+	memset(src, 0, sizeof(*src));
+	src->f = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+	if (!src->f) {
+		return -errno;
+	}
+
+	n = fread(riff, 1, sizeof(riff), src->f);
+	if (n == sizeof(riff) && memcmp(riff, "RIFF", 4) == 0) {
+		return wav_open(src, riff);
+	}
+
+	/* Raw signed 16-bit little-endian mono; rewind over the probe */
+	if (fseek(src->f, 0, SEEK_SET) != 0) {
+		fprintf(stderr, "%s: raw PCM must be seekable\n", path);
+		return -ESPIPE;
+	}
+	src->rate = raw_rate;
+	src->channels = 1;
+	src->data_left = UINT64_MAX;
+	return 0;
+}
+
+static void source_close(struct pcm_source *src)
+{
+	if (src->f && src->f != stdin) {
+		fclose(src->f);
+	}
+}
+
+/* Read up to count mono samples, keeping channel 0 of interleaved input */
+static size_t source_read(struct pcm_source *src, int16_t *out, size_t count)
+{
+	static uint8_t raw[MAX_BLOCK_SAMPLES * 2 * 8];
+	size_t frame = 2U * src->channels;
+	size_t want = MIN(count, sizeof(raw) / frame);
+
+	if (src->data_left != UINT64_MAX) {
+		want = MIN(want, src->data_left / frame);
+	}
+
+	size_t got = fread(raw, frame, want, src->f);
+
+	if (src->data_left != UINT64_MAX) {
+		src->data_left -= got * frame;
+	}
+	for (size_t i = 0; i < got; i++) {
+		out[i] = (int16_t)get_le16(&raw[i * frame]);
+	}
+	return got;
+}
+
+/* --- Labels --- */
+
+struct label_track {
+	uint32_t count;
+	uint32_t start_ms[MAX_LABELS];
+	uint32_t end_ms[MAX_LABELS];
+	bool     hit[MAX_LABELS];
+};
+
+/*
+ * Load the speech regions of the Audacity label track beside path
+ * (clip.wav -> clip.txt): "<start_s>\t<end_s>\t<label>" per line. Other
+ * labels only document the noise; all audio outside speech is negative.
+ */
+static int labels_load(struct label_track *lt, const char *path)
+{
+	char name[1024];
+	char line[256];
+	const char *dot = strrchr(path, '.');
+	size_t stem = dot && !strchr(dot, '/') ? (size_t)(dot - path) :
+		      strlen(path);
+
+	if (stem + sizeof(".txt") > sizeof(name)) {
+		return -ENAMETOOLONG;
+	}
+	memcpy(name, path, stem);
+	strcpy(name + stem, ".txt");
+
+	FILE *f = fopen(name, "r");
+
+	if (!f) {
+		fprintf(stderr, "%s: no label track\n", name);
+		return -ENOENT;
+	}
+
+	lt->count = 0;
+	while (fgets(line, sizeof(line), f)) {
+		double start, end;
+		char label[64];
+
+		if (sscanf(line, "%lf %lf %63s", &start, &end, label) != 3 ||
+		    strcmp(label, "speech") != 0) {
+			continue;
+		}
+		if (lt->count == MAX_LABELS || end < start) {
+			fclose(f);
+			return -EINVAL;
+		}
+		lt->start_ms[lt->count] = (uint32_t)(start * 1000);
+		lt->end_ms[lt->count] = (uint32_t)(end * 1000);
+		lt->hit[lt->count] = false;
+		lt->count++;
+	}
+	fclose(f);
+	return 0;
+}
+
+/*
+ * A trigger is due to a speech region if it fires after its start and
+ * no later than one attack time plus one window past its end: the
+ * detector only confirms speech that long after it began.
+ */
+static bool labels_score(struct label_track *lt, uint32_t t_ms,
+			 uint32_t slack_ms)
+{
+	bool match = false;
+
+	for (uint32_t i = 0; i < lt->count; i++) {
+		if (t_ms >= lt->start_ms[i] && t_ms <= lt->end_ms[i] + slack_ms) {
+			lt->hit[i] = true;
+			match = true;
+		}
+	}
+	return match;
+}
+
+/* --- Live level modes --- */
+
+struct feed_run {
+	const char *name;
+	uint8_t  mode;
+	uint8_t  arg;
+	struct level_feed feed;
+	uint32_t notifies;
+	uint32_t bytes;
+};
+
+static struct feed_run feeds[] = {
+	{ .name = "stream", .mode = LEVEL_FEED_STREAM },
+	{ .name = "batch",  .mode = LEVEL_FEED_BATCH,  .arg = FEED_BATCH },
+	{ .name = "change", .mode = LEVEL_FEED_CHANGE, .arg = FEED_STEP_DB },
+};
+
+static void feeds_reset(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(feeds); i++) {
+		level_feed_set(&feeds[i].feed, feeds[i].mode, feeds[i].arg);
+		feeds[i].notifies = 0;
+		feeds[i].bytes = 0;
+	}
+}
+
+static void feeds_push(uint8_t db)
+{
+	uint8_t out[LEVEL_FEED_MAX_SIZE];
+
+	for (size_t i = 0; i < ARRAY_SIZE(feeds); i++) {
+		uint16_t len = level_feed_push(&feeds[i].feed, db, out);
+
+		feeds[i].notifies += len > 0;
+		feeds[i].bytes += len;
+	}
+}
+
+/* Notifications per second, and the share of connection events that
+ * carry one (the rest can be skipped with peripheral latency)
+ */
+static void feeds_print(uint64_t audio_ms)
+{
+	uint64_t events = audio_ms / FEED_INTERVAL_MS;
+
+	for (size_t i = 0; i < ARRAY_SIZE(feeds); i++) {
+		const struct feed_run *r = &feeds[i];
+
+		printf("feed\t%s\t%u\t%u\t%.2f\t%.1f\n", r->name, r->notifies,
+		       r->bytes, audio_ms ? r->notifies * 1000.0 / audio_ms : 0.0,
+		       events ? r->notifies * 100.0 / events : 0.0);
+	}
+}
+
+/* --- Replay --- */
+
+static int replay_file(const char *path, const struct replay_opts *opts,
+		       struct replay_totals *tot)
+{
+	static int16_t block[MAX_BLOCK_SAMPLES];
+	static struct label_track lt;
+	struct pcm_source src;
+	struct analysis a;
+	uint32_t false_trig = 0;
+	int err;
+
+	if (opts->labels) {
+		err = labels_load(&lt, path);
+		if (err) {
+			return err;
+		}
+	}
+
+	err = source_open(&src, path, opts->raw_rate);
+
+	if (err) {
+		fprintf(stderr, "%s: cannot open: %s\n", path, strerror(-err));
+		source_close(&src);
+		return err;
+	}
+	if (src.channels > 8) {
+		fprintf(stderr, "%s: %u channels unsupported\n", path,
+			src.channels);
+		source_close(&src);
+		return -ENOTSUP;
+	}
+
+	size_t block_samples = (size_t)src.rate * opts->block_ms / 1000;
+
+	if (block_samples == 0 || block_samples > MAX_BLOCK_SAMPLES) {
+		fprintf(stderr, "%s: bad block size %zu\n", path, block_samples);
+		source_close(&src);
+		return -EINVAL;
+	}
+
+	struct analysis_cfg cfg = opts->cfg;
+
+	cfg.sample_rate = src.rate;
+	err = analysis_init(&a, &cfg);
+	if (err) {
+		fprintf(stderr, "%s: invalid detector config\n", path);
+		source_close(&src);
+		return err;
+	}
+
+	if (opts->weighting != WEIGHTING_Z) {
+		struct weighting_filter probe;
+
+		if (weighting_init(&probe, opts->weighting, src.rate)) {
+			fprintf(stderr, "%s: no weighting table for %u Hz, "
+				"using Z\n", path, src.rate);
+		}
+	}
+
+	clock_ms = 0;
+	data_cache_init();
+	level_stats_reset();
+	feeds_reset();
+	if (!opts->quiet && !opts->silent) {
+		printf("file\t%s\t%u\n", path, src.rate);
+	}
+
+	uint64_t pos = 0;
+	size_t n;
+
+	while ((n = source_read(&src, block, block_samples)) > 0) {
+		struct analysis_result res;
+
+		/* Uptime at the end of the block, as when the device reads it */
+		replay_clock_advance_ms((uint32_t)(n * 1000 / src.rate));
+
+		uint64_t t0 = now_ns();
+
+		analysis_process(&a, block, n, 0, opts->threshold_db,
+				 opts->weighting, &res);
+		if (res.cache) {
+			data_cache_push(res.cache_db);
+		}
+		level_stats_update(res.level.block_db,
+				   (uint32_t)(n * 1000 / src.rate),
+				   res.level.event);
+		if (res.notify) {
+			feeds_push(res.notify_db);
+		}
+		tot->ns += now_ns() - t0;
+
+		uint32_t t_ms = (uint32_t)(pos * 1000 / src.rate);
+
+		if (!opts->quiet && !opts->silent) {
+			printf("block\t%u\t%u\t%u\n", t_ms, res.level.block_db,
+			       res.speech);
+		}
+		if (res.level.event != LEVEL_DET_EVENT_NONE) {
+			uint32_t ev_ms = (uint32_t)((pos +
+				res.level.event_offset) * 1000 / src.rate);
+			bool trig = res.level.event == LEVEL_DET_EVENT_TRIGGER;
+
+			if (trig) {
+				tot->triggers++;
+				if (opts->labels &&
+				    !labels_score(&lt, ev_ms, opts->cfg.attack_ms +
+						  opts->cfg.window_ms)) {
+					false_trig++;
+				}
+			} else {
+				tot->releases++;
+			}
+			if (!opts->silent) {
+				printf("%s\t%u\t%u\n",
+				       trig ? "trigger" : "release", ev_ms,
+				       res.level.event_db);
+			}
+		}
+
+
+		pos += n;
+
+		if (res.cache) {
+			struct iv_sample s;
+
+			data_cache_get(data_cache_count() - 1, &s);
+			tot->cached++;
+			if (!opts->quiet && !opts->silent) {
+				printf("cache\t%u\t%u\n", s.uptime_ms, s.db);
+			}
+		}
+	}
+
+	if (!opts->silent) {
+		struct level_stats st;
+
+		level_stats_get(&st);
+		printf("stats\t%u\t%u.%u\t%u\t%u\t%u\t%u\t%u\t%u\n",
+		       st.duration_ms, st.leq_ddb / 10U, st.leq_ddb % 10U,
+		       st.l10_db, st.l50_db, st.l90_db, st.lmax_db, st.over_ms,
+		       st.episodes);
+		feeds_print(pos * 1000 / src.rate);
+	}
+
+	/* Repeat passes only time the pipeline */
+	if (opts->labels && !opts->silent) {
+		uint32_t detected = 0;
+
+		for (uint32_t i = 0; i < lt.count; i++) {
+			detected += lt.hit[i];
+		}
+		printf("labels\t%u\t%u\t%u\t%.1f\n", lt.count, detected,
+		       false_trig,
+		       pos ? false_trig * 3600.0 * src.rate / pos : 0.0);
+		tot->speech += lt.count;
+		tot->detected += detected;
+		tot->false_trig += false_trig;
+	}
+
+	tot->samples += pos;
+	tot->audio_ms += pos * 1000 / src.rate;
+	source_close(&src);
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [options] <file.wav|file.pcm|->...\n"
+		"  -t <dB>    threshold (default %u)\n"
+		"  -w z|a|c   weighting curve (default z)\n"
+		"  -r <Hz>    sample rate of raw PCM input (default %u)\n"
+		"  -b <ms>    block duration (default %u)\n"
+		"  -s <ms>    detector sub-frame (default %u)\n"
+		"  -W <ms>    detector window (default %u)\n"
+		"  -A <ms>    attack time (default %u)\n"
+		"  -R <ms>    release time (default %u)\n"
+		"  -v         gate the attack timer with the VAD\n"
+		"  -n <N>     replay each file N times, output from the "
+		"first (benchmarking)\n"
+		"  -q         only print events and the summary\n"
+		"  -l         score triggers against the label track "
+		"<file>.txt\n"
+		"  -F <n>     with -l, exit 1 above n false triggers per hour\n"
+		"  -D <pct>   with -l, exit 1 if under pct%% of speech regions "
+		"trigger\n"
+		"\n"
+		"Output rows (TSV): file <path> <rate> | block <t_ms> <dB> "
+		"<speech> |\n"
+		"  trigger|release <t_ms> <dB> | cache <uptime_ms> <dB> |\n"
+		"  stats <ms> <Leq> <L10> <L50> <L90> <Lmax> <over_ms> "
+		"<episodes> |\n"
+		"  feed stream|batch|change <notifies> <bytes> <per_s> "
+		"<event_pct> |\n"
+		"  labels <speech> <detected> <false> <false_per_hour>\n",
+		prog, DEFAULT_THRESHOLD_DB, DEFAULT_RATE, DEFAULT_BLOCK_MS,
+		DEFAULT_SUBFRAME_MS, DEFAULT_WINDOW_MS, DEFAULT_ATTACK_MS,
+		DEFAULT_RELEASE_MS);
+}
+
+int main(int argc, char **argv)
+{
+	struct replay_opts opts = {
+		.cfg = {
+			.subframe_ms = DEFAULT_SUBFRAME_MS,
+			.window_ms = DEFAULT_WINDOW_MS,
+			.attack_ms = DEFAULT_ATTACK_MS,
+			.release_ms = DEFAULT_RELEASE_MS,
+			.vad_margin_db = DEFAULT_VAD_MARGIN_DB,
+			.vad_hangover_ms = DEFAULT_VAD_HANG_MS,
+			.notify_interval_ms = DEFAULT_NOTIFY_MS,
+			.cache_interval_ms = CACHE_INTERVAL_MS,
+		},
+		.raw_rate = DEFAULT_RATE,
+		.block_ms = DEFAULT_BLOCK_MS,
+		.threshold_db = DEFAULT_THRESHOLD_DB,
+		.weighting = WEIGHTING_Z,
+		.passes = 1,
+	};
+	double max_false_per_h = -1;
+	double min_detected_pct = -1;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "t:w:r:b:s:W:A:R:vn:qlF:D:h")) != -1) {
+		switch (opt) {
+		case 't':
+			opts.threshold_db = (uint8_t)atoi(optarg);
+			break;
+		case 'w':
+			opts.weighting = optarg[0] == 'a' ? WEIGHTING_A :
+					 optarg[0] == 'c' ? WEIGHTING_C :
+					 WEIGHTING_Z;
+			break;
+		case 'r':
+			opts.raw_rate = (uint32_t)atoi(optarg);
+			break;
+		case 'b':
+			opts.block_ms = (uint32_t)atoi(optarg);
+			break;
+		case 's':
+			opts.cfg.subframe_ms = (uint16_t)atoi(optarg);
+			break;
+		case 'W':
+			opts.cfg.window_ms = (uint16_t)atoi(optarg);
+			break;
+		case 'A':
+			opts.cfg.attack_ms = (uint16_t)atoi(optarg);
+			break;
+		case 'R':
+			opts.cfg.release_ms = (uint16_t)atoi(optarg);
+			break;
+		case 'v':
+			opts.cfg.vad = true;
+			break;
+		case 'n':
+			opts.passes = MAX(1, atoi(optarg));
+			break;
+		case 'q':
+			opts.quiet = true;
+			break;
+		case 'l':
+			opts.labels = true;
+			break;
+		case 'F':
+			max_false_per_h = atof(optarg);
+			break;
+		case 'D':
+			min_detected_pct = atof(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 2;
+		}
+	}
+
+	if (optind >= argc) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	int status = 0;
+	struct replay_totals all = { 0 };
+
+	for (int i = optind; i < argc; i++) {
+		struct replay_totals tot = { 0 };
+
+		for (uint32_t p = 0; p < opts.passes; p++) {
+			opts.silent = p > 0;
+			if (replay_file(argv[i], &opts, &tot)) {
+				status = 1;
+				break;
+			}
+		}
+		if (tot.samples == 0) {
+			continue;
+		}
+
+		double sec = tot.ns / 1e9;
+		double rate_sps = sec > 0 ? tot.samples / sec : 0;
+
+		fprintf(stderr, "%s: %llu samples in %.3f s: %.0f samples/s "
+			"(%.0fx real time), %u triggers, %u releases, "
+			"%u cache samples\n",
+			argv[i], (unsigned long long)tot.samples, sec, rate_sps,
+			sec > 0 ? tot.audio_ms / 1000.0 / sec : 0,
+			tot.triggers, tot.releases, tot.cached);
+
+		/* Label counts come from the first pass only */
+		all.audio_ms += tot.audio_ms / opts.passes;
+		all.speech += tot.speech;
+		all.detected += tot.detected;
+		all.false_trig += tot.false_trig;
+	}
+
+	if (opts.labels && all.audio_ms > 0) {
+		double per_h = all.false_trig * 3600000.0 / all.audio_ms;
+
+		fprintf(stderr, "labels: %u/%u speech regions detected, "
+			"%u false triggers in %.1f min: %.1f per hour\n",
+			all.detected, all.speech, all.false_trig,
+			all.audio_ms / 60000.0, per_h);
+		if (max_false_per_h >= 0 && per_h > max_false_per_h) {
+			fprintf(stderr, "labels: over the budget of %.1f per "
+				"hour\n", max_false_per_h);
+			status = 1;
+		}
+		if (min_detected_pct >= 0 &&
+		    all.detected * 100.0 < min_detected_pct * all.speech) {
+			fprintf(stderr, "labels: under %.0f%% of speech "
+				"regions detected\n", min_detected_pct);
+			status = 1;
+		}
+	}
+
+	return status;
+}
@@ -0,0 +1,190 @@
+/*
+ * Host shim for <zephyr/kernel.h>.
+ *
+ * The host tools are single threaded, so mutexes and spinlocks are
+ * no-ops and k_sleep() returns at once. A work item runs as soon as it
+ * is submitted or scheduled without a delay; delayed work never comes
+ * due, as host time only moves when a tool moves it. Each tool defines
+ * k_uptime_get(); the replay tool returns the position in the audio so
+ * cache timestamps match the recording.
+ *
+ * A file built with IV_SHIM_PTHREAD_MUTEX gets real pthread mutexes
+ * instead, for baselines whose cost is the lock (see
+ * tools/bench/mutex_cache.c).
+ */
+#ifndef IV_SHIM_ZEPHYR_KERNEL_H
+#define IV_SHIM_ZEPHYR_KERNEL_H
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <zephyr/sys/util.h>
+
+typedef struct {
+	int64_t ticks;
+} k_timeout_t;
+
+#define K_FOREVER ((k_timeout_t){ -1 })
+#define K_NO_WAIT ((k_timeout_t){ 0 })
+#define K_MSEC(ms) ((k_timeout_t){ (ms) })
+#define K_SECONDS(s) K_MSEC((s) * 1000)
+
+struct k_spinlock {
+	int unused;
+};
+
+typedef int k_spinlock_key_t;
+
+static inline k_spinlock_key_t k_spin_lock(struct k_spinlock *l)
+{
+	ARG_UNUSED(l);
+	return 0;
+}
+
+static inline void k_spin_unlock(struct k_spinlock *l, k_spinlock_key_t key)
+{
+	ARG_UNUSED(l);
+	ARG_UNUSED(key);
+}
+
+static inline int32_t k_sleep(k_timeout_t timeout)
+{
+	ARG_UNUSED(timeout);
+	return 0;
+}
+
+struct k_thread {
+	int unused;
+};
+
+#define K_THREAD_STACK_DEFINE(sym, size) static char sym[size]
+#define K_THREAD_STACK_SIZEOF(sym) sizeof(sym)
+
+static inline int k_thread_name_set(struct k_thread *t, const char *name)
+{
+	ARG_UNUSED(t);
+	ARG_UNUSED(name);
+	return 0;
+}
+
+struct k_work;
+typedef void (*k_work_handler_t)(struct k_work *work);
+
+struct k_work {
+	k_work_handler_t handler;
+};
+
+struct k_work_delayable {
+	struct k_work work;
+};
+
+struct k_work_q {
+	struct k_thread thread;
+};
+
+static inline void k_work_queue_start(struct k_work_q *q, char *stack,
+				      size_t size, int prio, const void *cfg)
+{
+	ARG_UNUSED(q);
+	ARG_UNUSED(stack);
+	ARG_UNUSED(size);
+	ARG_UNUSED(prio);
+	ARG_UNUSED(cfg);
+}
+
+static inline void k_work_init(struct k_work *w, k_work_handler_t handler)
+{
+	w->handler = handler;
+}
+
+static inline void k_work_init_delayable(struct k_work_delayable *dw,
+					 k_work_handler_t handler)
+{
+	dw->work.handler = handler;
+}
+
+static inline int k_work_submit_to_queue(struct k_work_q *q,
+					 struct k_work *w)
+{
+	ARG_UNUSED(q);
+	w->handler(w);
+	return 1;
+}
+
+static inline int k_work_schedule_for_queue(struct k_work_q *q,
+					    struct k_work_delayable *dw,
+					    k_timeout_t delay)
+{
+	if (delay.ticks != 0) {
+		return 0;
+	}
+	return k_work_submit_to_queue(q, &dw->work);
+}
+
+static inline int k_work_reschedule_for_queue(struct k_work_q *q,
+					      struct k_work_delayable *dw,
+					      k_timeout_t delay)
+{
+	return k_work_schedule_for_queue(q, dw, delay);
+}
+
+#if defined(IV_SHIM_PTHREAD_MUTEX)
+#include <pthread.h>
+
+struct k_mutex {
+	pthread_mutex_t m;
+};
+
+#define K_MUTEX_DEFINE(name) \
+	struct k_mutex name = { PTHREAD_MUTEX_INITIALIZER }
+
+static inline int k_mutex_lock(struct k_mutex *m, k_timeout_t timeout)
+{
+	ARG_UNUSED(timeout);
+	return -pthread_mutex_lock(&m->m);
+}
+
+static inline int k_mutex_unlock(struct k_mutex *m)
+{
+	return -pthread_mutex_unlock(&m->m);
+}
+#else
+struct k_mutex {
+	int unused;
+};
+
+#define K_MUTEX_DEFINE(name) struct k_mutex name
+
+static inline int k_mutex_lock(struct k_mutex *m, k_timeout_t timeout)
+{
+	ARG_UNUSED(m);
+	ARG_UNUSED(timeout);
+	return 0;
+}
+
+static inline int k_mutex_unlock(struct k_mutex *m)
+{
+	ARG_UNUSED(m);
+	return 0;
+}
+#endif
+
+int64_t k_uptime_get(void);
+
+/* Cycle counter for the unit tests: host nanoseconds */
+static inline uint32_t k_cycle_get_32(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+static inline uint64_t k_cyc_to_ns_floor64(uint64_t cyc)
+{
+	return cyc;
+}
+
+#endif /* IV_SHIM_ZEPHYR_KERNEL_H */
@@ -0,0 +1,22 @@
+/*
+ * Host shim for <zephyr/logging/log.h>: warnings and errors go to
+ * stderr, info and debug are dropped.
+ */
+#ifndef IV_SHIM_ZEPHYR_LOGGING_LOG_H
+#define IV_SHIM_ZEPHYR_LOGGING_LOG_H
+
+#include <stdio.h>
+
+#define LOG_LEVEL_INF 3
+
+#define LOG_MODULE_REGISTER(name, level) \
+	static const char *const log_module_name __attribute__((unused)) = #name
+
+#define LOG_ERR(fmt, ...) \
+	fprintf(stderr, "<err> %s: " fmt "\n", log_module_name, ##__VA_ARGS__)
+#define LOG_WRN(fmt, ...) \
+	fprintf(stderr, "<wrn> %s: " fmt "\n", log_module_name, ##__VA_ARGS__)
+#define LOG_INF(fmt, ...) do { } while (0)
+#define LOG_DBG(fmt, ...) do { } while (0)
+
+#endif /* IV_SHIM_ZEPHYR_LOGGING_LOG_H */
@@ -0,0 +1,38 @@
+/*
+ * Host shim for <zephyr/settings/settings.h>: nothing is persisted, so
+ * app_config runs on its compiled-in defaults.
+ */
+#ifndef IV_SHIM_ZEPHYR_SETTINGS_SETTINGS_H
+#define IV_SHIM_ZEPHYR_SETTINGS_SETTINGS_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+typedef ssize_t (*settings_read_cb)(void *cb_arg, void *data, size_t len);
+
+#define SETTINGS_STATIC_HANDLER_DEFINE(_hname, _tree, _get, _set, _commit, \
+				       _export)                            \
+	static int (*const settings_handler_##_hname)(                     \
+		const char *, size_t, settings_read_cb, void *)            \
+		__attribute__((unused)) = _set
+
+static inline int settings_subsys_init(void)
+{
+	return 0;
+}
+
+static inline int settings_load(void)
+{
+	return 0;
+}
+
+static inline int settings_save_one(const char *name, const void *value,
+				    size_t val_len)
+{
+	(void)name;
+	(void)value;
+	(void)val_len;
+	return 0;
+}
+
+#endif /* IV_SHIM_ZEPHYR_SETTINGS_SETTINGS_H */
@@ -0,0 +1,28 @@
+/*
+ * Host shim for <zephyr/storage/flash_map.h>: the flash_area accessors
+ * used by the flash log and the history module. The host tool defines
+ * them over a simulated partition; every label names that one.
+ */
+#ifndef IV_SHIM_ZEPHYR_STORAGE_FLASH_MAP_H
+#define IV_SHIM_ZEPHYR_STORAGE_FLASH_MAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+struct flash_area {
+	uint8_t  fa_id;
+	off_t    fa_off;
+	size_t   fa_size;
+};
+
+#define FIXED_PARTITION_ID(label) 0
+
+int flash_area_open(uint8_t id, const struct flash_area **fa);
+int flash_area_read(const struct flash_area *fa, off_t off, void *dst,
+		    size_t len);
+int flash_area_write(const struct flash_area *fa, off_t off, const void *src,
+		     size_t len);
+int flash_area_erase(const struct flash_area *fa, off_t off, size_t len);
+
+#endif /* IV_SHIM_ZEPHYR_STORAGE_FLASH_MAP_H */
@@ -0,0 +1,30 @@
+/*
+ * Host shim: <zephyr/sys/atomic.h> on the compiler's __atomic builtins,
+ * with the same sequentially consistent ordering as the target.
+ */
+#ifndef IV_SHIM_ZEPHYR_SYS_ATOMIC_H
+#define IV_SHIM_ZEPHYR_SYS_ATOMIC_H
+
+#include <stdbool.h>
+
+typedef long atomic_t;
+typedef atomic_t atomic_val_t;
+
+static inline atomic_val_t atomic_get(const atomic_t *target)
+{
+	return __atomic_load_n(target, __ATOMIC_SEQ_CST);
+}
+
+static inline atomic_val_t atomic_set(atomic_t *target, atomic_val_t value)
+{
+	return __atomic_exchange_n(target, value, __ATOMIC_SEQ_CST);
+}
+
+static inline bool atomic_cas(atomic_t *target, atomic_val_t old_value,
+			      atomic_val_t new_value)
+{
+	return __atomic_compare_exchange_n(target, &old_value, new_value, false,
+					   __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+#endif /* IV_SHIM_ZEPHYR_SYS_ATOMIC_H */
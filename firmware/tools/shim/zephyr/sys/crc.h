@@ -0,0 +1,24 @@
+/*
+ * Host shim: crc32_ieee() from <zephyr/sys/crc.h> (reflected
+ * 0xEDB88320, same result as the Zephyr implementation).
+ */
+#ifndef IV_SHIM_ZEPHYR_SYS_CRC_H
+#define IV_SHIM_ZEPHYR_SYS_CRC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+static inline uint32_t crc32_ieee(const uint8_t *data, size_t len)
+{
+	uint32_t crc = 0xFFFFFFFFU;
+
+	for (size_t i = 0; i < len; i++) {
+		crc ^= data[i];
+		for (int b = 0; b < 8; b++) {
+			crc = (crc >> 1) ^ (0xEDB88320U & -(crc & 1U));
+		}
+	}
+	return ~crc;
+}
+
+#endif /* IV_SHIM_ZEPHYR_SYS_CRC_H */
@@ -0,0 +1,28 @@
+/*
+ * Host shim: the subset of <zephyr/sys/util.h> used by the firmware
+ * sources built into the host tools.
+ */
+#ifndef IV_SHIM_ZEPHYR_SYS_UTIL_H
+#define IV_SHIM_ZEPHYR_SYS_UTIL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef MIN
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+#define CLAMP(val, low, high) \
+	(((val) <= (low)) ? (low) : MIN(val, high))
+#define ARRAY_SIZE(array) (sizeof(array) / sizeof((array)[0]))
+#define DIV_ROUND_UP(n, d) (((n) + (d) - 1) / (d))
+#define ROUND_UP(x, align) (DIV_ROUND_UP(x, align) * (align))
+#define ARG_UNUSED(x) (void)(x)
+#define BIT(n) (1UL << (n))
+#define IS_POWER_OF_TWO(x) (((x) != 0U) && (((x) & ((x) - 1U)) == 0U))
+#define BUILD_ASSERT(expr, ...) _Static_assert(expr, "" __VA_ARGS__)
+#define __aligned(x) __attribute__((aligned(x)))
+
+#endif /* IV_SHIM_ZEPHYR_SYS_UTIL_H */
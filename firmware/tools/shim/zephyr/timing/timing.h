@@ -0,0 +1,54 @@
+/*
+ * Host shim for <zephyr/timing/timing.h>: the counter is host
+ * nanoseconds, so cycles and nanoseconds are the same unit.
+ */
+#ifndef IV_SHIM_ZEPHYR_TIMING_TIMING_H
+#define IV_SHIM_ZEPHYR_TIMING_TIMING_H
+
+#include <stdint.h>
+#include <time.h>
+
+typedef uint64_t timing_t;
+
+static inline void timing_init(void)
+{
+}
+
+static inline void timing_start(void)
+{
+}
+
+static inline void timing_stop(void)
+{
+}
+
+static inline timing_t timing_counter_get(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint64_t timing_cycles_get(volatile timing_t *const start,
+					 volatile timing_t *const end)
+{
+	return *end - *start;
+}
+
+static inline uint64_t timing_freq_get(void)
+{
+	return 1000000000ULL;
+}
+
+static inline uint64_t timing_cycles_to_ns(uint64_t cycles)
+{
+	return cycles;
+}
+
+static inline uint32_t timing_freq_get_mhz(void)
+{
+	return 1000;
+}
+
+#endif /* IV_SHIM_ZEPHYR_TIMING_TIMING_H */
@@ -0,0 +1,97 @@
+/*
+ * Host shim for <zephyr/ztest.h>: enough of the new ztest API for the
+ * suites under ../../tests to run as plain host executables under CTest
+ * (see tools/tests). Suites and tests register themselves from
+ * constructors; a failed assertion ends the current test.
+ */
+#ifndef IV_SHIM_ZEPHYR_ZTEST_H
+#define IV_SHIM_ZEPHYR_ZTEST_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+
+struct ztest_suite_node {
+	const char *name;
+	void *(*setup)(void);
+	void (*before)(void *fixture);
+	void (*after)(void *fixture);
+	void (*teardown)(void *fixture);
+	struct ztest_suite_node *next;
+};
+
+struct ztest_unit_test {
+	const char *suite;
+	const char *name;
+	void (*test)(void *fixture);
+	struct ztest_unit_test *next;
+};
+
+void ztest_register_suite(struct ztest_suite_node *suite);
+void ztest_register_test(struct ztest_unit_test *test);
+void ztest_fail(const char *file, int line, const char *cond,
+		const char *fmt, ...) __attribute__((noreturn,
+						     format(printf, 4, 5)));
+void ztest_test_skip(void) __attribute__((noreturn));
+
+#define ZTEST_SUITE(_name, _pred, _setup, _before, _after, _teardown)     \
+	static struct ztest_suite_node ztest_suite_##_name = {            \
+		.name = #_name,                                           \
+		.setup = _setup,                                          \
+		.before = _before,                                        \
+		.after = _after,                                          \
+		.teardown = _teardown,                                    \
+	};                                                                \
+	__attribute__((constructor)) static void ztest_reg_##_name(void) \
+	{                                                                 \
+		ztest_register_suite(&ztest_suite_##_name);               \
+	}
+
+#define ZTEST(_suite, _fn)                                                \
+	static void _suite##_##_fn(void);                                 \
+	static void _suite##_##_fn##_wrap(void *fixture)                  \
+	{                                                                 \
+		(void)fixture;                                            \
+		_suite##_##_fn();                                         \
+	}                                                                 \
+	static struct ztest_unit_test ztest_unit_##_suite##_##_fn = {     \
+		.suite = #_suite,                                         \
+		.name = #_fn,                                             \
+		.test = _suite##_##_fn##_wrap,                            \
+	};                                                                \
+	__attribute__((constructor)) static void                          \
+	ztest_reg_##_suite##_##_fn(void)                                  \
+	{                                                                 \
+		ztest_register_test(&ztest_unit_##_suite##_##_fn);        \
+	}                                                                 \
+	static void _suite##_##_fn(void)
+
+#define TC_PRINT(fmt, ...) printf(fmt, ##__VA_ARGS__)
+
+/* The message arguments are optional, as in ztest */
+#define ZTEST_MSG(...) " " __VA_ARGS__
+
+#define zassert_true(cond, ...)                                           \
+	do {                                                              \
+		if (!(cond)) {                                            \
+			ztest_fail(__FILE__, __LINE__, #cond,             \
+				   ZTEST_MSG(__VA_ARGS__));               \
+		}                                                         \
+	} while (0)
+
+#define zassert_false(cond, ...) zassert_true(!(cond), ##__VA_ARGS__)
+#define zassert_ok(expr, ...)    zassert_true((expr) == 0, ##__VA_ARGS__)
+#define zassert_equal(a, b, ...) zassert_true((a) == (b), ##__VA_ARGS__)
+#define zassert_not_equal(a, b, ...) \
+	zassert_true((a) != (b), ##__VA_ARGS__)
+#define zassert_not_null(p, ...) zassert_true((p) != NULL, ##__VA_ARGS__)
+#define zassert_between_inclusive(a, lo, hi, ...) \
+	zassert_true((a) >= (lo) && (a) <= (hi), ##__VA_ARGS__)
+#define zassert_within(a, b, d, ...) \
+	zassert_true((a) >= (b) - (d) && (a) <= (b) + (d), ##__VA_ARGS__)
+#define zassert_mem_equal(a, b, n, ...) \
+	zassert_true(memcmp((a), (b), (n)) == 0, ##__VA_ARGS__)
+
+#endif /* IV_SHIM_ZEPHYR_ZTEST_H */
@@ -0,0 +1,71 @@
+/*
+ * A 1 MB history partition in RAM for host suites that run the flash
+ * log, as native_sim's flash simulator provides under twister: 4 KB
+ * sectors, erased to 0xFF, programming only clears bits.
+ */
+#include <errno.h>
+#include <string.h>
+#include <zephyr/storage/flash_map.h>
+
+#include "app/flash_log.h"
+
+#define PART_SIZE (1024 * 1024)
+
+static uint8_t flash[PART_SIZE];
+
+static const struct flash_area part = {
+	.fa_id = 0,
+	.fa_off = 0,
+	.fa_size = PART_SIZE,
+};
+
+static bool in_part(const struct flash_area *fa, off_t off, size_t len)
+{
+	return off >= 0 && (size_t)off + len <= fa->fa_size;
+}
+
+int flash_area_open(uint8_t id, const struct flash_area **fa)
+{
+	static bool erased;
+
+	if (!erased) {
+		memset(flash, 0xFF, sizeof(flash));
+		erased = true;
+	}
+	*fa = &part;
+	return 0;
+}
+
+int flash_area_read(const struct flash_area *fa, off_t off, void *dst,
+		    size_t len)
+{
+	if (!in_part(fa, off, len)) {
+		return -EINVAL;
+	}
+	memcpy(dst, &flash[off], len);
+	return 0;
+}
+
+int flash_area_write(const struct flash_area *fa, off_t off, const void *src,
+		     size_t len)
+{
+	const uint8_t *p = src;
+
+	if (!in_part(fa, off, len)) {
+		return -EINVAL;
+	}
+	for (size_t i = 0; i < len; i++) {
+		flash[off + i] &= p[i];
+	}
+	return 0;
+}
+
+int flash_area_erase(const struct flash_area *fa, off_t off, size_t len)
+{
+	if (!in_part(fa, off, len) || off % FLASH_LOG_SECTOR_SIZE ||
+	    len % FLASH_LOG_SECTOR_SIZE) {
+		return -EINVAL;
+	}
+	memset(&flash[off], 0xFF, len);
+	return 0;
+}
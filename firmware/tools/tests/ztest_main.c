@@ -0,0 +1,134 @@
+/*
+ * Host runner for the ztest suites (see ../shim/zephyr/ztest.h): runs
+ * every registered test, or the suites named on the command line, and
+ * exits non-zero if any test failed.
+ */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <zephyr/ztest.h>
+
+static struct ztest_suite_node *suites;
+static struct ztest_unit_test *tests;
+static struct ztest_unit_test **tests_tail = &tests;
+
+enum test_result {
+	TEST_PASS,
+	TEST_FAIL,
+	TEST_SKIP,
+};
+
+static jmp_buf test_env;
+static volatile enum test_result test_res;
+
+void ztest_register_suite(struct ztest_suite_node *suite)
+{
+	suite->next = suites;
+	suites = suite;
+}
+
+/* Tests run in the order they appear in the source */
+void ztest_register_test(struct ztest_unit_test *test)
+{
+	*tests_tail = test;
+	tests_tail = &test->next;
+}
+
+void ztest_fail(const char *file, int line, const char *cond,
+		const char *fmt, ...)
+{
+	va_list ap;
+
+	printf("    Assertion failed at %s:%d: %s:", file, line, cond);
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+	printf("\n");
+	test_res = TEST_FAIL;
+	longjmp(test_env, 1);
+}
+
+void ztest_test_skip(void)
+{
+	test_res = TEST_SKIP;
+	longjmp(test_env, 1);
+}
+
+/* Suites that keep their own clock define a strong k_uptime_get() */
+__attribute__((weak)) int64_t k_uptime_get(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static bool selected(const char *name, int argc, char **argv)
+{
+	if (argc < 2) {
+		return true;
+	}
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], name)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static int run_suite(struct ztest_suite_node *suite, int *skipped)
+{
+	void *fixture = suite->setup ? suite->setup() : NULL;
+	int failed = 0;
+
+	printf("Running TESTSUITE %s\n", suite->name);
+	for (struct ztest_unit_test *t = tests; t; t = t->next) {
+		if (strcmp(t->suite, suite->name)) {
+			continue;
+		}
+
+		printf("START - %s\n", t->name);
+		if (suite->before) {
+			suite->before(fixture);
+		}
+
+		test_res = TEST_PASS;
+		if (setjmp(test_env) == 0) {
+			t->test(fixture);
+		}
+
+		enum test_result res = test_res;
+
+		if (suite->after) {
+			suite->after(fixture);
+		}
+
+		printf(" %s - %s\n", res == TEST_PASS ? "PASS" :
+		       res == TEST_SKIP ? "SKIP" : "FAIL", t->name);
+		failed += res == TEST_FAIL;
+		*skipped += res == TEST_SKIP;
+	}
+	if (suite->teardown) {
+		suite->teardown(fixture);
+	}
+	return failed;
+}
+
+int main(int argc, char **argv)
+{
+	int failed = 0;
+	int skipped = 0;
+
+	for (struct ztest_suite_node *s = suites; s; s = s->next) {
+		if (selected(s->name, argc, argv)) {
+			failed += run_suite(s, &skipped);
+		}
+	}
+
+	printf("PROJECT EXECUTION %s (%d failed, %d skipped)\n",
+	       failed ? "FAILED" : "SUCCESSFUL", failed, skipped);
+	return failed ? 1 : 0;
+}